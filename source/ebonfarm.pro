@@ -9,26 +9,41 @@ INCLUDEPATH += . include forms
 
 # Input
 HEADERS += include/ArrowHandler.hpp \
+           include/ChangeJournal.hpp \
            include/CharSaver.hpp \
            include/ConfigComments.hpp \
+           include/ConfigWatcher.hpp \
            include/ConfigWriter.hpp \
            include/ConnectForm.hpp \
            include/DisplayRow.hpp \
+           include/FrameExporter.hpp \
+           include/FrameRenderer.hpp \
            include/FXRule.hpp \
            include/GraphicsSettings.hpp \
            include/HistoryLog.hpp \
            include/ImageLoader.hpp \
+           include/LatencyForm.hpp \
+           include/LatencyHistogram.hpp \
            include/LatencyWidget.hpp \
            include/MainWindow.hpp \
            include/MessageForm.hpp \
+           include/MessageLog.hpp \
            include/NetCursor.hpp \
            include/NethackFX.hpp \
            include/NetSprite.hpp \
            include/NGSettings.hpp \
+           include/NGTrace.hpp \
+           include/NotificationForm.hpp \
+           include/NotificationQueue.hpp \
+           include/RenderBenchmark.hpp \
+           include/RowWatcher.hpp \
            include/RuleLoader.hpp \
+           include/ScreenTimeline.hpp \
            include/SGRAttribute.hpp \
            include/TelnetProtocol.hpp \
            include/TelnetWindow.hpp \
+           include/TileCache.hpp \
+           include/TimelineForm.hpp \
            include/TipForm.hpp \
            include/WhiteBoard.hpp \
            include/XtermEscape.hpp \
@@ -36,33 +51,49 @@ HEADERS += include/ArrowHandler.hpp \
     forms/farmdockwidget.h
 FORMS += forms/ConnectForm.ui \
          forms/GraphicsSettings.ui \
+         forms/LatencyForm.ui \
          forms/MainWindow.ui \
          forms/MessageDialog.ui \
+         forms/NotificationForm.ui \
+         forms/TimelineForm.ui \
          forms/TipForm.ui \
          forms/ZoomForm.ui \
     forms/farmdockwidget.ui
 SOURCES += source/ArrowHandler.cpp \
+           source/ChangeJournal.cpp \
            source/CharSaver.cpp \
            source/ConfigComments.cpp \
            source/ConfigWriter.cpp \
            source/ConnectForm.cpp \
            source/DisplayRow.cpp \
            source/EbonHackMain.cpp \
+           source/FrameExporter.cpp \
+           source/FrameRenderer.cpp \
            source/FXRule.cpp \
            source/GraphicsSettings.cpp \
            source/HistoryLog.cpp \
            source/ImageLoader.cpp \
+           source/LatencyForm.cpp \
+           source/LatencyHistogram.cpp \
            source/LatencyWidget.cpp \
            source/MainWindow.cpp \
            source/MessageForm.cpp \
+           source/MessageLog.cpp \
            source/NetCursor.cpp \
            source/NethackFX.cpp \
            source/NetSprite.cpp \
            source/NGSettings.cpp \
+           source/NGTrace.cpp \
+           source/NotificationForm.cpp \
+           source/NotificationQueue.cpp \
+           source/RenderBenchmark.cpp \
            source/RuleLoader.cpp \
+           source/ScreenTimeline.cpp \
            source/SGRAttribute.cpp \
            source/TelnetProtocol.cpp \
            source/TelnetWindow.cpp \
+           source/TileCache.cpp \
+           source/TimelineForm.cpp \
            source/TipForm.cpp \
            source/WhiteBoard.cpp \
            source/XtermEscape.cpp \
@@ -70,7 +101,10 @@ SOURCES += source/ArrowHandler.cpp \
     forms/farmdockwidget.cpp
 QT += opengl
 QMAKE_CXXFLAGS += -DNG_OPEN_GL
+# Pipeline tracing, see NGTrace.hpp. Enable with "qmake CONFIG+=trace".
+trace:QMAKE_CXXFLAGS += -DNG_TRACE
 QT += network
+QT += concurrent
 LIBS += -lm
 CONFIG += qt thread
 DESTDIR = ./
@@ -17,17 +17,18 @@ This file is part of EbonFarm, an extension of EbonHack.
 */
 #include "farmdockwidget.h"
 #include "ui_farmdockwidget.h"
-#include <QMessageBox>
 
 #include <MainWindow.hpp>
 
 #include <WhiteBoard.hpp>
 #include <TelnetProtocol.hpp>
+#include <NotificationQueue.hpp>
 using namespace std;
 
 FarmDockWidget::FarmDockWidget(QWidget *parent) :
     QDockWidget(parent),
-    ui(new Ui::FarmDockWidget)
+    ui(new Ui::FarmDockWidget),
+    whiteBoard(NULL)
 {
     ui->setupUi(this);
 
@@ -35,10 +36,16 @@ FarmDockWidget::FarmDockWidget(QWidget *parent) :
 
 FarmDockWidget::~FarmDockWidget()
 {
+    if( whiteBoard != NULL && whiteBoard->getTelnetPro() != NULL ){
+        whiteBoard->getTelnetPro()->getTelnetWindow()->removeRowWatches(this);
+    }
     delete ui;
 }
 QString message="";
 QString status="";
+QString topLine="";
+QString secondLine="";
+QString statusLine="";
 
 QString itemList=")[!?/=+*(`$%0_\"";
 QString farmRubbish;
@@ -68,8 +75,11 @@ uint8_t playerpos;
 uint8_t farmline;
 uint8_t farmpos;
 int state=0;
-int aborted = 0;
 bool running = false;
+/* hash of the screen at the start of the last farming round, and how many rounds in a row it stayed the same */
+quint64 last_screen = 0;
+int stalled_rounds = 0;
+const int max_stalled_rounds = 20;
 QMap<QString, QPair<int, int> > directions;
 QMap<QString, QString> rev_dirs;
 
@@ -80,15 +90,9 @@ void FarmDockWidget::fail_abort(std::string reason)
 
     fail_stop("abort: "+reason);
 
-    if( aborted == 0 ){
-        aborted ++;
-
-        QMessageBox msgBox;
-        msgBox.setText("Please fix the problem.");
-        //msgBox.setStandardButtons(QMessageBox::OK);
-        //msgBox.setDefaultButton(QMessageBox::OK);
-        msgBox.exec();
-    }
+    /* never block the farming loop on a dialog, the queue pops it up the first time */
+    QString key = QString::fromStdString("farm abort: "+reason);
+    whiteBoard->getNotifications()->post(key, "Farming stopped ("+QString::fromStdString(reason)+"). Please fix the problem. The Screen Timeline shows the screens before it.", true);
 }
 void FarmDockWidget::fail_stop(std::string reason)
 {
@@ -107,6 +111,10 @@ void FarmDockWidget::fail_stop(std::string reason)
     running = false;
     state = 0;
     cout<<"Finished Farming: "<<reason<<endl;
+    ScreenTimeline &timeline = this->whiteBoard->getTelnetPro()->getTelnetWindow()->getTimeline();
+    if( timeline.getNumFrames() > 0 ){
+        cout<<"Screen timeline frame is "<<timeline.getLastFrame()<<endl;
+    }
     timer->stop();
     expecting_alerts= false;
     farmRubbish.clear();
@@ -115,16 +123,24 @@ void FarmDockWidget::fail_stop(std::string reason)
 
 
 }
-void  FarmDockWidget::refill(){
-    QString m2 = "";
-    message.clear();
-    status.clear();
-    for(int i = 0; i < this->whiteBoard->getTelnetPro()->getTelnetWindow()->getWidth(); i++){
-        message.append(this->whiteBoard->getTelnetPro()->getTelnetWindow()->getByte(i, 0));
-        m2.append(this->whiteBoard->getTelnetPro()->getTelnetWindow()->getByte(i, 1));
-        status.append(this->whiteBoard->getTelnetPro()->getTelnetWindow()->getByte(i, 23));
+void FarmDockWidget::rowChanged(int /*watchID*/, uint8_t row, const std::string &rowText, bool /*matched*/){
+    QString text = QString::fromLatin1(rowText.data(), rowText.size());
+    if( row == 0 ){
+        topLine = text;
+    }else if( row == 1 ){
+        secondLine = text;
+    }else if( row == 23 ){
+        statusLine = text;
     }
-    message.append(m2.trimmed());
+}
+bool FarmDockWidget::isRunning(){
+    return running;
+}
+void  FarmDockWidget::refill(){
+    /* the row watches keep topLine, secondLine and statusLine up to date */
+    message = topLine;
+    message.append(secondLine.trimmed());
+    status = statusLine;
     cout<<"Message is "<<message.toStdString()<<endl;
     cout<<"Status is "<<status.toStdString()<<endl;
 
@@ -508,6 +524,8 @@ void FarmDockWidget::pb_start(){
     //attackMessage += (char)1;// 1 is "ctrl+A" or 'Again'
     farmline = playerline + offset.second;
     farmpos = playerpos + offset.first;
+    last_screen = 0;
+    stalled_rounds = 0;
 
 
 
@@ -539,6 +557,17 @@ void FarmDockWidget::farm(const QString current_weapon, const QString &attack_co
         }
         for( int i = 0; (i < rounds) && running; i++){
             refill();
+            /* every round sends something, so a screen that stays exactly the same for many rounds means the game stopped reacting */
+            quint64 screen = this->whiteBoard->getTelnetPro()->getTelnetWindow()->getScreenHash();
+            if( screen == last_screen ){
+                stalled_rounds++;
+                if( stalled_rounds >= max_stalled_rounds ){
+                    return fail_abort("screen stopped changing");
+                }
+            }else{
+                stalled_rounds = 0;
+            }
+            last_screen = screen;
             uint8_t altar = this->whiteBoard->getTelnetPro()->getTelnetWindow()->getByte(farmpos, farmline);
             if(message.contains("--More--")){
                   if(message.contains("trice") || message.contains("stone")){
@@ -687,7 +716,7 @@ void FarmDockWidget::send_char(const QString &message)
     QTimer loop_timer (this);
     connect(&loop_timer, SIGNAL(timeout()), &loop, SLOT(quit()));
     loop_timer.start(4000);
-    this->whiteBoard->getTelnetPro()->sendCommand(message);
+    this->whiteBoard->getTelnetPro()->sendBytes(message.toLatin1());
     loop.exec();
     loop_timer.stop();
     expecting_alerts = false;
@@ -708,6 +737,10 @@ void FarmDockWidget::send_char(const QString &message)
 bool FarmDockWidget::initialize(WhiteBoard *wb){
     this->whiteBoard = wb;
 
+    /* only copy the message and status lines when they change */
+    this->whiteBoard->getTelnetPro()->getTelnetWindow()->addRowWatch(this, 0, 2, "");
+    this->whiteBoard->getTelnetPro()->getTelnetWindow()->addRowWatch(this, 23, 1, "");
+
 
     timer = new QTimer(this);
     connect(timer, SIGNAL(timeout()), this, SLOT(timer_abort()));
@@ -4,13 +4,14 @@
 #include <QDockWidget>
 
 #include <iostream>
+#include "RowWatcher.hpp"
 class WhiteBoard;
 
 namespace Ui {
 class FarmDockWidget;
 }
 
-class FarmDockWidget : public QDockWidget
+class FarmDockWidget : public QDockWidget, public RowWatcher
 {
     Q_OBJECT
 
@@ -20,6 +21,9 @@ public:
 
     bool initialize(WhiteBoard *wb);
     void send_char(const QString &message);
+    void rowChanged(int watchID, uint8_t row, const std::string &rowText, bool matched);
+    /* true while the bot is farming and sending keystrokes */
+    bool isRunning();
 private:
     Ui::FarmDockWidget *ui;
     WhiteBoard *whiteBoard;
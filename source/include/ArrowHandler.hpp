@@ -60,6 +60,9 @@ class ArrowHandler : public QObject
         //Set the value of prevArrow, sets bufferedArrow to false, updates arrowTimer
         void newBufferedArrow(int newArrow);
 
+        //Send a single direction key to the server
+        void sendKey(char key);
+
 };//ArrowHandler
 
 #endif
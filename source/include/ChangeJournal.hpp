@@ -0,0 +1,108 @@
+/* DESCRIPTION
+
+  A record of what one batch of server data changed in the telnet window:
+  which rows changed, which cells within them changed, and where the cursor
+  moved. TelnetWindow fills in a journal while the batch is parsed and
+  publishes it when the batch is finished.
+
+  Reading a journal doesn't change it, so the renderer, the history log, the
+  rules and anything else can each look at the same changes. A consumer that
+  doesn't look at every batch should compare getBatchNumber() with the last
+  batch it saw, and treat the whole window as changed if it missed one.
+*/
+
+#ifndef NG_CHANGE_JOURNAL
+#define NG_CHANGE_JOURNAL
+
+#include <vector>
+#include <stdint.h>
+
+//Cells from firstColumn to lastColumn of row were written to
+struct NGCellRange
+{
+    uint8_t row;
+    uint8_t firstColumn;
+    uint8_t lastColumn;
+};//NGCellRange
+
+class ChangeJournal
+{
+    public:
+        //constructor
+        ChangeJournal(void);
+
+        //destructor
+        ~ChangeJournal(void);
+
+        //Start an empty journal for a window of the specified size. The cursor is at
+        //cursorX, cursorY when the batch starts.
+        void reset(unsigned int newBatchNumber,
+                   uint8_t newWidth,
+                   uint8_t newHeight,
+                   uint8_t cursorX,
+                   uint8_t cursorY);
+
+        //Record that every cell in rows from topRow to topRow + numRows - 1 changed
+        void markRows(uint8_t topRow,
+                      uint8_t numRows);
+
+        //Record that cells from firstColumn to lastColumn of row changed. Joins the
+        //range to the previous one if they touch.
+        void markCells(uint8_t row,
+                       uint8_t firstColumn,
+                       uint8_t lastColumn);
+
+        //Record where the cursor is at the end of the batch
+        void setCursor(uint8_t cursorX,
+                       uint8_t cursorY);
+
+        //Exchange contents with other, without copying or allocating
+        void swap(ChangeJournal &other);
+
+        //Identifies the batch, counts up by one for each batch
+        unsigned int getBatchNumber(void) const;
+
+        //True if anything in the window changed, including the cursor position
+        bool getAnyChanged(void) const;
+
+        //True if any cell in the row changed
+        bool getRowChanged(uint8_t row) const;
+
+        //True if any cell from firstColumn to lastColumn of row changed
+        bool getCellsChanged(uint8_t row,
+                             uint8_t firstColumn,
+                             uint8_t lastColumn) const;
+
+        //The changed cells, in the order they were changed
+        unsigned int getNumRanges(void) const;
+        const NGCellRange& getRange(unsigned int index) const;
+
+        //Cursor positions at the start and end of the batch, counting from 0
+        uint8_t getStartCursorX(void) const;
+        uint8_t getStartCursorY(void) const;
+        uint8_t getCursorX(void) const;
+        uint8_t getCursorY(void) const;
+        bool getCursorMoved(void) const;
+
+    private:
+        //Identifies the batch
+        unsigned int batchNumber;
+
+        //The width of the window, used for whole-row ranges
+        uint8_t windowWidth;
+
+        //True if any cell in the row changed
+        std::vector <bool> changedRows;
+
+        //The changed cells. Cleared, but never freed, between batches.
+        std::vector <NGCellRange> ranges;
+
+        //Cursor positions at the start and end of the batch
+        uint8_t startCursorX;
+        uint8_t startCursorY;
+        uint8_t endCursorX;
+        uint8_t endCursorY;
+
+};//ChangeJournal
+
+#endif
@@ -1,6 +1,13 @@
 /* DESCRIPTION
   Saves and loads character mappings from file. A character with a specific
   color translates to a nethack graphic.
+
+  Mappings learned while playing are appended to a journal next to the base file
+  as soon as they're learned, so they survive a crash. Appends are flushed straight
+  away, and synced to disk in batches by syncJournal(). load() replays the journal
+  over the base file. The journal is compacted into the base file by save(), and
+  whenever it grows past MAX_JOURNAL_ENTRIES. If the base file couldn't be loaded,
+  nothing is saved or journaled.
 */
 
 #ifndef NG_CHAR_SAVER
@@ -12,6 +19,8 @@
 #include <fstream>
 #include <sstream>
 #include <stdint.h>
+#include <QElapsedTimer>
+#include <QFile>
 
 #include "SGRAttribute.hpp"
 
@@ -24,19 +33,70 @@ class CharSaver
         //destructor
         ~CharSaver(void);
 
-        //Loads known char-to-sprite mappings from file.
+        //Loads known char-to-sprite mappings from file, then replays the journal
         bool load(const std::string &pathAndName,
                   std::map <std::string, int> &knownChars);
 
-        //Saves known char-to-sprite mappings
+        //Saves known char-to-sprite mappings, and empties the journal
         bool save(const std::string &pathAndName,
                   std::map <std::string, int> &knownChars);
 
+        //Add a newly learned mapping to the journal. knownChars must already contain it,
+        //and is saved if the journal needs compacting. Returns false without writing if
+        //the base file couldn't be loaded.
+        bool append(const std::string &theKey,
+                    int spriteIndex,
+                    std::map <std::string, int> &knownChars);
+
+        //Sync appended mappings to disk if enough have built up, or the oldest has
+        //waited long enough. Needs to be called periodically. Syncs everything if force
+        //is true.
+        void syncJournal(bool force);
+
+        //Appended to the base file name to get the journal file name
+        static const char JOURNAL_SUFFIX[];
+
+        //The number of journal entries that causes the journal to be compacted
+        static const int MAX_JOURNAL_ENTRIES = 256;
+
+        //Sync the journal after this many appends...
+        static const int SYNC_BATCH_SIZE = 16;
+
+        //...or when the oldest unsynced append is this many milliseconds old
+        static const int SYNC_DELAY = 2000;
+
     private:
         //Each element has a text name for the corresponding SGR Color.
         //See SGRAttributes class.
         std::vector <std::string> colorNames;
 
+        //The base file passed to load(), used when compacting
+        std::string basePathAndName;
+
+        //Learned mappings not yet in the base file, kept open for appending
+        QFile journal;
+
+        //Number of entries in the journal, and how many of them haven't been synced
+        int journalEntries;
+        int unsyncedEntries;
+
+        //Started when the first unsynced entry is appended
+        QElapsedTimer syncTimer;
+
+        //############### FUNCTIONS ###############
+
+        //Apply the journal for basePathAndName to knownChars. Stops quietly at a
+        //partly written last line, which is what a crash leaves behind.
+        void replayJournal(std::map <std::string, int> &knownChars);
+
+        //Open the journal for appending if it isn't open already
+        bool openJournal(void);
+
+        //Write one mapping in the file format, without the newline
+        bool writeLine(std::ostream &out,
+                       const std::string &theKey,
+                       int spriteIndex);
+
         //Extract the information from a single line from the file
         bool processLine(std::string &oneLine,
                          std::map <std::string, int> &knownChars);
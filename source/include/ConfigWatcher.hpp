@@ -0,0 +1,26 @@
+/* DESCRIPTION
+
+  Interface for anything that needs to know when a configuration value
+  changes. Register with ConfigWriter::addWatcher(), and configChanged()
+  will be called whenever a write changes a value, so settings can be
+  re-applied without re-reading the config files.
+*/
+
+#ifndef NG_CONFIG_WATCHER
+#define NG_CONFIG_WATCHER
+
+#include <string>
+
+class ConfigWatcher
+{
+    public:
+        //destructor
+        virtual ~ConfigWatcher(void) {}
+
+        //Called after configID in fileName was given a different value
+        virtual void configChanged(const std::string &fileName,
+                                   const std::string &configID) = 0;
+
+};//ConfigWatcher
+
+#endif
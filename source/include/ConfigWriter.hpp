@@ -18,9 +18,12 @@
   If your ID wasn't found in the file, it creates a new entry.
   Any comments should be added by hand-editing the file.
 
-  Note that writing a new value involves reading the whole file, changing or adding the entry,
-  and re-writing the whole file. ConfigWriter is not intended to work on huge files for reasons
-  of efficiency.
+  Each file is read once, the first time it's used, and kept in memory. Loads are
+  answered from memory, so changes made by hand while the program is running won't
+  be seen. Writes change the value in memory straight away, and the whole file is
+  re-written a little later by a background thread, so a burst of writes only
+  writes the file once. The file is written to a temporary file that replaces the
+  original, so a crash can't leave half a file behind. Call flush() before exiting.
 */
 
 #ifndef PG_CONFIGWRITER
@@ -30,11 +33,41 @@
 #include <vector>
 #include <sstream>
 #include <iostream>
+#include <map>
+#include <QMutex>
+#include <QThreadPool>
 
 #include "ConfigComments.hpp"
+#include "ConfigWatcher.hpp"
+
+//A single entry in a config file
+struct NGConfigEntry
+{
+    //The comments above the entry
+    ConfigComments comments;
+
+    //The entry's identifier and value, without the % and >
+    std::string configID;
+    std::string value;
+};//NGConfigEntry
+
+//The contents of a config file
+struct NGConfigFile
+{
+    //Every entry, in the order they appear in the file
+    std::vector <NGConfigEntry> entries;
+
+    //Maps a config ID to its index in entries
+    std::map <std::string, unsigned int> entryIndex;
+
+    //True if the file has changed, and a write is scheduled
+    bool writePending;
+};//NGConfigFile
 
 class ConfigWriter
 {
+    friend class ConfigWriteTask;
+
     public:
         //constructor
         ConfigWriter(void);
@@ -82,6 +115,18 @@ class ConfigWriter
                                 const std::string &configID,
                                 double newDouble);
 
+        //Wait for scheduled writes to finish. Call before exiting.
+        static void flush(void);
+
+        //Call watcher->configChanged() whenever a write changes a value
+        static void addWatcher(ConfigWatcher *watcher);
+
+        //Stop notifying watcher
+        static void removeWatcher(ConfigWatcher *watcher);
+
+        //Milliseconds to wait for more changes before writing a file
+        static const unsigned long WRITE_DELAY = 200;
+
         //returns the string equivalent of number
         static std::string intToStr(int number);
 
@@ -93,21 +138,36 @@ class ConfigWriter
         //the path to the config file, should end in /
         static std::string path;
 
+        //The contents of every file we've read, by file name
+        static std::map <std::string, NGConfigFile*> configFiles;
+
+        //Everyone to notify when a value changes
+        static std::vector <ConfigWatcher*> watchers;
+
+        //Protects configFiles, which is read by the write thread
+        static QMutex cacheMutex;
+
+        //Writes files in the background, one at a time. Created when it's first needed.
+        static QThreadPool *writePool;
+
         //Returns a copy of oneLine, with only non-displayable and non-typeable characters removed
         static std::string cleanLine(const std::string &oneLine);
 
-        //Read a single entry from the file, and store it in the provided
-        //variables. Returns true if configID was found, and changes the value
-        //to newString
-        static bool readEntry(std::string oneLine,
+        //Read a single entry from the file, starting with oneLine, and store it in newEntry
+        static void readEntry(std::string oneLine,
                               std::ifstream &infile,
-                              const std::string &configID,
-                              const std::string &newString,
-                              std::vector <ConfigComments*> &fileComments,
-                              std::vector <std::string> &fileIDs,
-                              std::vector <std::string> &fileValues,
+                              NGConfigEntry &newEntry,
                               const std::string &pathAndName);
 
+        //Returns the contents of fileName, reading the file if it hasn't been read yet.
+        //If the file doesn't exist, it's an error if mustExist is true, otherwise the
+        //file is treated as empty. cacheMutex must be locked.
+        static NGConfigFile* getFile(const std::string &fileName,
+                                     bool mustExist);
+
+        //Re-write fileName from its contents in memory. Run by the write thread.
+        static void writeFile(const std::string &fileName);
+
 };//ConfigWriter
 
 #endif
@@ -11,6 +11,7 @@
 #include <iostream>
 #include <vector>
 #include <stdint.h>
+#include <QtGlobal>
 #include <QGraphicsScene>
 
 class NetSprite;
@@ -28,10 +29,12 @@ class DisplayRow
         //destructor
         ~DisplayRow(void);
 
-        //set the character at the specified index
+        //set the character at the specified index, with the tile the server sent for it
+        //or NetSprite::NO_TILE
         void setChar(uint8_t index,
                      uint8_t value,
-                     SGRAttribute *writeAttributes);
+                     SGRAttribute *writeAttributes,
+                     int serverTile);
 
         //retrieve the character at the specified index
         uint8_t getChar(uint8_t index);
@@ -42,10 +45,39 @@ class DisplayRow
         //retrieve the display attributes for the char at the specified index
         SGRAttribute* getAttributes(uint8_t index);
 
+        //retrieve the tile the server sent for the char at the specified index
+        int getServerTile(uint8_t index);
+
+        //A hash of every character, attribute and server tile in the row, kept up to date
+        //as cells are written. Rows with the same contents have the same hash.
+        quint64 getHash(void);
+
+        //Mix the bits of value, so nearby inputs give unrelated hashes
+        static quint64 mixHash(quint64 value);
+
+        //The part of the row hash contributed by one cell
+        static quint64 getCellHash(uint8_t index,
+                                   uint8_t value,
+                                   SGRAttribute *attributes,
+                                   int serverTile);
+
         //Returns the number of elements in the DisplayRow
         unsigned int size(void);
 
-        //Removes all contained sprites from the specified graphics scene
+        //Move the row to a different line of the graphics scene
+        void setRow(int y);
+
+        //Move the row to line y and resize its sprites, use when the sprite size changes
+        void updateGeometry(int y);
+
+        //Shows or hides every sprite in the row
+        void setVisible(bool visible);
+
+        //Lets the FrameRenderer draw every sprite in the row
+        void setOffscreen(bool offscreen);
+
+        //Adds or removes all contained sprites from the specified graphics scene
+        void addToScene(QGraphicsScene *theScene);
         void removeFromScene(QGraphicsScene *theScene);
 
     private:
@@ -55,6 +87,9 @@ class DisplayRow
         //A row of character data, including associated graphic
         std::vector<NetSprite*> theSprites;
 
+        //The cell hashes of every sprite, xored together
+        quint64 rowHash;
+
 };//DisplayRow
 
 #endif
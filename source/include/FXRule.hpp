@@ -40,6 +40,12 @@ class FXRule
         bool checkRule(const std::string &firstLine,
                        bool &useGraphics);
 
+        //Sets useGraphics according to this rule's action, without checking the condition
+        void applyAction(bool &useGraphics);
+
+        //Returns the regular expression stored by storeCondition()
+        std::string getPattern(void);
+
     private:
         //A regular expression which must be satisfied for this rule to be
         //applied.
@@ -0,0 +1,76 @@
+/* DESCRIPTION
+
+  Renders a recorded session to image frames without showing a window, for bug
+  reports and farm reviews. Every batch of server data in the session is parsed
+  into the telnet window, with the tileset and zoom from game_config.txt, and the
+  whole scene is rendered offscreen. Batches that don't change the picture are
+  skipped, so only changed frames are encoded.
+
+  The frames are either saved as a PNG sequence, named after the batch they show so
+  gaps mark the frames that were skipped, or written as raw frames to the standard
+  input of an encoder like ffmpeg. Started with --export-frames or --export-pipe, and
+  runs without a display under QT_QPA_PLATFORM=offscreen.
+
+  The scene can only be drawn on the GUI thread, so the session is replayed from
+  start to finish there and the PNGs are encoded on the thread pool.
+*/
+
+#ifndef NG_FRAME_EXPORTER
+#define NG_FRAME_EXPORTER
+
+#include <string>
+#include <vector>
+#include <QByteArray>
+#include <QString>
+#include <QImage>
+
+class WhiteBoard;
+
+class FrameExporter
+{
+    public:
+        //Save every changed frame of sessionFile to directory as frame_NNNNNN.png.
+        //Returns false on errors and couts a message.
+        static bool exportPNG(WhiteBoard *whiteBoard,
+                              const std::string &sessionFile,
+                              const QString &directory);
+
+        //Start command and write every changed frame of sessionFile to its standard input,
+        //as raw 32 bit BGRA pixels. %SIZE% in command is replaced with the frame size, like
+        //"ffmpeg -f rawvideo -pixel_format bgra -video_size %SIZE% -i - session.mp4".
+        //Returns false on errors and couts a message.
+        static bool exportPipe(WhiteBoard *whiteBoard,
+                               const std::string &sessionFile,
+                               const QString &command);
+
+        //PNGs waiting to be encoded for each thread in the pool, before we wait for one
+        static const int PENDING_PER_THREAD = 2;
+
+        //Most bytes left unwritten to the encoder before we wait for it to catch up
+        static const qint64 MAX_PIPE_BUFFER = 64 * 1024 * 1024;
+
+        //Milliseconds to wait for the encoder to start or read a frame
+        static const int PIPE_TIMEOUT = 30000;
+
+    private:
+        //Load the session and the tiles, set the zoom and start the replay. Sizes theFrame
+        //to fit the scene. Returns false on errors and couts a message.
+        static bool startExport(WhiteBoard *whiteBoard,
+                                const std::string &sessionFile,
+                                std::vector <QByteArray> &theSession,
+                                QImage &theFrame);
+
+        //Parse one batch and render it into theFrame. Returns false if the frame looks
+        //the same as lastFrame.
+        static bool renderBatch(WhiteBoard *whiteBoard,
+                                const QByteArray &theBatch,
+                                QImage &theFrame,
+                                const QImage &lastFrame);
+
+        //Save theFrame as a PNG, runs on the thread pool
+        static bool savePNG(QImage theFrame,
+                            QString filename);
+
+};//FrameExporter
+
+#endif
@@ -0,0 +1,219 @@
+/* DESCRIPTION
+
+  An optional renderer that draws the telnet window on a worker thread, so a long
+  paint doesn't hold up keystrokes or the game logic. Enabled by "Threaded Rendering"
+  in game_config.txt.
+
+  The telnet window's sprites stop painting themselves, and report which rows changed
+  instead. The changed rows are copied on the GUI thread and handed to the thread pool,
+  which draws them into the back one of a pair of QImages using tile and character
+  atlases scaled for the zoom, then swaps the pair. The GUI thread only blits the
+  front image.
+
+  Only one frame is drawn at a time, rows that change meanwhile wait for the next
+  one. Each frame also redraws the rows changed by the frame before it, since the
+  back image missed them.
+
+  On platforms that can't draw text off the GUI thread, the character atlas and any
+  characters outside it are drawn on the GUI thread and handed over with the job.
+*/
+
+#ifndef NG_FRAME_RENDERER
+#define NG_FRAME_RENDERER
+
+#include <vector>
+#include <stdint.h>
+#include <QGraphicsObject>
+#include <QImage>
+#include <QFont>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QMutex>
+#include <QTimer>
+#include <QFutureWatcher>
+
+#include "SGRAttribute.hpp"
+#include "ConfigWatcher.hpp"
+
+class WhiteBoard;
+
+//A copy of one sprite, safe to read from the worker thread
+struct NGFrameCell
+{
+    uint8_t telnetChar;
+    NGS_Attribute color;
+
+    //Index of the tile in the tile atlas, or -1 to draw the character
+    int tileIndex;
+};//NGFrameCell
+
+//Everything the worker thread needs to draw one frame
+struct NGFrameJob
+{
+    //The telnet rows to draw, and their cells one row after another
+    std::vector <int> rows;
+    std::vector <NGFrameCell> cells;
+
+    //True if the atlases and images must be rebuilt from the fields below first
+    bool rebuild;
+
+    //Unscaled tiles, in the same order as the tile atlas
+    QList <QImage> tiles;
+
+    //The printable characters, and characters outside the atlas keyed by
+    //TileCache::getGlyphKey(), drawn on the GUI thread. Only used when the platform
+    //can't draw text on the thread pool, otherwise glyphAtlas is null.
+    QImage glyphAtlas;
+    QHash <int, QImage> glyphs;
+
+    QFont font;
+    int fontOffset;
+    QSize spriteSize;
+    double zoom;
+    Qt::TransformationMode filter;
+    int windowWidth;
+    int windowHeight;
+};//NGFrameJob
+
+class FrameRenderer : public QGraphicsObject, public ConfigWatcher
+{
+    Q_OBJECT
+
+    public:
+        //constructor
+        FrameRenderer(WhiteBoard *newWhiteBoard);
+
+        //destructor
+        ~FrameRenderer(void);
+
+        //The area covered by the telnet window, in scene coordinates
+        QRectF boundingRect(void) const;
+
+        //Blits the most recently finished frame
+        void paint(QPainter *painter,
+                   const QStyleOptionGraphicsItem *option,
+                   QWidget *widget);
+
+        //Remember that a sprite on this row of the scene changed. It'll be drawn in
+        //the next frame.
+        void markRow(int sceneRow);
+
+        //Rebuild the atlases and redraw the whole window at newZoom. Use when the zoom,
+        //tileset, font or history size changes.
+        void reset(double newZoom);
+
+        //Draw every changed row now and wait for the frames to finish, used by the
+        //render benchmark
+        void waitForFrames(void);
+
+        //Rebuild the tile atlas when "Zoom Filter" is written
+        void configChanged(const std::string &fileName,
+                           const std::string &configID);
+
+        //Number of tiles in each row of the tile atlas
+        static const int ATLAS_COLUMNS = 40;
+
+    private slots:
+        //Copy the changed rows and start drawing them on the thread pool
+        void startFrame(void);
+
+        //Show the frame that was just drawn, and start the next one if rows changed meanwhile
+        void frameFinished(void);
+
+    private:
+        //Pointer to the global whiteboard, don't delete
+        WhiteBoard *whiteBoard;
+
+        //### Used by the GUI thread ###
+
+        //Rows changed since the last frame was started, and rows drawn by that frame
+        std::vector <bool> dirtyRows;
+        std::vector <bool> lastRows;
+
+        //Index in the tile atlas of each tile, keyed by the tile's cacheKey()
+        QHash <qint64, int> tileIndices;
+
+        //Settings for rebuilding the atlases, taken by the next frame. NULL if none.
+        NGFrameJob *rebuildJob;
+
+        //The frame being drawn on the thread pool, NULL if none
+        NGFrameJob *currentJob;
+        QFutureWatcher <void> frameWatcher;
+
+        //The part of the window that will change when currentJob finishes
+        QRectF changedRect;
+
+        //Starts a frame once the current batch of changes is finished
+        QTimer startTimer;
+
+        //Size of the telnet window in characters and sprites in pixels
+        int windowWidth;
+        int windowHeight;
+        QSize spriteSize;
+
+        //The zoom passed to reset()
+        double jobZoom;
+
+        //True if characters can be drawn on the thread pool. If false, the characters
+        //outside the atlas in drawnGlyphs have already been given to the worker thread.
+        bool threadedFonts;
+        QSet <int> drawnGlyphs;
+
+        //### Used by the worker thread ###
+
+        //Tiles and characters scaled for atlasZoom
+        QImage tileAtlas;
+        QImage glyphAtlas;
+
+        //Characters that aren't printable ASCII, drawn as needed
+        QHash <int, QImage> extraGlyphs;
+
+        //The zoom, font and sizes the atlases were built with
+        double atlasZoom;
+        QFont glyphFont;
+        int glyphOffset;
+        QSize atlasSpriteSize;
+        QSize cellSize;
+        QSize frameSize;
+
+        //### Shared, guarded by frameMutex ###
+
+        //The front and back images, and which is in front
+        QImage frames[2];
+        int frontFrame;
+
+        //The zoom the front image was drawn at
+        double frameZoom;
+
+        QMutex frameMutex;
+
+        //############### FUNCTIONS ###############
+
+        //Draw the rows in theJob into the back image and swap it to the front.
+        //Runs on the thread pool.
+        void rasterize(NGFrameJob *theJob);
+
+        //Scale the tiles and draw the characters into the atlases. Runs on the thread pool.
+        void buildAtlases(NGFrameJob *theJob);
+
+        //Draw the printable characters, one row per color, for sprites of spriteSize
+        //scaled by zoom
+        static QImage drawGlyphAtlas(const QFont &theFont,
+                                     int fontOffset,
+                                     QSize spriteSize,
+                                     double zoom);
+
+        //Draw one character into the frame. Runs on the thread pool.
+        void drawGlyph(QPainter &painter,
+                       QPoint cellPos,
+                       uint8_t telnetChar,
+                       NGS_Attribute color);
+
+        //Pixel position of a cell in the frame, at atlasZoom
+        QPoint getCellPos(int x,
+                          int y);
+
+};//FrameRenderer
+
+#endif
@@ -4,25 +4,36 @@
 #include <string>
 #include <QGraphicsScene>
 #include "SGRAttribute.hpp"
+#include "RowWatcher.hpp"
 
 class WhiteBoard;
 class DisplayRow;
+class MessageLog;
 
-class HistoryLog
+class HistoryLog : public RowWatcher
 {
     public:
-        //constructor
-        HistoryLog(WhiteBoard *newWhiteBoard);
+        //constructor, lines are added to newMessageLog and the display shows its last lines
+        HistoryLog(WhiteBoard *newWhiteBoard,
+                   MessageLog *newMessageLog);
 
         //destructor
         ~HistoryLog(void);
 
-        //Display the window contents in the graphics scene
+        //Display the window contents in the graphics scene, and start watching the
+        //first line of the telnet window
         void setGraphicsScene(QGraphicsScene *theScene);
 
-        //Remove the window contents from the graphics scene
+        //Remove the window contents from the graphics scene, and stop watching the
+        //telnet window
         void removeFromScene(QGraphicsScene *theScene);
 
+        //Called by the telnet window when the first line changes
+        void rowChanged(int watchID,
+                        uint8_t row,
+                        const std::string &rowText,
+                        bool matched);
+
         //Should be called whenever the telnet window changes
         //Adds newLine to the user's history, if appropriate. New lines are not added to the history
         //when showGraphics is false.
@@ -33,17 +44,29 @@ class HistoryLog
         void show(void);
         void hide(void);
 
-        //Sets the user history to blank spaces
+        //Sets the user history to blank spaces. The lines stay in the message log.
         void clearHistory(void);
 
+        //Redraw the display from the end of the message log
+        void refresh(void);
+
+        //Add or delete rows to match the history size, and resize every sprite for the
+        //current sprite size. theScene is the scene the log was added to, if any.
+        void resize(QGraphicsScene *theScene);
+
     private:
         //Whenever the top line changes, add it to history. Shows the user's most
-        //recent events.
+        //recent events. A ring buffer, the oldest line displayed is at firstRow.
         std::vector <DisplayRow*> history;
 
-        //A copy of the contents of history. Used to restore the history log if it has been
-        //hidden
-        std::vector <std::string*> historyBuf;
+        //The index in history of the row displayed at the top
+        unsigned int firstRow;
+
+        //Every line added to the history this session, just a pointer don't delete
+        MessageLog *messageLog;
+
+        //The first line in messageLog that may be displayed, lines before it were cleared
+        unsigned int displayStart;
 
         //pointer to the global whiteboard
         WhiteBoard *whiteBoard;
@@ -62,6 +85,18 @@ class HistoryLog
         //true if the log is hidden, false if it is being displayed
         bool hidden;
 
+        //############### FUNCTIONS ###############
+
+        //Write newLine over the oldest displayed row, and move it to the bottom
+        void addDisplayLine(const std::string &newLine);
+
+        //Move every row to its place in the ring buffer
+        void positionRows(void);
+
+        //Fill a row with newLine, padded with spaces
+        void writeRow(DisplayRow *oneRow,
+                      const std::string &newLine);
+
 };//HistoryLog
 
 #endif // HISTORYLOG_HPP_INCLUDED
@@ -6,6 +6,11 @@
   imageList is a vector that stores the images.
   nameMap is an std::map where the key is an image name, and the data is an index in imageList.
   This allows us to quickly find any image given its name.
+
+  loadImages() only builds QImages, so it can run off the GUI thread. The three
+  sprite files are parsed in parallel. createPixmaps() must then be called from the
+  GUI thread to turn them into the pixmaps the display uses. When a custom tileset
+  will replace every image anyway, loadImages() can read just the tile names.
 */
 
 #ifndef NG_IMAGE_LOADER
@@ -32,8 +37,12 @@ class ImageLoader
         //destructor
         ~ImageLoader(void);
 
-        //Load all sprites from file
-        bool loadImages(void);
+        //Load all sprites from file. If namesOnly is true, only the tile names are read
+        //and every image is left NULL until loadCustom() is called.
+        bool loadImages(bool namesOnly);
+
+        //Convert the images from loadImages() to pixmaps, must be called from the GUI thread
+        void createPixmaps(void);
 
         //Loads a custom tileset from the specified file, returns false on failure
         //and displays an error message
@@ -60,6 +69,12 @@ class ImageLoader
         //Each element is a nethack graphic
         std::vector <QPixmap*> imageList;
 
+        //Images read by loadImages(), waiting for createPixmaps()
+        std::vector <QImage*> loadedImages;
+
+        //True if loadFile() should skip the pixels and only read the tile names
+        bool namesOnly;
+
         //Pointer to the global whiteboard, don't delete
         WhiteBoard *whiteBoard;
 
@@ -78,6 +93,9 @@ class ImageLoader
         //load graphics from the specified file
         bool loadFile(const std::string &fileName);
 
+        //Move the images and names loaded by other onto the end of ours
+        void appendImages(ImageLoader &other);
+
         //load the color scheme from the start of the file
         bool loadColors(std::ifstream &infile);
 
@@ -93,7 +111,7 @@ class ImageLoader
                               QImage *oneImage,
                               int yPos);
 
-        //Store the image in the list, and the tile name in nameMap.
+        //Store the image in loadedImages, and the tile name in nameMap.
         //Checks for dual names, like crude dagger / orcish dagger,
         //and creates two entries if required.
         bool storeImage(std::string &tileName,
@@ -0,0 +1,67 @@
+/* DESCRIPTION
+
+  Shows the round trip latency distribution collected by LatencyWidget:
+  p50/p90/p99/max for each time window, and a bar graph of every command
+  since the program started. The statistics can be exported to a text
+  file for comparing servers.
+*/
+
+#ifndef LATENCYFORM_HPP_INCLUDED
+#define LATENCYFORM_HPP_INCLUDED
+
+#include <QDialog>
+#include <iostream>
+#include "ui_LatencyForm.h"
+
+class WhiteBoard;
+class LatencyHistogram;
+
+class LatencyForm : public QDialog
+{
+    Q_OBJECT
+
+    public:
+        //constructor
+        LatencyForm(QWidget* parent,
+                    Qt::WindowFlags flags,
+                    WhiteBoard *newWhiteBoard);
+
+        //destructor
+        ~LatencyForm(void);
+
+        //Width of the longest bar in the distribution graph, in characters
+        static const int MAX_BAR_WIDTH = 50;
+
+    public slots:
+        //Refresh the statistics and show the form
+        void showStats(void);
+
+    private slots:
+        void refreshStats(void);
+        void exportClicked(void);
+        void closeClicked(void);
+
+    private:
+        //Pointer to the global white board, don't delete
+        WhiteBoard *whiteBoard;
+
+        //All of the widgets belonging to the latency form
+        Ui::LatencyDialog gui;
+
+        //############### FUNCTIONS ###############
+
+        //Write one row of the window summary table
+        void writeSummaryRow(std::ostream &out,
+                             const QString &label,
+                             const LatencyHistogram &histogram);
+
+        //Write the summary table for every window, plus the all-time totals
+        void writeSummary(std::ostream &out);
+
+        //Write a bar graph of histogram, one bar per power of two milliseconds
+        void writeBarGraph(std::ostream &out,
+                           const LatencyHistogram &histogram);
+
+};//LatencyForm
+
+#endif // LATENCYFORM_HPP_INCLUDED
@@ -0,0 +1,92 @@
+/* DESCRIPTION
+
+  A fixed-size, log-linear latency histogram in the style of HdrHistogram.
+  Values are recorded in microseconds. Each power of two is split into
+  SUB_BUCKET_HALF linear sub-buckets, so every recorded value is kept with
+  roughly 3% relative precision no matter how large it is, and recording a
+  value never allocates.
+
+  Histograms can be added together, which is how LatencyWidget builds the
+  all-time distribution out of its per-window histograms.
+*/
+
+#ifndef NG_LATENCY_HISTOGRAM
+#define NG_LATENCY_HISTOGRAM
+
+#include <iostream>
+#include <vector>
+#include <QtGlobal>
+
+class LatencyHistogram
+{
+    public:
+        //constructor
+        LatencyHistogram(void);
+
+        //destructor
+        ~LatencyHistogram(void);
+
+        //Record a single latency in microseconds. Negative values are recorded as 0,
+        //values larger than MAX_VALUE are recorded as MAX_VALUE.
+        void recordValue(qint64 value);
+
+        //Add every value recorded in other to this histogram
+        void add(const LatencyHistogram &other);
+
+        //Forget every recorded value
+        void reset(void);
+
+        //Returns the value in microseconds that percentile (0 to 100) of the recorded values
+        //are less than or equal to. Returns 0 if the histogram is empty.
+        qint64 getValueAtPercentile(double percentile) const;
+
+        //Returns the number of recorded values from lowValue up to, but not including,
+        //highValue. Bucket boundaries are approximate, see SUB_BUCKET_BITS.
+        quint64 getCountBetween(qint64 lowValue,
+                                qint64 highValue) const;
+
+        //accessors, all values are in microseconds
+        quint64 getCount(void) const;
+        qint64 getMin(void) const;
+        qint64 getMax(void) const;
+        double getMean(void) const;
+
+        //Write the percentile distribution in the same format as HdrHistogram's
+        //outputPercentileDistribution(), values are written in milliseconds
+        void writeDistribution(std::ostream &out) const;
+
+        //Number of bits of linear precision within each power of two
+        static const int SUB_BUCKET_BITS = 5;
+
+        //Number of sub-buckets in the top half of each power of two
+        static const int SUB_BUCKET_HALF = 1 << SUB_BUCKET_BITS;
+
+        //The largest value we can record, about 71 minutes
+        static const qint64 MAX_VALUE = Q_INT64_C(0xFFFFFFFF);
+
+    private:
+        //Number of recorded values in each bucket
+        std::vector<quint64> counts;
+
+        //Total number of recorded values
+        quint64 totalCount;
+
+        //Exact smallest and largest recorded values
+        qint64 minValue;
+        qint64 maxValue;
+
+        //Sum of all recorded values, used to calculate the mean
+        double valueSum;
+
+        //############### FUNCTIONS ###############
+
+        //Returns the index in counts for value
+        int getCountsIndex(qint64 value) const;
+
+        //Returns the smallest and largest values that map to the bucket at index
+        qint64 lowestValueAt(int index) const;
+        qint64 highestValueAt(int index) const;
+
+};//LatencyHistogram
+
+#endif
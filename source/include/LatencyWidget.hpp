@@ -2,10 +2,14 @@
 #define NG_LATENCY_WIDGET
 
 #include <QLabel>
-#include <QTime>
+#include <QElapsedTimer>
+#include <QDateTime>
 #include <iostream>
+#include <deque>
 #include <QTimer>
 
+#include "LatencyHistogram.hpp"
+
 class WhiteBoard;
 
 class LatencyWidget : public QLabel
@@ -31,9 +35,31 @@ class LatencyWidget : public QLabel
         //Report that the connection has been lost
         void reportDisconnect(void);
 
-        //Report that we've received data from the server
+        //Report that we've received data from the server. Packets less than
+        //REPLY_QUIET_TIME apart are one reply. The first packet of a reply answers every
+        //outstanding command, and the round trip time of the newest one is added to the
+        //histograms. The rest of the reply answers nothing.
         void reportReply(void);
 
+        //Returns the number of completed latency windows, the most recent is the last one
+        int getNumWindows(void);
+
+        //Returns a completed latency window, index 0 is the oldest
+        const LatencyHistogram& getWindow(int index);
+
+        //Returns the wall clock time a window started. An index equal to getNumWindows()
+        //returns the start of the current window.
+        QDateTime getWindowStartTime(int index);
+
+        //Returns the latencies recorded since the current window started
+        const LatencyHistogram& getCurrentWindow(void);
+
+        //Returns every latency recorded since the program started
+        const LatencyHistogram& getTotalHistogram(void);
+
+        //Returns the number of commands that never got a reply within REPLY_TIMEOUT
+        quint64 getNumUnanswered(void);
+
         //Use a running average with this many items to calculate latency
         static const int RUNNING_AVG_SIZE = 5;
 
@@ -42,6 +68,20 @@ class LatencyWidget : public QLabel
         //milliseconds.
         static const int LATENCY_THRESHOLD = 100;
 
+        //Latencies are grouped into windows of this many milliseconds
+        static const int WINDOW_LENGTH = 60000;
+
+        //Keep this many completed windows, older windows are only part of totalHistogram
+        static const int MAX_WINDOWS = 60;
+
+        //Outstanding commands older than this many milliseconds are assumed to have been
+        //answered by an earlier reply, and are dropped without recording a latency
+        static const int REPLY_TIMEOUT = 10000;
+
+        //Packets that arrive less than this many milliseconds after the last one are part
+        //of the same reply, so a reply split over several packets is only measured once
+        static const int REPLY_QUIET_TIME = 50;
+
     public slots:
         //Event handler, called when this widget needs to be redrawn
         void paintEvent(QPaintEvent *event);
@@ -54,8 +94,37 @@ class LatencyWidget : public QLabel
         //Pointer to the global white board, don't delete
         WhiteBoard *whiteBoard;
 
-        //The time of the oldest unanswered command sent to the server
-        QTime commandTime;
+        //Monotonic clock that all command and reply times are measured with
+        QElapsedTimer latencyClock;
+
+        //Send times of the commands that haven't been answered yet, in microseconds since
+        //latencyClock started. The oldest command is at the front.
+        std::deque<qint64> outstandingCommands;
+
+        //When the last packet from the server arrived, in microseconds since
+        //latencyClock started. -1 before the first reply.
+        qint64 lastPacketTime;
+
+        //Latencies recorded since windowStart
+        LatencyHistogram currentWindow;
+
+        //The time the current window started, in milliseconds since latencyClock started
+        qint64 windowStart;
+
+        //The wall clock time the current window started, for display
+        QDateTime windowStartTime;
+
+        //Completed windows, the oldest window is at the front
+        std::deque<LatencyHistogram> windows;
+
+        //The wall clock time each completed window started
+        std::deque<QDateTime> windowStartTimes;
+
+        //Every latency recorded since the program started
+        LatencyHistogram totalHistogram;
+
+        //Number of commands dropped after REPLY_TIMEOUT
+        quint64 numUnanswered;
 
         //Image to display when ebonhack believes the screen is up to date
         QPixmap goImage;
@@ -74,7 +143,7 @@ class LatencyWidget : public QLabel
         //goImage and stopImage
         int textWidth;
 
-        //True if the user sent a command to the server, and is waiting for a reply
+        //True if the user sent a command to the server, and hasn't received any data since
         bool waitingReply;
 
         //############### FUNCTIONS ###############
@@ -82,6 +151,13 @@ class LatencyWidget : public QLabel
         //error message
         bool loadImages(void);
 
+        //If the current window is older than WINDOW_LENGTH, moves it into windows and
+        //starts a new one
+        void rotateWindows(void);
+
+        //Drops outstanding commands older than REPLY_TIMEOUT
+        void expireCommands(void);
+
 };//LatencyWidget
 
 #endif
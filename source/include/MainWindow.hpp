@@ -16,6 +16,8 @@
 #include <QGraphicsScene>
 #include <QSignalMapper>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QRegion>
 #include <QGraphicsTextItem>
 #include "ui_MainWindow.h"
 
@@ -29,8 +31,12 @@ class ZoomForm;
 class NetCursor;
 class TipForm;
 class LatencyWidget;
+class LatencyForm;
+class NotificationForm;
+class TimelineForm;
 class FarmDockWidget;
 class GraphicsSettings;
+class FrameRenderer;
 
 class MainWindow : public QMainWindow
 {
@@ -48,10 +54,27 @@ class MainWindow : public QMainWindow
         //Initialize the game, returns false on failure and couts a message
         bool start(void);
 
-        //Deletes tiles and history log and re-creates them. Used whenever the tileset
-        //changes.
+        //Resize the window to fit the scene at the current zoom and sprite size
+        void fitWindow(void);
+
+        //Scale the graphics view, and the tiles drawn in it, by newZoom
+        void setZoom(double newZoom);
+
+        //The zoom chosen in the zoom form, 1 is normal size
+        double getZoom(void);
+
+        //Render the whole scene into theImage, scaled to fit. Waits for the FrameRenderer
+        //to finish first, if there is one. Used to show the scene without a display.
+        void renderScene(QImage &theImage);
+
+        //Resizes the telnet window and history log in place, and scales the tiles again.
+        //Used whenever the tileset, font or history size changes.
         void resetGraphics(void);
 
+        //Paint the view with OpenGL or Qt's native painter, whichever is chosen in the
+        //graphics settings. Takes effect straight away.
+        void applyViewport(void);
+
         void alertTilesFinished(void);
 
         //Initialize Allegro's graphics, timers and input
@@ -68,6 +91,12 @@ class MainWindow : public QMainWindow
         FarmDockWidget *getFarmingWidget(void);
         GraphicsSettings *getGraphicsSettings(void);
 
+        //Draws the telnet window on a worker thread, NULL if "Threaded Rendering" is off
+        FrameRenderer *getFrameRenderer(void);
+
+        //The scene containing the telnet window and history log
+        QGraphicsScene *getScene(void);
+
         //Pause the cursor and changes it red while waiting for a reply
         void pauseCursor(void);
 
@@ -93,14 +122,27 @@ class MainWindow : public QMainWindow
         static const unsigned int BORDER_WIDTH = 60;
         static const unsigned int BORDER_HEIGHT = 90;
 
+        //The most message history search results to show at once
+        static const unsigned int MAX_SEARCH_RESULTS = 50;
+
+        //Frames per second to paint at if the screen doesn't report its refresh rate
+        static const int DEFAULT_REFRESH_RATE = 60;
+
     private slots:
         void menuCommand(const QString &param);
         void showConnectForm(void);
         void showZoomForm(void);
         void toggleGraphics(bool enableGraphics);
+        void toggleAutoMap(bool enableAutoMap);
         void showManual(void);
         void showTipOfTheDay(void);
         void showGraphicsSettings(void);
+        void showLatencyStats(void);
+        void showNotifications(void);
+        void showTimeline(void);
+        void exportHistory(void);
+        void searchHistory(void);
+        void saveTrace(void);
         void quitClicked(void);
 
         //update the game logic
@@ -112,6 +154,12 @@ class MainWindow : public QMainWindow
         //Causes the telnet cursor to blink in and out
         void blinkCursor(void);
 
+        //Collect the parts of the scene that changed, and schedule a frame to paint them
+        void sceneChanged(const QList<QRectF> &region);
+
+        //Paint everything that changed since the last frame
+        void paintFrame(void);
+
     public slots:
         void zoomFormNewValue(void);
 
@@ -122,6 +170,10 @@ class MainWindow : public QMainWindow
         bool eventFilter(QObject *obj,
                          QEvent *event);
 
+        //Traces repainting the window, the last step between receiving data and
+        //showing it on the screen
+        bool event(QEvent *event);
+
     private:
         //Pointer to the global whiteboard, don't delete
         WhiteBoard *whiteBoard;
@@ -148,6 +200,15 @@ class MainWindow : public QMainWindow
         //Allows the user to choose a custom tileset and set the video mode to OpenGL or Qt
         GraphicsSettings *graphicsSettings;
 
+        //Shows the latency distribution collected by latencyWidget
+        LatencyForm *latencyForm;
+
+        //Shows the warnings and errors logged this session
+        NotificationForm *notificationForm;
+
+        //Shows the telnet window as it was at any point in the last few minutes
+        TimelineForm *timelineForm;
+
         //Zooms the graphicsView in or out. We can't put the zoom box right in the main window,
         //since it requires keyboard focus.
         ZoomForm *zoomForm;
@@ -155,6 +216,9 @@ class MainWindow : public QMainWindow
         //A blinking underscore representing the telnet cursor
         NetCursor *netCursor;
 
+        //Draws the telnet window on a worker thread, NULL if disabled
+        FrameRenderer *frameRenderer;
+
         //Shows a tip-of-the-day message
         TipForm *tipForm;
 
@@ -170,6 +234,22 @@ class MainWindow : public QMainWindow
         //Runs updateLogic every LOGIC_UPDATE_TIME milliseconds
         QTimer logicTimer;
 
+        //Runs paintFrame at most once per display refresh
+        QTimer frameTimer;
+
+        //Time since the last frame was painted
+        QElapsedTimer frameClock;
+
+        //Milliseconds between display refreshes
+        int frameInterval;
+
+        //The parts of the viewport that need painting in the next frame
+        QRegion pendingDamage;
+
+        //True if only the changed parts of the viewport are painted. OpenGL viewports
+        //repaint everything, since their back buffer isn't kept between frames.
+        bool partialUpdates;
+
         //True if we're connected to a nethack server, false otherwise
         bool isConnected;
 
@@ -0,0 +1,65 @@
+/* DESCRIPTION
+
+  Every message line from the top of the telnet window for the whole session.
+  Nethack repeats itself a lot, so each distinct line is stored once and the
+  log itself is a list of 4 byte line IDs. Appending a line is a single hash
+  lookup. Searching checks each distinct line once, no matter how many times
+  it was logged, so any range of the log can be searched or exported quickly.
+*/
+
+#ifndef NG_MESSAGE_LOG
+#define NG_MESSAGE_LOG
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+
+class MessageLog
+{
+    public:
+        //constructor
+        MessageLog(void);
+
+        //destructor
+        ~MessageLog(void);
+
+        //Add a line to the end of the log, trailing spaces are dropped
+        void append(const std::string &line);
+
+        //Returns the number of lines logged this session
+        unsigned int getNumLines(void) const;
+
+        //Returns the number of distinct lines logged this session
+        unsigned int getNumUniqueLines(void) const;
+
+        //Returns a line from the log, counting from 0. Out of range lines are empty.
+        std::string getLine(unsigned int index) const;
+
+        //Adds the index of every line from firstLine up to, but not including, lastLine
+        //that contains text to results
+        void search(const std::string &text,
+                    unsigned int firstLine,
+                    unsigned int lastLine,
+                    std::vector <unsigned int> &results) const;
+
+        //Write lines from firstLine up to, but not including, lastLine to out, one per line
+        void exportLines(std::ostream &out,
+                         unsigned int firstLine,
+                         unsigned int lastLine) const;
+
+    private:
+        //Each distinct line, in the order it was first logged
+        QList <QByteArray> uniqueLines;
+
+        //Maps a line to its index in uniqueLines. The keys share their data with uniqueLines.
+        QHash <QByteArray, quint32> lineIDs;
+
+        //The session log, as indexes into uniqueLines
+        std::vector <quint32> lines;
+
+};//MessageLog
+
+#endif
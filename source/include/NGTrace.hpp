@@ -0,0 +1,85 @@
+/* DESCRIPTION
+
+  Lightweight tracing of the display pipeline, from the socket read to the
+  pixels on screen. Put NG_TRACE_SPAN("name") at the top of a scope to
+  record how long the scope took. Spans are kept in a fixed-size ring
+  buffer, so only the most recent RING_SIZE spans survive, and can be saved
+  as Chrome trace JSON (load it in chrome://tracing or ui.perfetto.dev).
+
+  Tracing is compiled out unless NG_TRACE is defined, build with
+  "qmake CONFIG+=trace" to enable it. When compiled out, NG_TRACE_SPAN
+  expands to nothing.
+*/
+
+#ifndef NG_TRACE_HPP
+#define NG_TRACE_HPP
+
+#ifdef NG_TRACE
+
+#include <string>
+#include <QtGlobal>
+
+//Record a span named name, which must be a string literal, lasting until the end of the scope
+#define NG_TRACE_SPAN(name) NGTraceSpan ngTraceSpan(name)
+
+//A single completed span
+struct NGTraceEvent
+{
+    //Name of the span, always a string literal so we don't have to copy it
+    const char *name;
+
+    //Start time and duration in microseconds
+    qint64 startTime;
+    qint64 duration;
+
+    //Thread that recorded the span
+    quint64 threadID;
+};//NGTraceEvent
+
+class NGTrace
+{
+    public:
+        //Returns the number of microseconds since tracing started
+        static qint64 getTime(void);
+
+        //Add a completed span to the ring buffer, overwriting the oldest span if it's full
+        static void recordSpan(const char *name,
+                               qint64 startTime,
+                               qint64 duration);
+
+        //Write every span in the ring buffer to fileName as Chrome trace JSON,
+        //returns false if the file couldn't be written
+        static bool dumpChromeTrace(const std::string &fileName);
+
+        //Number of spans kept in the ring buffer
+        static const int RING_SIZE = 65536;
+
+        //File the trace is saved to when the program exits
+        static const char *DEFAULT_FILE;
+};//NGTrace
+
+//Records a span from construction to destruction, use NG_TRACE_SPAN instead of creating these directly
+class NGTraceSpan
+{
+    public:
+        //constructor
+        NGTraceSpan(const char *newName);
+
+        //destructor
+        ~NGTraceSpan(void);
+
+    private:
+        //Name of the span
+        const char *name;
+
+        //When the span started, in microseconds
+        qint64 startTime;
+};//NGTraceSpan
+
+#else
+
+#define NG_TRACE_SPAN(name)
+
+#endif
+
+#endif
@@ -1,7 +1,7 @@
 /*  DESCRIPTION
     Represents a single nethack character from the telnet window. Characters are either shown
-    by a graphic (thePixmap) or text (displayText). displayText acts as a buffer for the character,
-    since drawing text to the scene is very slow.
+    by a graphic (thePixmap) or text. Both come from the TileCache, already scaled to the zoom,
+    since drawing text or scaling pixmaps while the scene is painted is very slow.
 */
 
 
@@ -38,21 +38,26 @@ class NetSprite: public QGraphicsRectItem
                    const QStyleOptionGraphicsItem *option,
                    QWidget *widget);
 
-        //Sets the telnet character to the newValue and SGR attributes
+        //Sets the telnet character to the newValue and SGR attributes. newTile is the tile
+        //the server sent with the character, or NO_TILE to look the character up ourselves.
         void setChar(uint8_t newValue,
-                     SGRAttribute *writeAttributes);
+                     SGRAttribute *writeAttributes,
+                     int newTile);
+
+        //Move the sprite to a different row of the telnet window, in character coordinates
+        void setRow(int newYPos);
+
+        //Move the sprite to newYPos and resize it, use when the sprite size changes
+        void updateGeometry(int newYPos);
 
         //Set graphicsOn to true if we should display the graphic for this telnet character.
         //The character will still be displayed if there is no image for it.
         void setGraphicsMode(bool graphicsOn);
 
-        //returns true if the telnet character has been written to since the last
-        //call to getIsChanged()
-        bool getIsChanged(void);
-
         //Accessors
         uint8_t getChar(void);
         SGRAttribute* getAttributes(void);
+        int getServerTile(void);
 
         //Event handlers for mouse presses and releases
         void mousePressEvent(QGraphicsSceneMouseEvent *event);
@@ -61,10 +66,20 @@ class NetSprite: public QGraphicsRectItem
         //Returns the bounding rectangle for this item
         QRectF boundingRect(void);
 
-        //Inform the sprite that the graphic for this character has changed.
-        //Schedules a redraw.
+        //Inform the sprite that the graphic for this character has changed, say because
+        //the tileset changed. Schedules a redraw.
         void changeDisplayGraphic(void);
 
+        //If newOffscreen is true the sprite doesn't paint itself, and reports changes to
+        //the FrameRenderer instead
+        void setOffscreen(bool newOffscreen);
+
+        //The tile being shown, or NULL if the character is shown instead
+        QPixmap* getDisplayedTile(void);
+
+        //The server didn't send a tile with the character
+        const static int NO_TILE = -1;
+
         //Center text characters in the pixmap
         const static int CHAR_X_OFFSET = -1;
         const static int CHAR_Y_OFFSET = -4;
@@ -82,12 +97,13 @@ class NetSprite: public QGraphicsRectItem
         //A pointer to the sprite's graphic, don't delete.
         QPixmap *thePixmap;
 
-        //QString version of the telnet character
-        QPixmap displayText;
-
         //The telnet character
         uint8_t telnetChar;
 
+        //The tile the server sent when the character was written, NO_TILE if none. Kept
+        //so the graphic can be found again later, whatever state the parser is in by then.
+        int serverTile;
+
         //The dimensions of the sprite in pixels
         unsigned int spriteWidth;
         unsigned int spriteHeight;
@@ -96,10 +112,6 @@ class NetSprite: public QGraphicsRectItem
         int xPos;
         int yPos;
 
-        //True if the telnet character or its attributes changed since
-        //getIsChanged() was called
-        bool isChanged;
-
         //True if we have a graphic for this character, false otherwise
         bool haveGraphic;
 
@@ -110,14 +122,21 @@ class NetSprite: public QGraphicsRectItem
         //delete them
         bool addedToScene;
 
+        //True if the FrameRenderer draws this sprite
+        bool offscreen;
+
         //############### FUNCTIONS ###############
 
-        //Draws the telnet character onto displayText
+        //Inform the sprite that the telnet character has changed, schedules a redraw
         void changeDisplayChar(void);
 
         //Indicate that the sprite contents have changed and should be redrawn
         void requestRedraw(void);
 
+        //Redraw offscreen sprites when they move or are shown
+        QVariant itemChange(GraphicsItemChange change,
+                            const QVariant &value);
+
 };//class NetSprite
 
 #endif // NETSPRITE_HPP_INCLUDED
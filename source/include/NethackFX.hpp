@@ -3,6 +3,10 @@
     should be represented by graphics, and which parts should be
     represented by text. Tries to map unknown telnet characters to
     graphics loaded from file.
+
+    The sprites, the known character mappings and the graphics rules are loaded in
+    the background, so the window can show text straight away. finishLoading() swaps
+    the tiles in once everything has loaded.
 */
 
 #ifndef NG_NETHACK_FX
@@ -12,16 +16,21 @@
 #include <fstream>
 #include <sstream>
 #include <QTime>
+#include <QFuture>
 #include <vector>
+#include <set>
 
 #include "TelnetWindow.hpp"
 #include "CharSaver.hpp"
 #include "RuleLoader.hpp"
 #include "ImageLoader.hpp"
+#include "RowWatcher.hpp"
 
 class ImageLoader;
+class TileCache;
 class WhiteBoard;
 class HistoryLog;
+class MessageLog;
 
 //States in the FSM. These are intended for communicating with the server
 enum NGF_State
@@ -37,7 +46,7 @@ enum NGF_State
     NGF_RESET
 };//NGF_State
 
-class NethackFX
+class NethackFX : public RowWatcher
 {
     public:
         //constructor
@@ -46,16 +55,26 @@ class NethackFX
         //destructor
         ~NethackFX(void);
 
-        //Initialize the graphics
+        //Initialize the graphics, and start loading the graphics files in the background
         bool initialize(TelnetWindow *newWindow);
 
+        //Once the graphics files have loaded, create the tiles and show them. Waits for the
+        //files if wait is true, otherwise returns straight away if they aren't loaded yet.
+        //Returns false if the files couldn't be loaded.
+        bool finishLoading(bool wait);
+
         //save knownChars to file
         void save(void);
 
-        //Should be called when the telnet window's contents change.
-        void updateLogic(TelnetWindow *theWindow);
+        //Called by the telnet window when the first line, the second line, or the
+        //bottom of the gravestone changes
+        void rowChanged(int watchID,
+                        uint8_t row,
+                        const std::string &rowText,
+                        bool matched);
 
-        //Handle 'what is' queries to the server. Needs to be called periodically.
+        //Handle 'what is' queries to the server, and sync learned mappings to disk.
+        //Needs to be called periodically.
         void updateQuery(void);
 
         //Send a what is command to the server at the specified location in the telnet window
@@ -84,12 +103,33 @@ class NethackFX
         //Display the window contents in the graphics scene
         void setGraphicsScene(QGraphicsScene *newScene);
 
-        //Deletes and re-creates the history log, use when a new tileset is chosen
-        void resetHistoryLog(QGraphicsScene *newScene);
+        //Resizes the history log in place, use when a new tileset or history size is chosen
+        void resizeHistoryLog(void);
 
         //Mutator
         void setUserFX(bool active);
 
+        //True if we're currently displaying graphics
+        bool getShowGraphics(void);
+
+        //Every message line from the top of the telnet window this session
+        MessageLog* getMessageLog(void);
+
+        //True once the graphics files have loaded and the tiles have been created
+        bool getAssetsReady(void);
+
+        //Turn background mapping of unknown characters on or off
+        void setAutoMap(bool newAutoMap);
+
+        //Scale the tiles and characters for the graphics view's new zoom
+        void setZoom(double newZoom);
+
+        //Scale the tiles and characters again, use when the tileset or font changes
+        void resetTileCache(void);
+
+        //The tiles and characters scaled for the current zoom
+        TileCache* getTileCache(void);
+
         //The first row of nethack map, should be drawn in sprites
         static const int FIRST_FX_ROW = 1;
 
@@ -105,6 +145,13 @@ class NethackFX
         //Time in milliseconds to wait for a reply from the server
         static const int REPLY_GRACETIME = 5000;
 
+        //The game must be idle for this many milliseconds before we map a character
+        //in the background...
+        static const int AUTO_MAP_IDLE_TIME = 3000;
+
+        //...and we'll map at most one character every this many milliseconds
+        static const int AUTO_MAP_INTERVAL = 2000;
+
   private:
         //Map character+color to an index containing the corresponding graphic
         //Shows users their recent history
@@ -123,12 +170,18 @@ class NethackFX
         //Each line in the history is a copy of the first line in the telnet window.
         HistoryLog *userHistory;
 
+        //Every line added to userHistory this session. Kept when the history log is re-created.
+        MessageLog *messageLog;
+
         //Pointer to the graphics scene containing the history log, don't delete
         QGraphicsScene *theScene;
 
         //Loads sprites from file
         ImageLoader *spriteHandler;
 
+        //Copies of the sprites and text characters scaled to the current zoom
+        TileCache *tileCache;
+
         //A 2D array of telnet characters, just a pointer don't delete
         TelnetWindow *theWindow;
 
@@ -168,11 +221,53 @@ class NethackFX
         //false if we're sending a simple 'what is' query for the user
         bool mappingChar;
 
+        //True if we should map unknown characters in the background, without the user
+        //clicking on them
+        bool autoMap;
+
+        //True if the current query was started by the background mapper, so it
+        //shouldn't bother the user if it fails
+        bool autoMapping;
+
+        //Character+color keys the background mapper has already asked about this session
+        std::set <std::string> autoMapTried;
+
+        //Limits how often the background mapper sends queries
+        QTime autoMapTimer;
+
         //False if there's a --More-- on the second line
         bool secondLineFX;
 
+        //IDs of our row watches in the telnet window
+        int firstLineWatch;
+        int moreWatch;
+        int graveWatch;
+
+        //Results of the background loads started by initialize()
+        QFuture<bool> imagesLoaded;
+        QFuture<bool> charsLoaded;
+        QFuture<bool> rulesLoaded;
+
+        //The custom tileset to load once the tile names are known, empty for the default tiles
+        QString customTileset;
+
+        //True once finishLoading() has created the tiles. Until then the background loads own
+        //spriteHandler, charHandler, ruleHandler and knownChars, so we mustn't touch them.
+        bool assetsReady;
+
         //*************** Functions ***************
 
+        //Load known char-to-sprite mappings on a worker thread
+        static bool loadKnownChars(CharSaver *theSaver,
+                                   std::string pathAndName,
+                                   std::map <std::string, int> *theChars);
+
+        //Wait for the background loads to finish, without using their results
+        void waitForLoading(void);
+
+        //If the game is idle, start a query for the first unknown character on the map
+        void updateAutoMap(void);
+
         //send cursor directions to the server as part of a what is? command
         void sendDirections(void);
 
@@ -203,11 +298,14 @@ class NethackFX
         bool addMapping(std::string theKey,
                         std::string theName);
 
+        //Check the graphics rules when the first line changes
+        void handleFirstLine(void);
+
         //Disable graphics on the second line if it contains a --More--
-        void handleExtendedMore(TelnetWindow *theWindow);
+        void handleExtendedMore(bool foundMore);
 
         //Disable graphics when the character dies
-        void handleGravestone(TelnetWindow *theWindow);
+        void handleGravestone(bool foundGrave);
 
 };//NethackFX
 
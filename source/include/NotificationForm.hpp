@@ -0,0 +1,46 @@
+/* DESCRIPTION
+
+  Shows the log kept by the NotificationQueue: every warning and error this
+  session, with repeats counted rather than listed. Follows the log while open.
+*/
+
+#ifndef NOTIFICATIONFORM_HPP_INCLUDED
+#define NOTIFICATIONFORM_HPP_INCLUDED
+
+#include <QDialog>
+#include "ui_NotificationForm.h"
+
+class WhiteBoard;
+
+class NotificationForm : public QDialog
+{
+    Q_OBJECT
+
+    public:
+        //constructor
+        NotificationForm(QWidget* parent,
+                         Qt::WindowFlags flags,
+                         WhiteBoard *newWhiteBoard);
+
+        //destructor
+        ~NotificationForm(void);
+
+    public slots:
+        //Refresh the log and show the form
+        void showLog(void);
+
+    private slots:
+        void refreshLog(void);
+        void clearClicked(void);
+        void closeClicked(void);
+
+    private:
+        //Pointer to the global white board, don't delete
+        WhiteBoard *whiteBoard;
+
+        //All of the widgets belonging to the notification form
+        Ui::NotificationDialog gui;
+
+};//NotificationForm
+
+#endif // NOTIFICATIONFORM_HPP_INCLUDED
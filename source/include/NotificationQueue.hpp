@@ -0,0 +1,100 @@
+/* DESCRIPTION
+
+  Collects warnings and errors from code that can't stop to show a dialog, like the
+  telnet parser or the farming bot. post() only records the message, and a timer
+  shows it once control is back in the event loop, so nothing ever waits on a pop up.
+
+  Each message has a key naming the condition. A condition is logged at most once
+  every RATE_LIMIT_TIME milliseconds, repeats in between are counted and reported with
+  the next log entry. Conditions posted with popup set are also shown in the
+  MessageForm, but only the first time. The log can be read in the notification form.
+*/
+
+#ifndef NG_NOTIFICATION_QUEUE
+#define NG_NOTIFICATION_QUEUE
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QTimer>
+#include <QElapsedTimer>
+
+class WhiteBoard;
+
+//Everything we know about one condition
+struct NGNotification
+{
+    //The most recent message posted for the condition
+    QString message;
+
+    //True if the message should pop up the first time it's logged
+    bool popup;
+
+    //True once the message has popped up
+    bool shown;
+
+    //Times posted since it was last logged, and times posted this session
+    unsigned int pending;
+    unsigned int total;
+
+    //Time since the condition was last logged
+    QElapsedTimer lastLogged;
+};//NGNotification
+
+class NotificationQueue : public QObject
+{
+    Q_OBJECT
+
+    public:
+        //constructor
+        NotificationQueue(WhiteBoard *newWhiteBoard);
+
+        //destructor
+        ~NotificationQueue(void);
+
+        //Report theMessage under the condition theKey. Returns straight away, the message
+        //is logged and popped up later from the event loop. Safe to call while parsing.
+        void post(const QString &theKey,
+                  const QString &theMessage,
+                  bool popup);
+
+        //Every entry logged this session, oldest first, at most MAX_LOG_LINES
+        const QStringList& getLog(void);
+
+        //Forget the logged entries, the repeat counts are kept
+        void clearLog(void);
+
+        //Milliseconds between log entries for the same condition
+        static const int RATE_LIMIT_TIME = 5000;
+
+        //Milliseconds to wait after a post before logging, so a burst is logged together
+        static const int FLUSH_DELAY = 100;
+
+        //The most entries to keep in the log
+        static const int MAX_LOG_LINES = 500;
+
+    signals:
+        //Emitted when entries are added to the log
+        void logChanged(void);
+
+    private slots:
+        //Log and pop up the conditions that are due
+        void flush(void);
+
+    private:
+        //Pointer to the global whiteboard, don't delete
+        WhiteBoard *whiteBoard;
+
+        //Every condition posted this session
+        QHash <QString, NGNotification> conditions;
+
+        //The log entries, oldest first
+        QStringList logLines;
+
+        //Runs flush() once the event loop is running again
+        QTimer flushTimer;
+
+};//NotificationQueue
+
+#endif
@@ -0,0 +1,47 @@
+/* DESCRIPTION
+
+  Times how long it takes to show a recorded session. Every batch of server data
+  in the session is parsed into the telnet window and the whole scene is rendered
+  to an offscreen image, at several zoom levels with the default tiles and with a
+  custom tile sheet. Started with --benchmark-render, and runs without a display
+  under QT_QPA_PLATFORM=offscreen.
+
+  Sessions are recorded by turning on "Record Session" in game_config.txt and
+  playing normally, see TelnetProtocol::SESSION_FILE.
+*/
+
+#ifndef NG_RENDER_BENCHMARK
+#define NG_RENDER_BENCHMARK
+
+#include <string>
+#include <vector>
+#include <QByteArray>
+
+class WhiteBoard;
+
+class RenderBenchmark
+{
+    public:
+        //Replay sessionFile at each zoom level and tileset, and cout the frame rate,
+        //average and 99th percentile frame times and pixmaps created per frame.
+        //Returns false if the session or the tiles couldn't be loaded.
+        static bool run(WhiteBoard *whiteBoard,
+                        const std::string &sessionFile);
+
+        //The zoom levels to time, in percent
+        static const int NUM_ZOOMS = 4;
+        static const int ZOOM_LEVELS[NUM_ZOOMS];
+
+        //The custom tile sheet to time, in the data directory
+        static const std::string CUSTOM_TILESET;
+
+    private:
+        //Replay theSession once at zoomPercent and cout the results
+        static void timeSession(WhiteBoard *whiteBoard,
+                                const std::vector <QByteArray> &theSession,
+                                const std::string &tilesetName,
+                                int zoomPercent);
+
+};//RenderBenchmark
+
+#endif
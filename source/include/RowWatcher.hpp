@@ -0,0 +1,32 @@
+/* DESCRIPTION
+
+  Interface for anything that needs to know when rows of the telnet window
+  change. Register with TelnetWindow::addRowWatch(), and rowChanged() will
+  be called once per changed row after each batch of server data, instead
+  of re-reading the whole window every time anything changes.
+*/
+
+#ifndef NG_ROW_WATCHER
+#define NG_ROW_WATCHER
+
+#include <string>
+#include <stdint.h>
+
+class RowWatcher
+{
+    public:
+        //destructor
+        virtual ~RowWatcher(void) {}
+
+        //Called when a watched row was written to since the last batch of server data.
+        //watchID is the value returned by addRowWatch(), rowText is the row's contents, and
+        //matched is true if rowText contains the watch's pattern. Watches without a
+        //pattern are always matched.
+        virtual void rowChanged(int watchID,
+                                uint8_t row,
+                                const std::string &rowText,
+                                bool matched) = 0;
+
+};//RowWatcher
+
+#endif
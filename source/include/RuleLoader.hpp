@@ -3,6 +3,10 @@
   Used because text menus overlap onto the game area, for example the player's inventory.
   Whenever an inventory is displayed, we want to disable graphics so the inventory shows
   up as text. Same for any other menu.
+
+  Once loaded, the rules are compiled into a single regular expression. Each rule is an
+  alternative inside a lookahead, so the first rule in file order that matches anywhere
+  in the line wins, exactly as if the rules were checked one at a time.
 */
 
 #ifndef NG_RULE_LOADER
@@ -12,6 +16,7 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <QRegularExpression>
 
 #include "FXRule.hpp"
 
@@ -38,6 +43,18 @@ class RuleLoader
         bool checkActions(const std::string &firstLine,
                           bool &useGraphics);
 
+        //Time checkActions() against every line in corpusFile, using the compiled matcher
+        //and checking the rules one at a time. Couts the results, returns false if the
+        //files couldn't be loaded or the two methods disagree.
+        static bool benchmark(const std::string &rulesFile,
+                              const std::string &corpusFile);
+
+        //Number of times benchmark() runs through the corpus
+        static const int BENCHMARK_PASSES = 2000;
+
+        //Corpus lines are padded to this width, the same as the telnet window's first line
+        static const unsigned int FIRST_LINE_WIDTH = 80;
+
     private:
         //A list of rules that we've loaded from file
         std::vector <FXRule*> theRules;
@@ -52,6 +69,16 @@ class RuleLoader
         //are errors we can output the line number
         int lineNumber;
 
+        //Every rule in theRules combined into one expression
+        QRegularExpression combinedRules;
+
+        //The capture group in combinedRules that is set when the matching rule
+        //at the same index in theRules is satisfied
+        std::vector <int> ruleGroups;
+
+        //True if combinedRules is valid, otherwise we check the rules one at a time
+        bool useCombined;
+
         //*************** Functions ***************
 
         //Reset the FSM variables, should be called before opening a new file
@@ -67,6 +94,16 @@ class RuleLoader
                         std::string &theCommand,
                         std::string &theParameter);
 
+        //Build combinedRules out of theRules. If the rules can't be combined, couts
+        //a message and sets useCombined to false.
+        void compileRules(void);
+
+        //Returns the index of the first rule that matches firstLine, or -1 if none match
+        int findRule(const std::string &firstLine);
+
+        //Same as findRule(), but checks each rule separately
+        int findRuleSequential(const std::string &firstLine);
+
 };//RuleLoader
 
 #endif
@@ -0,0 +1,175 @@
+/* DESCRIPTION
+
+  Keeps the last few minutes of the telnet window in memory, so the screens
+  before a farming abort or a display glitch can be looked at afterwards. Each
+  batch of server data adds a frame: either a keyframe holding every cell, or
+  the cells the batch changed, taken from the ChangeJournal. A keyframe is taken
+  every KEYFRAME_INTERVAL frames, or when a batch changes most of the screen.
+
+  The oldest frames are dropped, a keyframe at a time, once the timeline grows past
+  "Timeline Size" in game_config.txt. getScreen() rebuilds the screen at any frame
+  still kept from the keyframe before it, so it only applies the changes since then.
+
+  Frames are numbered from the start of the session, so a frame number stays valid
+  until the frame is dropped.
+*/
+
+#ifndef NG_SCREEN_TIMELINE
+#define NG_SCREEN_TIMELINE
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <stdint.h>
+#include <QElapsedTimer>
+
+class TelnetWindow;
+class ChangeJournal;
+
+//One cell of the telnet window, as it was written
+struct NGTimelineCell
+{
+    uint8_t telnetChar;
+
+    //NGS_Attribute colors
+    uint8_t foreground;
+    uint8_t background;
+
+    //ScreenTimeline::BOLD_FLAG and the other style flags
+    uint8_t style;
+
+    //The tile the server sent, or NetSprite::NO_TILE
+    int serverTile;
+};//NGTimelineCell
+
+//A cell that changed in one frame, index is y * width + x
+struct NGTimelineChange
+{
+    uint16_t index;
+    NGTimelineCell cell;
+};//NGTimelineChange
+
+//Everything recorded for one batch of server data
+struct NGTimelineFrame
+{
+    //Milliseconds since the timeline started
+    qint64 time;
+
+    //True if cells holds the whole screen, false if changes holds what this batch changed
+    bool keyframe;
+    std::vector <NGTimelineCell> cells;
+    std::vector <NGTimelineChange> changes;
+
+    //Size of the window, and where the cursor was at the end of the batch
+    uint8_t width;
+    uint8_t height;
+    uint8_t cursorX;
+    uint8_t cursorY;
+};//NGTimelineFrame
+
+//The whole telnet window at one frame
+struct NGTimelineScreen
+{
+    unsigned int frameNumber;
+    qint64 time;
+    uint8_t width;
+    uint8_t height;
+    uint8_t cursorX;
+    uint8_t cursorY;
+
+    //Every cell, one row after another
+    std::vector <NGTimelineCell> cells;
+};//NGTimelineScreen
+
+class ScreenTimeline
+{
+    public:
+        //constructor
+        ScreenTimeline(void);
+
+        //destructor
+        ~ScreenTimeline(void);
+
+        //Add a frame for the batch described by theJournal. Reads the changed cells from
+        //theWindow. Should be called once per batch, after the journal is published.
+        void record(TelnetWindow *theWindow,
+                    const ChangeJournal &theJournal);
+
+        //False if "Timeline Size" is 0
+        bool getEnabled(void);
+
+        //The number of frames kept, and the numbers of the oldest and newest ones.
+        //Only use getLastFrame() if getNumFrames() isn't 0.
+        unsigned int getNumFrames(void);
+        unsigned int getFirstFrame(void);
+        unsigned int getLastFrame(void);
+
+        //Milliseconds since the timeline started, at the end of frameNumber and now
+        qint64 getFrameTime(unsigned int frameNumber);
+        qint64 getCurrentTime(void);
+
+        //The newest frame recorded at or before time, or getFirstFrame() if they're all later
+        unsigned int findFrame(qint64 time);
+
+        //Rebuild the screen at frameNumber into theScreen. Returns false if the frame
+        //has been dropped or not recorded yet.
+        bool getScreen(unsigned int frameNumber,
+                       NGTimelineScreen &theScreen);
+
+        //The characters in one row of theScreen
+        static std::string getRowText(const NGTimelineScreen &theScreen,
+                                      uint8_t row);
+
+        //Approximate memory used by the kept frames, in bytes
+        qint64 getMemoryUsed(void);
+
+        //Frames between keyframes
+        static const unsigned int KEYFRAME_INTERVAL = 200;
+
+        //Values for NGTimelineCell::style
+        static const uint8_t BOLD_FLAG = 1;
+        static const uint8_t UNDERLINED_FLAG = 2;
+        static const uint8_t INVERSE_FLAG = 4;
+        static const uint8_t INVISIBLE_FLAG = 8;
+
+    private:
+        //The kept frames, oldest first
+        std::deque <NGTimelineFrame> frames;
+
+        //The frame number of frames.front()
+        unsigned int firstFrame;
+
+        //Frames recorded since the last keyframe
+        unsigned int sinceKeyframe;
+
+        //The batch number of the last recorded journal
+        unsigned int lastBatch;
+
+        //Size of the window the last frame was recorded from
+        uint8_t windowWidth;
+        uint8_t windowHeight;
+
+        //Approximate memory used by frames, and the most it may use, in bytes
+        qint64 bytesUsed;
+        qint64 maxBytes;
+
+        //Started when the timeline is created
+        QElapsedTimer clock;
+
+        //############### FUNCTIONS ###############
+
+        //Copy one cell out of theWindow
+        static NGTimelineCell readCell(TelnetWindow *theWindow,
+                                       uint8_t x,
+                                       uint8_t y);
+
+        //Approximate memory used by one frame
+        static qint64 frameBytes(const NGTimelineFrame &theFrame);
+
+        //Drop the oldest keyframe and the frames that depend on it, until we're within
+        //maxBytes. The newest keyframe is always kept.
+        void trimFrames(void);
+
+};//ScreenTimeline
+
+#endif
@@ -18,8 +18,13 @@
 #define NG_TELNET_PROTOCOL
 
 #include <string>
+#include <vector>
 #include <fstream>
 #include <QTcpSocket>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QDataStream>
 
 #include "DisplayRow.hpp"
 #include "XtermEscape.hpp"
@@ -57,7 +62,10 @@ enum NGT_Control
     NGTC_NOP =                     0,  //do nothing? may be a request for feedback?
     NGTC_BELL =                    7,  //produce an audible or visible signal
     NGTC_BS =                      8,  //backspace, move cursor one to the left
+    NGTC_TAB =                     9,  //horizontal tab, move cursor to the next tab stop
     NGTC_LF =                     10,  //line feed, move down one line, stay in same column
+    NGTC_VT =                     11,  //vertical tab, treated as a line feed
+    NGTC_FF =                     12,  //form feed, treated as a line feed
     NGTC_CR =                     13,  //carriage return, move cursor to start of current line
     NGTC_SHIFT_OUT =              14,  //shift out,
     NGTC_SHIFT_IN =               15,  //shift in, return to previous character meaning?
@@ -77,7 +85,7 @@ enum NGT_States
 {
     NGTS_DISCONNECTED, NGTS_START, NGTS_ERROR, NGTS_IAC,
     NGTS_IAC_DO, NGTS_IAC_SB, NGTS_IAC_WILL, NGTS_IAC_DONT,
-    NGTS_ESC, NGTS_IAC_SB_TERMSPEED, NGTS_IAC_SB_XDISPLOC, NGTS_IAC_SB_NEWENVIRON,
+    NGTS_IAC_SB_TERMSPEED, NGTS_IAC_SB_XDISPLOC, NGTS_IAC_SB_NEWENVIRON,
     NGTS_IAC_SB_TERMTYPE, NGTS_IAC_SB_TOGGLEFLOW
 };//NGTP_States
 
@@ -111,22 +119,38 @@ class TelnetProtocol : public QObject
         SGRAttribute* getAttributes(uint8_t xPos,
                                     uint8_t yPos);
 
-        //True if the telnet window contents have changed since the last time getDisplayChanged()
-        //was called.
-        bool getDisplayChanged(void);
+        //Send one logical command (one or more keystrokes) to the server. IAC bytes are
+        //escaped, and the latency widget gets a single report for the whole command.
+        //The data is queued and written to the socket once per event loop iteration.
+        void sendBytes(const QByteArray &keystrokes);
 
-        //Send the keyboard command to the server
-        void sendKeystroke(uint8_t keyType);
-        void sendCommand(const QString &command);
         //accessors
         uint8_t getWidth(void);
         uint8_t getHeight(void);
         TelnetWindow *getTelnetWindow(void);
         XtermEscape *getEscHandler(void);
 
-        //Show a message that the client got telnet data outside of the window bounds.
-        //Probably due to viewing a game with a large window.
-        void showBoundsDialog(void);
+        //True unless we've been disconnected from the server
+        bool getConnected(void);
+
+        //Milliseconds since we last sent a command to or received data from the server
+        qint64 getIdleTime(void);
+
+        //Reset the FSMs as if we'd just connected, before replaying a recorded session
+        void startReplay(void);
+
+        //Load every batch from a session recorded to SESSION_FILE. Returns false if the
+        //file couldn't be read or is empty, and couts a message.
+        static bool loadSession(const std::string &sessionFile,
+                                std::vector <QByteArray> &theSession);
+
+        //Run the FSM over a batch of data from the server, then show the changes.
+        //Also used to replay recorded sessions.
+        void parseData(const QByteArray &serverData);
+
+        //Report that the client got telnet data outside of the window bounds, through the
+        //notification queue. Probably due to viewing a game with a large window.
+        void reportOutOfBounds(void);
 
         //Dimensions of the telnet window, in characters
         static const int WINDOW_WIDTH = 80;
@@ -135,6 +159,10 @@ class TelnetProtocol : public QObject
         //We'll try to send data to the server at this interval, in milliseconds
         static const int SEND_INTERVAL = 50;
 
+        //If "Record Session" is on, everything the server sends is saved to this file
+        //in the data directory, one QByteArray per batch
+        static const std::string SESSION_FILE;
+
     private slots:
         //Run the Finite State Machine for accepting Telnet commands and data
         //Event handler for received data
@@ -147,6 +175,10 @@ class TelnetProtocol : public QObject
         //sendTimer
         void sendData(void);
 
+        //Sends everything queued during this event loop iteration, called by the
+        //single shot timer started in scheduleFlush()
+        void flushSendQueue(void);
+
     private:
         //Pointer to the global whiteboard, don't delete
         WhiteBoard *whiteBoard;
@@ -176,6 +208,12 @@ class TelnetProtocol : public QObject
         //Periodically try to send data
         QTimer sendTimer;
 
+        //Restarted whenever data is sent or received, see getIdleTime()
+        QElapsedTimer activityTimer;
+
+        //True if a flush of sendQueue has been scheduled for the next event loop iteration
+        bool flushPending;
+
         //Messages with more than 3 bytes of data are accepted using a separate sub-FSM for
         //each. subState is our current state in this sub-FSM.
         int subState;
@@ -198,21 +236,24 @@ class TelnetProtocol : public QObject
         //True if we should output verbose debugging messages
         bool debugMessages;
 
-        //True if we should show an error dialog when the FSM runs into errors.
-        //Ensures the dialog only pops up once.
-        bool showError;
+        //Records the session to SESSION_FILE, not open unless "Record Session" is on
+        QFile sessionFile;
+        QDataStream sessionStream;
 
         //*************** FUNCTIONS ***************
 
-        //Adds theData to the sendQueue and tries to send it immediately.
+        //Adds theData to the sendQueue and schedules a flush.
         //If all data couldn't be sent on the first try, periodically tries again until
         //the data is sent.
         void repeatSend(const QByteArray &theData);
 
+        //Makes sure sendQueue is written to the socket once control returns to the event
+        //loop. Multiple calls before then only result in a single write.
+        void scheduleFlush(void);
+
         //One function for each state in the FSM
         void runStart(void);
         void runIAC(void);
-        void runESC(void);
         void runIACDo(void);
         void runIACSB(void);
         void runIACWill(void);
@@ -223,8 +264,8 @@ class TelnetProtocol : public QObject
         void runIACSBTermType(void);
         void runIACSBToggleFlow(void);
 
-        //Inform the user that we received an unknown message
-        void showErrorDialog(const QByteArray &serverData);
+        //Inform the user that we received an unknown message, through the notification queue
+        void reportUnknownMessage(const QByteArray &serverData);
 
 };//TelnetProtocol
 
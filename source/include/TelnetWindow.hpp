@@ -9,12 +9,35 @@
 #define NG_TELNET_WINDOW
 
 #include <vector>
+#include <string>
 #include <QGraphicsScene>
+#include <QHash>
 
 #include "DisplayRow.hpp"
 #include "SGRAttribute.hpp"
+#include "RowWatcher.hpp"
+#include "ChangeJournal.hpp"
+#include "ScreenTimeline.hpp"
 
 class WhiteBoard;
+class NetSprite;
+
+//A range of rows that a RowWatcher is interested in
+struct NGRowWatch
+{
+    //Who to notify, just a pointer don't delete
+    RowWatcher *watcher;
+
+    //Identifies this watch to the watcher
+    int watchID;
+
+    //The first row to watch, and the number of rows
+    uint8_t topRow;
+    uint8_t numRows;
+
+    //rowChanged() reports whether the row contains this text, empty to always match
+    std::string pattern;
+};//NGRowWatch
 
 class TelnetWindow
 {
@@ -29,8 +52,13 @@ class TelnetWindow
         bool initialize(uint8_t newWidth,
                         uint8_t newHeight);
 
-        //Resets the telnet window, should be called when a new tileset is chosen.
-        void resetWindow(QGraphicsScene *newScene);
+        //Display the window contents in the graphics scene
+        void setGraphicsScene(QGraphicsScene *newScene);
+
+        //Resize and move every sprite for the current sprite size and history size, and
+        //look up their tiles again. Should be called when the tileset, font or history
+        //size changes.
+        void updateGeometry(void);
 
         //return the character at the specified location
         uint8_t getByte(uint8_t xPos,
@@ -57,9 +85,36 @@ class TelnetWindow
         //Run the 'delete characters' command - erase numDelete to the right of the cursor?
         void deleteCharacters(int numDelete);
 
-        //Run the 'delete lines' command
+        //Run the 'delete lines' command, rows below the cursor in the scrolling region move up
         void deleteLines(int numDelete);
 
+        //Run the 'insert lines' command, rows below the cursor in the scrolling region move down
+        void insertLines(int numInsert);
+
+        //Scroll the contents of the scrolling region up or down, exposing blank rows
+        void scrollUp(int numLines);
+        void scrollDown(int numLines);
+
+        //Move the cursor down one row, scrolling up if it's on the bottom of the scrolling region
+        void index(void);
+
+        //Move the cursor up one row, scrolling down if it's on the top of the scrolling region
+        void reverseIndex(void);
+
+        //Switch between the normal and alternate screen buffers. Only the pointers are swapped,
+        //the other buffer keeps its contents. If clearAlternate is true the alternate buffer
+        //is blanked before the switch.
+        void useAlternateBuffer(bool useAlternate,
+                                bool clearAlternate);
+
+        //Returns true if the alternate screen buffer is displayed
+        bool getUsingAlternateBuffer(void);
+
+        //Set the rows that scroll, numbered from 1 like setCursorY(). 0 means the top or
+        //bottom of the window. Moves the cursor to the top left.
+        void setScrollRegion(uint8_t newTop,
+                             uint8_t newBottom);
+
         //accessors
         uint8_t getWidth(void);
         uint8_t getHeight(void);
@@ -96,14 +151,6 @@ class TelnetWindow
         void setForeground(NGS_Attribute color);
         void setBackground(NGS_Attribute color);
 
-        //True if the telnet window contents have changed since the last time getDisplayChanged()
-        //was called.
-        bool getDisplayChanged(void);
-
-        //returns true if the telnet or its attributes changed since charChanged was called
-        bool charChanged(uint8_t x,
-                         uint8_t y);
-
         //Enables or disables graphics for the specified rows from the telnet window
         void setGraphicsMode(bool useGraphics,
                              uint8_t topRow,
@@ -114,10 +161,72 @@ class TelnetWindow
         void notifyFxChange(int x,
                             int y);
 
+        //Call watcher->rowChanged() whenever a row from topRow to topRow + numRows - 1
+        //changes. Watches are notified in the order they were added. Returns an ID
+        //that's passed to rowChanged(), so one watcher can tell its watches apart.
+        int addRowWatch(RowWatcher *watcher,
+                        uint8_t topRow,
+                        uint8_t numRows,
+                        const std::string &pattern);
+
+        //Stop notifying watcher about any rows
+        void removeRowWatches(RowWatcher *watcher);
+
+        //Publish the change journal for the batch of server data that was just parsed,
+        //start a new one, and notify watchers about the rows that changed. Should be
+        //called after each batch of server data.
+        void finishBatch(void);
+
+        //Returns what changed in the last finished batch. Reading it doesn't change it.
+        const ChangeJournal& getChangeJournal(void);
+
+        //The screens shown over the last few minutes, one frame per finished batch
+        ScreenTimeline& getTimeline(void);
+
+        //A hash of the row's characters, attributes and server tiles, kept up to date as
+        //the row is written. Doesn't wait for the batch to finish.
+        quint64 getRowHash(uint8_t yPos);
+
+        //A hash of the rows from topRow to topRow + numRows - 1 as they are now. Save it
+        //and compare it later to tell whether those rows changed in between.
+        quint64 getRegionHash(uint8_t topRow,
+                              uint8_t numRows);
+
+        //A hash of the whole screen at the end of the last finished batch, not counting
+        //the cursor
+        quint64 getScreenHash(void);
+
+        //Number of finished batches that ended on a screen with this hash, including the
+        //last one. Returns 0 for a screen we haven't seen.
+        unsigned int getTimesSeen(quint64 theHash);
+
+        //Returns the contents of a row, only rebuilt when the row has changed
+        const std::string& getRowText(uint8_t yPos);
+
+        //Returns the sprite at the specified location
+        NetSprite* getNetSprite(uint8_t xPos,
+                                uint8_t yPos);
+
+        //If newOffscreen is true, the window is drawn by the FrameRenderer instead of
+        //its sprites
+        void setOffscreen(bool newOffscreen);
+
+        //The most screen hashes getTimesSeen() remembers
+        static const int MAX_SEEN_SCREENS = 65536;
+
     private:
         //A 2-D array of characters to be displayed.
         std::vector <DisplayRow*> theWindow;
 
+        //The screen buffer that isn't displayed, its sprites are hidden
+        std::vector <DisplayRow*> otherWindow;
+
+        //True if theWindow is the alternate screen buffer
+        bool usingAlternate;
+
+        //True if the FrameRenderer draws the window
+        bool offscreen;
+
         //Pointer to the global whiteboard, don't delete
         WhiteBoard *whiteBoard;
 
@@ -135,9 +244,13 @@ class TelnetWindow
         uint8_t writeX;
         uint8_t writeY;
 
-        //True if the telnet window contents have changed. Set to false when getDisplayChanged()
-        //is called.
-        bool displayChanged;
+        //The top and bottom rows of the scrolling region
+        uint8_t scrollTop;
+        uint8_t scrollBottom;
+
+        //The graphics mode of each row, reapplied when a different DisplayRow is
+        //rotated into the position
+        std::vector <bool> graphicsRows;
 
         //True if eraseAll() should erase the display as normal, false otherwise
         bool allowEraseAll;
@@ -145,13 +258,55 @@ class TelnetWindow
         //True if this is the first time eraseAll was called, false otherwise
         bool firstEraseAll;
 
+        //Everyone watching for row changes, in the order they were added
+        std::vector <NGRowWatch> rowWatches;
+
+        //The ID to give the next row watch
+        int nextWatchID;
+
+        //The changes made by the batch being parsed, and by the last finished batch
+        ChangeJournal currentJournal;
+        ChangeJournal lastJournal;
+
+        //Records the screen after each finished batch
+        ScreenTimeline timeline;
+
+        //The screen hash at the end of the last finished batch
+        quint64 screenHash;
+
+        //How many finished batches ended on each screen hash, forgotten once it holds
+        //MAX_SEEN_SCREENS hashes
+        QHash <quint64, unsigned int> seenScreens;
+
+        //A copy of each row's characters, and whether the copy is out of date
+        std::vector <std::string> rowText;
+        std::vector <bool> staleText;
+
         //############### FUNCTIONS ###############
 
-        //Deletes all items in aWindow, removing them from theScene first. Sets theScene to NULL.
-        void clearWindow(std::vector <DisplayRow*> aWindow);
+        //Deletes all items in aWindow, removing them from theScene first, and empties aWindow
+        void clearWindow(std::vector <DisplayRow*> &aWindow);
 
-        //Display the window contents in the graphics scene
-        void setGraphicsScene(QGraphicsScene *newScene);
+        //Move the rows from topRow to bottomRow up by numLines, or down if numLines is
+        //negative, by rotating the pointers in theWindow. The exposed rows are blanked.
+        void rotateRows(uint8_t topRow,
+                        uint8_t bottomRow,
+                        int numLines);
+
+        //Fill a row with spaces
+        void clearRow(DisplayRow *oneRow);
+
+        //Remember that rows from topRow to topRow + numRows - 1 changed
+        void markRowsDirty(uint8_t topRow,
+                           uint8_t numRows);
+
+        //Remember that cells from firstColumn to lastColumn of row changed
+        void markCellsDirty(uint8_t row,
+                            uint8_t firstColumn,
+                            uint8_t lastColumn);
+
+        //Notify watchers about every row that changed in lastJournal
+        void dispatchRowWatches(void);
 
 };//TelnetWindow
 
@@ -0,0 +1,214 @@
+/* DESCRIPTION
+
+  Keeps copies of the tiles and text characters scaled to the current zoom, so the
+  graphics view can draw them 1:1 instead of resampling every sprite as it paints.
+
+  When the zoom changes, the tiles and the printable characters are scaled on the
+  global thread pool. Until they're ready, getTile() and getGlyph() return the
+  unscaled versions and the view scales them as before. Anything that wasn't in
+  the batch, like a tile loaded afterwards, is scaled the first time it's asked for.
+  On platforms that can't draw text off the GUI thread, the characters are drawn on
+  the GUI thread straight away and only the tiles are scaled in the background.
+
+  Each zoom level used this session is kept until the cache grows past the
+  "Zoom Cache Size" in game_config.txt, then the least recently used ones are
+  dropped. "Zoom Filter" chooses between smooth and nearest-neighbour scaling. Both
+  are re-read when they're written, and a new filter scales everything again.
+*/
+
+#ifndef NG_TILE_CACHE
+#define NG_TILE_CACHE
+
+#include <vector>
+#include <stdint.h>
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QPixmap>
+#include <QImage>
+#include <QFont>
+#include <QFutureWatcher>
+
+#include "SGRAttribute.hpp"
+#include "ConfigWatcher.hpp"
+
+class ImageLoader;
+class QGraphicsScene;
+
+//The tiles and characters scaled for one zoom amount
+struct NGCacheLevel
+{
+    //The zoom these were scaled for
+    double zoom;
+
+    //Size of each scaled tile in pixels
+    QSize tileSize;
+
+    //Scaled tiles, keyed by the cacheKey() of the unscaled pixmap
+    QHash <qint64, QPixmap> tiles;
+
+    //Scaled characters, keyed by TileCache::getGlyphKey()
+    QHash <int, QPixmap> glyphs;
+
+    //Approximate memory used by the pixmaps
+    qint64 bytes;
+};//NGCacheLevel
+
+//Scales one tile, run on the thread pool by QtConcurrent::mapped()
+struct NGTileScaler
+{
+    typedef QImage result_type;
+
+    QSize tileSize;
+    Qt::TransformationMode filter;
+
+    QImage operator()(const QImage &tile) const;
+};//NGTileScaler
+
+//Draws one character, run on the thread pool by QtConcurrent::mapped()
+struct NGGlyphRenderer
+{
+    typedef QImage result_type;
+
+    QFont font;
+    int fontOffset;
+    QSize baseSize;
+    double zoom;
+
+    QImage operator()(int glyphKey) const;
+};//NGGlyphRenderer
+
+class TileCache : public QObject, public ConfigWatcher
+{
+    Q_OBJECT
+
+    public:
+        //constructor
+        TileCache(void);
+
+        //destructor
+        ~TileCache(void);
+
+        //Start scaling the tiles in theLoader for newZoom in the background.
+        //Reuses the level if we've already scaled for this zoom.
+        void setZoom(double newZoom,
+                     ImageLoader *theLoader);
+
+        //Forget every scaled tile and character and scale them again, use when the
+        //tileset, font or sprite size changes
+        void reset(ImageLoader *theLoader);
+
+        //The scene to repaint once the scaled tiles are ready, don't delete
+        void setGraphicsScene(QGraphicsScene *newScene);
+
+        //True if getTile() and getGlyph() return pixmaps already scaled to the zoom,
+        //which should be drawn without the view's scaling
+        bool getScaled(void);
+
+        //Return baseTile scaled to the current zoom
+        QPixmap* getTile(QPixmap *baseTile);
+
+        //Return the telnet character drawn in the specified color, scaled to the current zoom
+        QPixmap* getGlyph(uint8_t telnetChar,
+                          NGS_Attribute color);
+
+        //Finish any scaling in the background and start using the new level
+        void waitForScaling(void);
+
+        //Number of pixmaps the cache has created, used by the render benchmark
+        unsigned int getPixmapsCreated(void);
+
+        //Re-read "Zoom Filter" and "Zoom Cache Size" when they're written
+        void configChanged(const std::string &fileName,
+                           const std::string &configID);
+
+        //Key of a character and color in NGCacheLevel::glyphs
+        static int getGlyphKey(uint8_t telnetChar,
+                               NGS_Attribute color);
+
+        //Draw telnetChar onto a black image of baseSize scaled by zoom. The font is drawn
+        //at the zoomed size, rather than the unscaled character being resampled.
+        static QImage renderGlyph(uint8_t telnetChar,
+                                  NGS_Attribute color,
+                                  const QFont &theFont,
+                                  int fontOffset,
+                                  QSize baseSize,
+                                  double zoom);
+
+        //The characters scaled in the background, the rest are scaled when needed
+        static const int FIRST_PRINTABLE = 32;
+        static const int LAST_PRINTABLE = 126;
+
+        //Zoom amounts closer than this are considered the same
+        static const double ZOOM_TOLERANCE;
+
+    private slots:
+        //Called when the background scaling finishes, moves the results into the cache
+        void scalingFinished(void);
+
+    private:
+        //Unscaled characters, used at zoom 1 and while a level is being scaled. The
+        //unscaled tiles are the ImageLoader's own pixmaps.
+        NGCacheLevel baseLevel;
+
+        //Levels scaled this session, most recently used first
+        std::vector <NGCacheLevel*> levels;
+
+        //The level used for drawing, either baseLevel or levels[0]
+        NGCacheLevel *currentLevel;
+
+        //The level being scaled in the background, NULL if none
+        NGCacheLevel *pendingLevel;
+
+        //Scale the tiles and characters for pendingLevel
+        QFutureWatcher <QImage> tileWatcher;
+        QFutureWatcher <QImage> glyphWatcher;
+
+        //Keys for the images given to tileWatcher and glyphWatcher, in the same order
+        std::vector <qint64> tileKeys;
+        QList <int> glyphKeys;
+
+        //The characters for pendingLevel, in the same order as glyphKeys, when they're
+        //drawn on the GUI thread instead of by glyphWatcher
+        QList <QImage> drawnGlyphs;
+
+        //True if characters can be drawn on the thread pool, false if the platform
+        //only draws text on the GUI thread
+        bool threadedFonts;
+
+        //Pointer to the graphics scene, don't delete
+        QGraphicsScene *theScene;
+
+        //The loader given to the last setZoom() or reset(), NULL if the tiles weren't
+        //ready. Don't delete.
+        ImageLoader *imageLoader;
+
+        //The zoom the view is currently using
+        double currentZoom;
+
+        //Most memory in bytes the scaled levels may use, from "Zoom Cache Size"
+        qint64 maxBytes;
+
+        //Smooth or nearest-neighbour, from "Zoom Filter"
+        Qt::TransformationMode filter;
+
+        //Counts every pixmap we create
+        unsigned int pixmapsCreated;
+
+        //############### FUNCTIONS ###############
+
+        //Read the filter and memory limit from game_config.txt
+        void loadConfig(void);
+
+        //Stop scaling in the background and throw away the partial level
+        void cancelScaling(void);
+
+        //Delete the least recently used levels until we're within maxBytes
+        void trimLevels(void);
+
+        //Approximate memory used by a pixmap of the specified size
+        static qint64 pixmapBytes(QSize theSize);
+
+};//TileCache
+
+#endif
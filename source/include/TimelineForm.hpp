@@ -0,0 +1,54 @@
+/* DESCRIPTION
+
+  A scrubber for the ScreenTimeline. Drag the slider to see the telnet window
+  as it was at any frame still kept, for looking at what led up to a farming
+  abort. The slider covers the frames kept when the form was shown, Latest
+  brings it up to date.
+*/
+
+#ifndef TIMELINEFORM_HPP_INCLUDED
+#define TIMELINEFORM_HPP_INCLUDED
+
+#include <QDialog>
+#include "ui_TimelineForm.h"
+#include "ScreenTimeline.hpp"
+
+class WhiteBoard;
+
+class TimelineForm : public QDialog
+{
+    Q_OBJECT
+
+    public:
+        //constructor
+        TimelineForm(QWidget* parent,
+                     Qt::WindowFlags flags,
+                     WhiteBoard *newWhiteBoard);
+
+        //destructor
+        ~TimelineForm(void);
+
+    public slots:
+        //Show the form at the newest frame
+        void showTimeline(void);
+
+    private slots:
+        //Show the screen at the frame chosen with the slider
+        void frameChosen(int frameNumber);
+
+        void latestClicked(void);
+        void closeClicked(void);
+
+    private:
+        //Pointer to the global white board, don't delete
+        WhiteBoard *whiteBoard;
+
+        //All of the widgets belonging to the timeline form
+        Ui::TimelineDialog gui;
+
+        //The screen being shown, reused between frames
+        NGTimelineScreen theScreen;
+
+};//TimelineForm
+
+#endif // TIMELINEFORM_HPP_INCLUDED
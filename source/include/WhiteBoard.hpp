@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <QRegExp>
+#include <QElapsedTimer>
 
 class QApplication;
 class MainWindow;
@@ -10,6 +11,7 @@ class QString;
 class NethackFX;
 class TelnetProtocol;
 class MessageForm;
+class NotificationQueue;
 class QWidget;
 
 class WhiteBoard
@@ -25,6 +27,16 @@ class WhiteBoard
         //Start the QT application engine
         int run(void);
 
+        //Set up the main window without showing it to the user, and time how long it
+        //takes to show the recorded session. Returns false on errors.
+        bool benchmarkRender(void);
+
+        //Set up the main window without showing it to the user, and render the recorded
+        //session to PNGs in the target directory, or to the target encoder command if
+        //toPipe is true. Returns false on errors.
+        bool exportFrames(const QString &target,
+                          bool toPipe);
+
         //Output the error message and crash gracelessly, intended to catch internal bugs,
         //NOT error conditions
         static void fatalError(const QString &errMsg);
@@ -43,10 +55,19 @@ class WhiteBoard
         TelnetProtocol* getTelnetPro(void);
         MessageForm* getMessageForm(void);
 
+        //Takes warnings from code that mustn't stop for a dialog, like the parser
+        NotificationQueue* getNotifications(void);
+
+        //Milliseconds since the program started, used to report startup times
+        qint64 getUptime(void);
+
     private:
         //The Qt engine that runs the program
         QApplication *qtApp;
 
+        //Started when the white board is created
+        QElapsedTimer uptimeTimer;
+
         //The main window for the application
         MainWindow *mainWindow;
 
@@ -60,6 +81,9 @@ class WhiteBoard
         //the user.
         MessageForm *messageForm;
 
+        //Logs warnings and errors, and pops them up from the event loop
+        NotificationQueue *notifications;
+
         //Detects matches for the indexIn function
         static QRegExp regExpRule;
 
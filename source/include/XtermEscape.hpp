@@ -1,25 +1,31 @@
 /* DESCRIPTION
 
-    An FSM that understands Xterm Escape Sequences.
-    All sequences start with the ESC char (ASCII 27), which should be
-    accepted by the calling class before run() is called.
-
-    This class only understands a subset of the xterm sequences, which should
-    be enough to run nethack. There are known bugs when viewing other people's
-    games. Unknown sequences are handled in two ways:
+    A table-driven parser for the xterm/VT500 byte stream, following Paul
+    Williams' DEC ANSI parser state diagram. Every byte that isn't part of a
+    telnet command is passed to run(). Each (state, byte) pair is looked up in
+    a transition table that gives the action to perform and the next state, so
+    C0 controls inside sequences, intermediates, and string terminators are all
+    handled the same way real terminals do. The tables are built once, the first
+    time an XtermEscape is created.
+
+    Printable bytes and C0 controls are applied to the telnet window directly.
+    Complete escape and control sequences are dispatched to a handler. This class
+    only understands a subset of the xterm sequences, which should be enough to
+    run nethack. Unknown sequences are handled in two ways:
 
     1) If ignoring the sequence has been found not to corrupt the screen content, we
        ignore it and cout a warning.
 
-    2) If the sequence changes the screen content, or is completely unknown, we pop up
-       an error message and tell the user that the display may not reflect the game contents.
+    2) If the sequence changes the screen content, or is completely unknown, run()
+       returns false so that the user can be told that the display may not reflect
+       the game contents. Malformed sequences are silently ignored, as a terminal would.
 */
 
 #ifndef NG_XTERM_ESC
 #define NG_XTERM_ESC
 
 #include <iostream>
-#include <deque>
+#include <string>
 
 #include "DisplayRow.hpp"
 #include "SGRAttribute.hpp"
@@ -28,14 +34,26 @@
 
 class WhiteBoard;
 
-//### States in the xterm escape sequence FSM ###
+//### States in the parser, see vt100.net/emu/dec_ansi_parser ###
 enum NGX_State
 {
-    NGXS_START, NGXS_ERROR, NGXS_G0_CHAR_SET, NGXS_G1_CHAR_SET,
-    NGXS_CSI, NGXS_CSI_DEC, NGXS_CSI_PARAM, NGXS_OSC,
-    NGXS_OSC_PARAM
+    NGXS_GROUND, NGXS_ESCAPE, NGXS_ESCAPE_INTERMEDIATE,
+    NGXS_CSI_ENTRY, NGXS_CSI_PARAM, NGXS_CSI_INTERMEDIATE, NGXS_CSI_IGNORE,
+    NGXS_DCS_ENTRY, NGXS_DCS_PARAM, NGXS_DCS_INTERMEDIATE, NGXS_DCS_PASSTHROUGH,
+    NGXS_DCS_IGNORE, NGXS_OSC_STRING, NGXS_SOS_PM_APC_STRING,
+
+    //The number of states, not a state
+    NGXS_NUM_STATES
 };//NGX_State
 
+//### Actions performed on a transition, or on entering or leaving a state ###
+enum NGX_Action
+{
+    NGXA_NONE, NGXA_IGNORE, NGXA_PRINT, NGXA_EXECUTE, NGXA_CLEAR, NGXA_COLLECT,
+    NGXA_PARAM, NGXA_ESC_DISPATCH, NGXA_CSI_DISPATCH, NGXA_HOOK, NGXA_PUT,
+    NGXA_UNHOOK, NGXA_OSC_START, NGXA_OSC_PUT, NGXA_OSC_END
+};//NGX_Action
+
 class XtermEscape
 {
     public:
@@ -47,14 +65,11 @@ class XtermEscape
         //destructor
         ~XtermEscape(void);
 
-        //Run the FSM, potentially modifying the write location and the telnet window.
-        //Returns the current state of the FSM, NGXS_START if we successfully accepted this
-        //escape sequence, and NGXS_ERROR if the escape sequence was not understood. If the
-        //result is any other state, then XtermEscape is expecting more bytes.
-        NGX_State run(uint8_t currentByte);
+        //Parse one byte from the server, potentially modifying the write location and the
+        //telnet window. Returns false if this byte finished a sequence we couldn't handle.
+        bool run(uint8_t currentByte);
 
-        //Reset the finite state machine to it's original state, useful if connecting to
-        //a different server
+        //Reset the parser to it's original state, useful if connecting to a different server
         void resetFSM(void);
 
         //Returns true if we should use the tile specified by getTileNumber
@@ -63,9 +78,52 @@ class XtermEscape
         //Returns the current tile number that the server told us to use
         int getTileNumber(void);
 
+        //Horizontal tabs move to the next multiple of this column
+        static const int TAB_WIDTH = 8;
+
+        //The most intermediate bytes we'll keep from one sequence
+        static const int MAX_INTERMEDIATES = 2;
+
+        //The most numeric parameters we'll keep from one sequence, the rest are ignored
+        static const int MAX_PARAMETERS = 16;
+
+        //Numeric parameters larger than this are clamped
+        static const int MAX_PARAMETER_VALUE = 65535;
+
+        //The most bytes of OSC text we'll keep, the rest are ignored
+        static const int MAX_OSC_LENGTH = 512;
+
     private:
-        //parameters sent by the server
-        std::deque <QByteArray*> parameters;
+        //Packed (action << 4) | next state for every state and byte. Built by buildTables().
+        static uint8_t transitions[NGXS_NUM_STATES][256];
+
+        //Actions to perform when entering and leaving each state
+        static uint8_t entryActions[NGXS_NUM_STATES];
+        static uint8_t exitActions[NGXS_NUM_STATES];
+
+        //True once the tables above have been built
+        static bool tablesBuilt;
+
+        //Intermediate and private marker bytes, eg the ? in ESC [ ? 1049 h
+        char intermediates[MAX_INTERMEDIATES];
+        int numIntermediates;
+
+        //True if the sequence had more intermediates than we could keep
+        bool ignoreSequence;
+
+        //Numeric parameters sent by the server, built up digit by digit as they arrive.
+        //An empty parameter is 0.
+        int parameters[MAX_PARAMETERS];
+
+        //The number of entries in parameters that were sent for the current sequence
+        int numParameters;
+
+        //True once the sequence has sent more than MAX_PARAMETERS parameters. The digits
+        //of the extra parameters are dropped.
+        bool parameterOverflow;
+
+        //The text part of an OSC command. Cleared, but never freed, between sequences
+        std::string oscString;
 
         //pointer to the global white board
         WhiteBoard *whiteBoard;
@@ -73,26 +131,22 @@ class XtermEscape
         //The 2D array of characters to display, just a pointer don't delete
         TelnetWindow *theWindow;
 
-        //Our current state in the FSM
+        //Our current state in the parser
         NGX_State myState;
 
-        //The saved cursor coordinates
+        //Set by a sequence handler if it couldn't handle the sequence
+        bool parseError;
+
+        //True once an OSC command's type has been read, the rest is oscString
+        bool oscGotType;
+
+        //The saved cursor coordinates, counting from 1
         uint8_t savedCursorX;
         uint8_t savedCursorY;
 
-        //Top and bottom of the scrolling region
-        int topScrolling;
-        int bottomScrolling;
-
         //The nethack tile the server is suggesting we use for future telnet characters
         int tileNumber;
 
-        //True if we're using the alternate buffer, whatever that is
-        bool alternateBuffer;
-
-        //Returns true if currentByte is a value from '0' to '9'
-        bool isASCIIDigit(uint8_t currentByte);
-
         //True if we should output verbose messages for debugging
         bool debugMessages;
 
@@ -105,23 +159,41 @@ class XtermEscape
 
         //############### FUNCTIONS ###############
 
-        //One function for each state in the FSM
-        void runStart(uint8_t currentByte);
-        void runG0CharSet(uint8_t currentByte);
-        void runG1CharSet(uint8_t currentByte);
-        void runCSI(uint8_t currentByte);
-        void runCSIDEC(uint8_t currentByte);
+        //Fill in transitions, entryActions and exitActions
+        static void buildTables(void);
+
+        //Set the transition for every byte from firstByte to lastByte in state
+        static void setTransitions(NGX_State state,
+                                   uint8_t firstByte,
+                                   uint8_t lastByte,
+                                   NGX_Action action,
+                                   NGX_State nextState);
+
+        //Perform a single action for currentByte
+        void doAction(NGX_Action action,
+                      uint8_t currentByte);
+
+        //Apply a C0 control character to the telnet window
+        void execute(uint8_t currentByte);
+
+        //Run a complete escape or control sequence that ended with finalByte
+        void escDispatch(uint8_t finalByte);
+        void csiDispatch(uint8_t finalByte);
+
+        //Handle the parts of an OSC command
+        void oscPut(uint8_t currentByte);
+
+        //Handle sequences from escDispatch and csiDispatch
+        void runG0CharSet(uint8_t finalByte);
+        void runG1CharSet(uint8_t finalByte);
+        void runCSIDEC(uint8_t finalByte);
         void runDECPMSet(int decSet);
         void runDECPMReset(int decSet);
-        void runCSIParam(uint8_t currentByte);
         void runCSISetScrolling(void);
         void runSGRCharAttributes(void);
         void runCSIResetMode(void);
-        void runOSC(uint8_t currentByte);
-        void runOSCParam(uint8_t currentByte);
 
         //Execute a command
-        void setCursorPosition(void);
         void eraseInDisplay(void);
         void linePosition(void);
         void eraseInLine(void);
@@ -133,6 +205,10 @@ class XtermEscape
         void cursorDown(void);
         void cursorBackward(void);
         void deleteLines(void);
+        void reverseIndex(void);
+        void insertLines(void);
+        void scrollUp(void);
+        void scrollDown(void);
         void setNethackTile(void);
 
         //Run an operating system command
@@ -142,19 +218,23 @@ class XtermEscape
         void startGlyph(void);
         void endGlyph(void);
 
+        //Save and restore the cursor position, as in DECSC and DECRC
+        void saveCursor(void);
+        void restoreCursor(void);
+
         //Extract the cursor movement distance from parameters
         int getCursorMoveDist(void);
 
-        //Converts parameter to an integer, stored in intVersion. Returns false
-        //if parameter didn't contain a base-10 ASCII integer, eg "456".
-        bool extractInt(QByteArray *oneParameter,
-                        int &intVersion);
+        //Add a new parameter with the value 0
+        void startParameter(void);
+
+        //Handle a ; between parameters
+        void separateParameter(void);
 
-        //Returns parameter as a std string. If parameter contains any NULL characters,
-        //the result may not contain the entire parameter.
-        std::string arrayToStr(QByteArray *parameter);
+        //Add an ASCII digit to the end of the current parameter, starting one if needed
+        void addParameterDigit(uint8_t currentByte);
 
-        //Clear parameters sent by the server
+        //Clear parameters and intermediates sent by the server
         void resetParameters(void);
 
 };//XtermEscape
@@ -39,7 +39,6 @@ ArrowHandler::~ArrowHandler(void)
 
 bool ArrowHandler::sendCommand(int keypress)
 {
-    TelnetProtocol *telnetPro = whiteBoard->getTelnetPro();
     bool result = false;//true if keypress is an arrow key
 
     if (bufferedArrow)
@@ -49,12 +48,12 @@ bool ArrowHandler::sendCommand(int keypress)
         {
             if (prevArrow == Qt::Key_Up)
             {
-                telnetPro->sendKeystroke(NGSettings::getUpRightKey());
+                sendKey(NGSettings::getUpRightKey());
                 bufferedArrow = false;
             }//if getScancode()
             else if (prevArrow == Qt::Key_Down)
             {
-                telnetPro->sendKeystroke(NGSettings::getDownRightKey());
+                sendKey(NGSettings::getDownRightKey());
                 bufferedArrow = false;
             }//if getScancode()
             else
@@ -71,12 +70,12 @@ bool ArrowHandler::sendCommand(int keypress)
         {
             if (prevArrow == Qt::Key_Up)
             {
-                telnetPro->sendKeystroke(NGSettings::getUpLeftKey());
+                sendKey(NGSettings::getUpLeftKey());
                 bufferedArrow = false;
             }//if getScancode()
             else if (prevArrow == Qt::Key_Down)
             {
-                telnetPro->sendKeystroke(NGSettings::getDownLeftKey());
+                sendKey(NGSettings::getDownLeftKey());
                 bufferedArrow = false;
             }//if getScancode()
             else
@@ -93,12 +92,12 @@ bool ArrowHandler::sendCommand(int keypress)
         {
             if (prevArrow == Qt::Key_Right)
             {
-                telnetPro->sendKeystroke(NGSettings::getUpRightKey());
+                sendKey(NGSettings::getUpRightKey());
                 bufferedArrow = false;
             }//if getScancode()
             else if (prevArrow == Qt::Key_Left)
             {
-                telnetPro->sendKeystroke(NGSettings::getUpLeftKey());
+                sendKey(NGSettings::getUpLeftKey());
                 bufferedArrow = false;
             }//if getScancode()
             else
@@ -115,12 +114,12 @@ bool ArrowHandler::sendCommand(int keypress)
         {
             if (prevArrow == Qt::Key_Right)
             {
-                telnetPro->sendKeystroke(NGSettings::getDownRightKey());
+                sendKey(NGSettings::getDownRightKey());
                 bufferedArrow = false;
             }//if getScancode()
             else if (prevArrow == Qt::Key_Left)
             {
-                telnetPro->sendKeystroke(NGSettings::getDownLeftKey());
+                sendKey(NGSettings::getDownLeftKey());
                 bufferedArrow = false;
             }//if getScancode()
             else
@@ -165,20 +164,18 @@ void ArrowHandler::sendBufferedArrow(void)
 {
     if (bufferedArrow)
     {
-        TelnetProtocol *telnetPro = whiteBoard->getTelnetPro();
-
         switch (prevArrow)
         {
-            case Qt::Key_Up: telnetPro->sendKeystroke(NGSettings::getUpKey());
+            case Qt::Key_Up: sendKey(NGSettings::getUpKey());
                 break;
 
-            case Qt::Key_Down: telnetPro->sendKeystroke(NGSettings::getDownKey());
+            case Qt::Key_Down: sendKey(NGSettings::getDownKey());
                 break;
 
-            case Qt::Key_Right: telnetPro->sendKeystroke(NGSettings::getRightKey());
+            case Qt::Key_Right: sendKey(NGSettings::getRightKey());
                 break;
 
-            case Qt::Key_Left: telnetPro->sendKeystroke(NGSettings::getLeftKey());
+            case Qt::Key_Left: sendKey(NGSettings::getLeftKey());
                 break;
 
             default:
@@ -191,3 +188,10 @@ void ArrowHandler::sendBufferedArrow(void)
         bufferedArrow = false;
     }//if bufferedArrow
 }//sendBufferedArrow
+
+void ArrowHandler::sendKey(char key)
+{
+    TelnetProtocol *telnetPro = whiteBoard->getTelnetPro();
+
+    telnetPro->sendBytes(QByteArray(1, key));
+}//sendKey
@@ -0,0 +1,186 @@
+/*Copyright 2009-2013 David McCallum
+
+This file is part of EbonHack.
+
+    EbonHack is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    EbonHack is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with EbonHack.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ChangeJournal.hpp"
+#include <algorithm>
+
+using namespace std;
+
+ChangeJournal::ChangeJournal(void)
+{
+    reset(0, 0, 0, 0, 0);
+}//constructor
+
+ChangeJournal::~ChangeJournal(void)
+{
+}//destructor
+
+void ChangeJournal::reset(unsigned int newBatchNumber,
+                          uint8_t newWidth,
+                          uint8_t newHeight,
+                          uint8_t cursorX,
+                          uint8_t cursorY)
+{
+    batchNumber = newBatchNumber;
+    windowWidth = newWidth;
+
+    changedRows.assign(newHeight, false);
+    ranges.clear();
+
+    startCursorX = cursorX;
+    startCursorY = cursorY;
+    endCursorX = cursorX;
+    endCursorY = cursorY;
+}//reset
+
+void ChangeJournal::markRows(uint8_t topRow,
+                             uint8_t numRows)
+{
+    if (windowWidth > 0)
+    {
+        for (unsigned int y = topRow; (y < topRow + numRows) && (y < changedRows.size()); y++)
+            markCells(y, 0, windowWidth - 1);
+    }//if windowWidth
+}//markRows
+
+void ChangeJournal::markCells(uint8_t row,
+                              uint8_t firstColumn,
+                              uint8_t lastColumn)
+{
+    NGCellRange newRange;//the range to add
+    NGCellRange *lastRange = NULL;//the most recently added range
+
+    if (row < changedRows.size())
+    {
+        changedRows.at(row) = true;
+
+        if (!ranges.empty())
+            lastRange = &ranges.back();
+
+        //### Join ranges that touch, most writes are to the next column ###
+        if ((lastRange != NULL) && (lastRange->row == row) &&
+            (firstColumn <= lastRange->lastColumn + 1) && (lastColumn + 1 >= lastRange->firstColumn))
+        {
+            if (firstColumn < lastRange->firstColumn)
+                lastRange->firstColumn = firstColumn;
+            if (lastColumn > lastRange->lastColumn)
+                lastRange->lastColumn = lastColumn;
+        }//if lastRange
+
+        else
+        {
+            newRange.row = row;
+            newRange.firstColumn = firstColumn;
+            newRange.lastColumn = lastColumn;
+            ranges.push_back(newRange);
+        }//else lastRange
+    }//if row
+}//markCells
+
+void ChangeJournal::setCursor(uint8_t cursorX,
+                              uint8_t cursorY)
+{
+    endCursorX = cursorX;
+    endCursorY = cursorY;
+}//setCursor
+
+void ChangeJournal::swap(ChangeJournal &other)
+{
+    std::swap(batchNumber, other.batchNumber);
+    std::swap(windowWidth, other.windowWidth);
+    changedRows.swap(other.changedRows);
+    ranges.swap(other.ranges);
+    std::swap(startCursorX, other.startCursorX);
+    std::swap(startCursorY, other.startCursorY);
+    std::swap(endCursorX, other.endCursorX);
+    std::swap(endCursorY, other.endCursorY);
+}//swap
+
+unsigned int ChangeJournal::getBatchNumber(void) const
+{
+    return batchNumber;
+}//getBatchNumber
+
+bool ChangeJournal::getAnyChanged(void) const
+{
+    return ((!ranges.empty()) || (getCursorMoved()));
+}//getAnyChanged
+
+bool ChangeJournal::getRowChanged(uint8_t row) const
+{
+    bool result = false;//true if the row changed
+
+    if (row < changedRows.size())
+        result = changedRows.at(row);
+
+    return result;
+}//getRowChanged
+
+bool ChangeJournal::getCellsChanged(uint8_t row,
+                                    uint8_t firstColumn,
+                                    uint8_t lastColumn) const
+{
+    bool result = false;//true if a range overlaps the cells
+
+    if (getRowChanged(row))
+    {
+        for (unsigned int i = 0; (i < ranges.size()) && (!result); i++)
+        {
+            if ((ranges.at(i).row == row) && (ranges.at(i).firstColumn <= lastColumn) &&
+                (ranges.at(i).lastColumn >= firstColumn))
+                result = true;
+        }//for i
+    }//if getRowChanged()
+
+    return result;
+}//getCellsChanged
+
+unsigned int ChangeJournal::getNumRanges(void) const
+{
+    return ranges.size();
+}//getNumRanges
+
+const NGCellRange& ChangeJournal::getRange(unsigned int index) const
+{
+    return ranges.at(index);
+}//getRange
+
+uint8_t ChangeJournal::getStartCursorX(void) const
+{
+    return startCursorX;
+}//getStartCursorX
+
+uint8_t ChangeJournal::getStartCursorY(void) const
+{
+    return startCursorY;
+}//getStartCursorY
+
+uint8_t ChangeJournal::getCursorX(void) const
+{
+    return endCursorX;
+}//getCursorX
+
+uint8_t ChangeJournal::getCursorY(void) const
+{
+    return endCursorY;
+}//getCursorY
+
+bool ChangeJournal::getCursorMoved(void) const
+{
+    return ((startCursorX != endCursorX) || (startCursorY != endCursorY));
+}//getCursorMoved
@@ -17,9 +17,18 @@ This file is part of EbonHack.
 */
 
 #include "CharSaver.hpp"
+#include <QSaveFile>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 using namespace std;
 
+const char CharSaver::JOURNAL_SUFFIX[] = ".journal";
+
 CharSaver::CharSaver(void)
 {
     colorNames.push_back("black");
@@ -32,10 +41,15 @@ CharSaver::CharSaver(void)
     colorNames.push_back("white");
 
     loadErrors = false;
+    journalEntries = 0;
+    unsyncedEntries = 0;
 }//constructor
 
 CharSaver::~CharSaver(void)
 {
+    syncJournal(true);
+    if (journal.isOpen())
+        journal.close();
 }//destructor
 
 bool CharSaver::load(const string &pathAndName,
@@ -92,9 +106,134 @@ bool CharSaver::load(const string &pathAndName,
     if (!result)
         loadErrors = true;
 
+    //### Apply what was learned since the last save, even if the base file is bad.
+    //Only fold it in if the base file loaded, save() refuses otherwise. ###
+    basePathAndName = pathAndName;
+    replayJournal(knownChars);
+    if ((result) && (journalEntries > 0))
+        save(basePathAndName, knownChars);
+
     return result;
 }//load
 
+void CharSaver::replayJournal(map <string, int> &knownChars)
+{
+    string pathAndName = basePathAndName + JOURNAL_SUFFIX;//the journal's file name
+    ifstream infile(pathAndName.c_str());//the journal to read from
+    string oneLine;//a single line from the journal
+    bool finished = false;//true when there are no more complete lines
+
+    //### No journal means nothing was learned since the last save ###
+    if (!infile.is_open())
+        finished = true;
+
+    while (!finished)
+    {
+        //### Every entry ends with a newline, a line that doesn't was cut short ###
+        getline(infile, oneLine);
+        if (!infile.good())
+        {
+            if (oneLine.size() > 0)
+                cout << "CharSaver: ignoring a partly written entry at the end of " << pathAndName << endl;
+            finished = true;
+        }//if !good()
+
+        //### Stop at anything we can't read, the rest of the journal can't be trusted ###
+        else if (!processLine(oneLine, knownChars))
+        {
+            cout << "CharSaver: ignoring the rest of " << pathAndName << endl;
+            finished = true;
+        }//else if !processLine
+        else
+            journalEntries++;
+    }//while !finished
+
+    if (infile.is_open())
+        infile.close();
+}//replayJournal
+
+bool CharSaver::append(const string &theKey,
+                       int spriteIndex,
+                       map <string, int> &knownChars)
+{
+    ostringstream entry;//the journal entry for this mapping
+    bool result = true;//false on file access error
+
+    //### The journal could never be compacted, so don't let it grow ###
+    if (loadErrors)
+        result = false;
+    else if (!openJournal())
+        result = false;
+
+    //### Write the entry, and hand it to the OS straight away ###
+    if (result)
+        result = writeLine(entry, theKey, spriteIndex);
+
+    if (result)
+    {
+        entry << endl;
+        if ((journal.write(entry.str().data(), entry.str().size()) != static_cast<qint64>(entry.str().size()))
+            || (!journal.flush()))
+        {
+            cout << "CharSaver::append(): error writing to " << basePathAndName << JOURNAL_SUFFIX << endl;
+            result = false;
+        }//if write() || !flush()
+    }//if result
+
+    if (result)
+    {
+        journalEntries++;
+        if (unsyncedEntries == 0)
+            syncTimer.start();
+        unsyncedEntries++;
+
+        //### Fold a long journal into the base file ###
+        if (journalEntries >= MAX_JOURNAL_ENTRIES)
+            save(basePathAndName, knownChars);
+        else
+            syncJournal(false);
+    }//if result
+
+    return result;
+}//append
+
+void CharSaver::syncJournal(bool force)
+{
+    int fileHandle = -1;//the journal's file descriptor
+
+    if ((unsyncedEntries > 0) && (journal.isOpen()))
+    {
+        if ((force) || (unsyncedEntries >= SYNC_BATCH_SIZE) || (syncTimer.elapsed() >= SYNC_DELAY))
+        {
+            fileHandle = journal.handle();
+#ifdef Q_OS_WIN
+            _commit(fileHandle);
+#else
+            fsync(fileHandle);
+#endif
+            unsyncedEntries = 0;
+        }//if force || unsyncedEntries || elapsed()
+    }//if unsyncedEntries && isOpen()
+}//syncJournal
+
+bool CharSaver::openJournal(void)
+{
+    string pathAndName = basePathAndName + JOURNAL_SUFFIX;//the journal's file name
+    bool result = true;//false if the journal couldn't be opened
+
+    if (!journal.isOpen())
+    {
+        journal.setFileName(QString::fromLocal8Bit(pathAndName.c_str()));
+        if (!journal.open(QIODevice::WriteOnly | QIODevice::Append))
+        {
+            cout << "CharSaver: couldn't open " << pathAndName << " for writing" << endl;
+            result = false;
+        }//if !open()
+    }//if !isOpen()
+
+    return result;
+}//openJournal
+
 bool CharSaver::processLine(string &oneLine,
                             map <string, int> &knownChars)
 {
@@ -190,72 +329,87 @@ bool CharSaver::findColor(const string &theColor,
 bool CharSaver::save(const string &pathAndName,
                      map <string, int> &knownChars)
 {
-    ofstream outfile;//the file to write to
+    ostringstream fileText;//the new contents of the file
     map<string, int>::iterator mapIter;//points to an element in knownChars
-    string theKey;//a key from knownChars
-    int colorIndex = 0;//index of the current color in colorNames
-    char oneChar = ' ';//the current known character
     bool result = true;//false on file access error
 
     if (loadErrors)
+    {
         cout << "CharSaver::save(): not saving because there were errors loading." << endl;
-    else
+        result = false;
+    }//if loadErrors
+
+    //### Save the mappings ###
+    mapIter = knownChars.begin();
+    while ((result) && (mapIter != knownChars.end()))
     {
-        //### Open the file for writing ###
-        outfile.open(pathAndName.c_str());
-        if (!outfile.is_open())
+        if (!writeLine(fileText, (*mapIter).first, (*mapIter).second))
+            result = false;
+
+        fileText << endl;
+        mapIter++;
+    }//while result && mapIter
+
+    //### Replace the file, so a crash can't leave half of it behind ###
+    if (result)
+    {
+        fileText << "END";
+
+        QSaveFile outfile(QString::fromLocal8Bit(pathAndName.c_str()));
+        if (!outfile.open(QIODevice::WriteOnly | QIODevice::Text))
         {
             cout << "Couldn't open " << pathAndName << " for writing" << endl;
             result = false;
-        }//if !is_open()
-
-        //### Save the mappings ###
-        mapIter = knownChars.begin();
-        while ((result) && (mapIter != knownChars.end()))
+        }//if !open()
+        else if ((outfile.write(fileText.str().data(), fileText.str().size()) != static_cast<qint64>(fileText.str().size()))
+                 || (!outfile.commit()))
         {
-            theKey = (*mapIter).first;
+            cout << "Error writing to " << pathAndName << endl;
+            result = false;
+        }//else if write() || !commit()
+    }//if result
 
-            //### Verify that the key is 2 bytes long ###
-            if (theKey.size() != 2)
-            {
-                cout << "CharSaver::save(): got a key that isn't 2 bytes long" << endl;
-                result = false;
-            }//if size()
+    //### Everything in the journal is in the base file now ###
+    if ((result) && (pathAndName == basePathAndName))
+    {
+        if (journal.isOpen())
+            journal.close();
 
-            //### Extract the character and color ###
-            if (result)
-            {
-                oneChar = theKey.at(0);
-
-                colorIndex = static_cast<int>(theKey.at(1));
-                if ((colorIndex < 0) || (colorIndex >= static_cast<int>(colorNames.size())))
-                {
-                    cout << "CharSaver::save(): got an invalid color index " << colorIndex << endl;
-                    result = false;
-                }//if colorIndex || colorIndex
-            }//if result
-
-            //### Write them to file ###
-            if (result)
-            {
-                outfile << oneChar << " " << colorNames.at(colorIndex)
-                        << " " << (*mapIter).second << endl;
-                if (!outfile.good())
-                {
-                    cout << "Error writing to " << pathAndName << endl;
-                    result = false;
-                }//if !good()
-            }//if result
-
-            mapIter++;
-        }//while result && mapIter
-
-        if (outfile.is_open())
-        {
-            outfile << "END";
-            outfile.close();
-        }//if is_open()
-    }//else loadErrors
+        QFile::remove(QString::fromLocal8Bit((basePathAndName + JOURNAL_SUFFIX).c_str()));
+        journalEntries = 0;
+        unsyncedEntries = 0;
+    }//if result && pathAndName
 
     return result;
 }//save
+
+bool CharSaver::writeLine(ostream &out,
+                          const string &theKey,
+                          int spriteIndex)
+{
+    int colorIndex = 0;//index of the current color in colorNames
+    bool result = true;//false if the key can't be written
+
+    //### Verify that the key is 2 bytes long ###
+    if (theKey.size() != 2)
+    {
+        cout << "CharSaver: got a key that isn't 2 bytes long" << endl;
+        result = false;
+    }//if size()
+
+    //### Extract the color ###
+    if (result)
+    {
+        colorIndex = static_cast<int>(theKey.at(1));
+        if ((colorIndex < 0) || (colorIndex >= static_cast<int>(colorNames.size())))
+        {
+            cout << "CharSaver: got an invalid color index " << colorIndex << endl;
+            result = false;
+        }//if colorIndex || colorIndex
+    }//if result
+
+    if (result)
+        out << theKey.at(0) << " " << colorNames.at(colorIndex) << " " << spriteIndex;
+
+    return result;
+}//writeLine
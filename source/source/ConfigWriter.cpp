@@ -1,9 +1,36 @@
 #include "ConfigWriter.hpp"
 #include <math.h>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QThread>
 
 using namespace std;
 
 string ConfigWriter::path;
+map <string, NGConfigFile*> ConfigWriter::configFiles;
+vector <ConfigWatcher*> ConfigWriter::watchers;
+QMutex ConfigWriter::cacheMutex;
+QThreadPool* ConfigWriter::writePool = NULL;
+
+//Writes one config file on the write thread
+class ConfigWriteTask : public QRunnable
+{
+    public:
+        ConfigWriteTask(const string &newFileName)
+        {
+            fileName = newFileName;
+        }//constructor
+
+        void run(void)
+        {
+            ConfigWriter::writeFile(fileName);
+        }//run
+
+    private:
+        //The file to write
+        string fileName;
+};//ConfigWriteTask
 
 ConfigWriter::ConfigWriter(void)
 {
@@ -15,6 +42,15 @@ ConfigWriter::~ConfigWriter(void)
 
 void ConfigWriter::setPath(const std::string &newPath)
 {
+    map <string, NGConfigFile*>::iterator fileIter;//the file to forget
+
+    //### Finish writing to the old path, then forget what we read from it ###
+    flush();
+
+    for (fileIter = configFiles.begin(); fileIter != configFiles.end(); fileIter++)
+        delete fileIter->second;
+    configFiles.clear();
+
     path = newPath;
 }//setPath
 
@@ -22,96 +58,87 @@ string ConfigWriter::loadString(const string &fileName,
                                 const string &configID)
 
 {
-    ifstream infile;//obtains input from the file
+    QMutexLocker locker(&cacheMutex);//the write thread reads configFiles too
+    NGConfigFile *configFile = NULL;//the contents of fileName
+    map <string, unsigned int>::iterator entryIter;//the index of configID
     string result;//the loaded string to return
-    string oneLine;//a single line of text from the file
     string pathAndName;//the path to the file, including the file name
-    bool foundID = false;//true if we found the configID
 
-    //### Open the file ###
     pathAndName = path;
     pathAndName.append(fileName);
-    infile.open(pathAndName.c_str());
-    if (!infile.good())
-    {
-        cout << "ConfigWriter couldn't open " << pathAndName << " for reading" << endl;
-        throw 1;
-    }//if !infile
+    configFile = getFile(fileName, true);
 
     //### Find the configID ###
-    while ((infile.good()) && (!foundID))
-    {
-        //read the configID line
-        getline(infile, oneLine);
-        oneLine = cleanLine(oneLine);
-
-        if (infile.good())
-        {
-            if (oneLine.size() > 0)
-            {
-                if (oneLine.at(0) == '%')
-                {
-                    //remove the % symbol
-                    oneLine.erase(0, 1);
-
-                    if (oneLine.size() > 0)
-                    {
-                        //check for matches
-                        if (oneLine == configID)
-                            foundID = true;
-                    }//if size()
-                    else
-                    {
-                        cout << "File " << pathAndName << " contains a % with no identifier" << endl;
-                        throw 1;
-                    }//else size
-                }//if oneLine
-            }//if size()
-        }//if good()
-    }//while good() && !foundID
-
-    //### See if the ID was found ###
-    if (!foundID)
+    entryIter = configFile->entryIndex.find(configID);
+    if (entryIter == configFile->entryIndex.end())
     {
         cout << "ConfigWriter couldn't find " << configID << " in file " << pathAndName << endl;
         throw 1;
-    }//if !foundID
+    }//if entryIter
 
-    //### Read the value ###
-    getline(infile, result);
-    result = cleanLine(result);
-    if (!infile.good())
-    {
-        if (!infile.eof())
-        {
-            cout << "ConfigWriter couldn't read file after " << configID << " in file " << pathAndName << endl;
-            throw 1;
-        }//if !eof()
-    }//if !good()
+    result = configFile->entries.at(entryIter->second).value;
 
-    //### Verify that we read something ###
-    if (result.size() <= 1)
+    //### Verify that there's a value ###
+    if (result.size() == 0)
     {
         cout << "ConfigWriter found no value for " << configID << " in file " << pathAndName << endl;
         throw 1;
     }//if size()
 
-    //### Remove the > symbol ###
-    if (result.at(0) == '>')
-        result.erase(0, 1);
+    return result;
+}//loadString
+
+NGConfigFile* ConfigWriter::getFile(const string &fileName,
+                                    bool mustExist)
+{
+    map <string, NGConfigFile*>::iterator fileIter = configFiles.find(fileName);//the cached file
+    NGConfigFile *result = NULL;//the contents of fileName
+    NGConfigEntry newEntry;//a single entry read from the file
+    ifstream infile;//obtains input from the file
+    string pathAndName;//the path to the file, including the file name
+    string oneLine;//a single line of text from the file
+
+    if (fileIter != configFiles.end())
+        result = fileIter->second;
+
+    //### Read the entire file into memory ###
     else
     {
-        cout << "ConfigWriter expected > to indicate the value for " << configID
-             << " in file " << pathAndName << endl;
-        throw 1;
-    }//if result
+        pathAndName = path;
+        pathAndName.append(fileName);
+        infile.open(pathAndName.c_str());
+        if ((!infile.good()) && (mustExist))
+        {
+            cout << "ConfigWriter couldn't open " << pathAndName << " for reading" << endl;
+            throw 1;
+        }//if !infile && mustExist
+
+        result = new NGConfigFile;
+        result->writePending = false;
+
+        while (infile.good())
+        {
+            getline(infile, oneLine);
+            oneLine = cleanLine(oneLine);
+
+            if ((infile.good()) && (oneLine.size() > 0))
+            {
+                newEntry = NGConfigEntry();
+                readEntry(oneLine, infile, newEntry, pathAndName);
+
+                result->entryIndex[newEntry.configID] = result->entries.size();
+                result->entries.push_back(newEntry);
+            }//if good() && size()
+        }//while good()
+
+        if (infile.is_open())
+            infile.close();
 
-    //### Close the file ###
-    if (infile.is_open())
-        infile.close();
+        configFiles[fileName] = result;
+    }//else fileIter
 
     return result;
-}//loadString
+}//getFile
 
 string ConfigWriter::cleanLine(const string &oneLine)
 {
@@ -133,108 +160,142 @@ void ConfigWriter::writeString(const string &fileName,
                                const string &configID,
                                const string &newString)
 {
-    vector <ConfigComments*> fileComments;//the comments for all entries
-    vector <string> fileIDs;//every configID read from the file
-    vector <string> fileValues;//every string value from the file
-    ConfigComments *commentGroup = NULL;//a group of comments for a single entry
-    ifstream infile;//obtains input from the file
-    ofstream outfile;//re-writes the file
-    string pathAndName;////the path to the file, including the file name
-    string oneLine;//a single line of text from the file
-    bool foundValue = false;//true if configID was present in the file
-
-    //### Read the entire file into memory ###
-    pathAndName = path;
-    pathAndName.append(fileName);
-    infile.open(pathAndName.c_str());
-    if (infile.good())
+    QMutexLocker locker(&cacheMutex);//the write thread reads configFiles too
+    NGConfigFile *configFile = NULL;//the contents of fileName
+    NGConfigEntry newEntry;//the entry to add, if configID isn't in the file
+    map <string, unsigned int>::iterator entryIter;//the index of configID
+    vector <ConfigWatcher*> currentWatchers;//the watchers to notify
+    bool changed = false;//true if the value is different from the stored value
+
+    configFile = getFile(fileName, false);
+
+    //### Change the entry, or create a new one if it wasn't found ###
+    entryIter = configFile->entryIndex.find(configID);
+    if (entryIter != configFile->entryIndex.end())
     {
-        while (infile.good())
+        if (configFile->entries.at(entryIter->second).value != newString)
         {
-            getline(infile, oneLine);
-            oneLine = cleanLine(oneLine);
+            configFile->entries.at(entryIter->second).value = newString;
+            changed = true;
+        }//if value
+    }//if entryIter
+    else
+    {
+        newEntry.configID = configID;
+        newEntry.value = newString;
+        configFile->entryIndex[configID] = configFile->entries.size();
+        configFile->entries.push_back(newEntry);
+        changed = true;
+    }//else entryIter
+
+    //### Schedule a write, unless one is already waiting ###
+    if ((changed) && (!configFile->writePending))
+    {
+        configFile->writePending = true;
 
-            if (infile.good())
-            {
-                if (oneLine.size() > 0)
-                {
-                    if (readEntry(oneLine, infile, configID, newString,
-                        fileComments, fileIDs, fileValues, pathAndName))
-                    foundValue = true;
-                }//if size()
-            }//if good()
-        }//while good()
-    }//if good()
+        if (writePool == NULL)
+        {
+            writePool = new QThreadPool;
+            writePool->setMaxThreadCount(1);
+        }//if writePool
+
+        writePool->start(new ConfigWriteTask(fileName));
+    }//if changed && !writePending
 
-    //### Close the input file ###
-    if (infile.is_open())
-        infile.close();
+    //Watchers may load values, so don't hold the lock while notifying them
+    locker.unlock();
 
-    //### Open the output file ###
-    outfile.open(pathAndName.c_str());
-    if (!outfile.good())
+    //### Tell everyone about the new value ###
+    //Watchers can add and remove watchers, so notify a copy of the list
+    if (changed)
     {
-        cout << "ConfigWriter couldn't open " << pathAndName << " for writing" << endl;
-        throw 1;
-    }//if !good()
+        currentWatchers = watchers;
+        for (unsigned int i = 0; i < currentWatchers.size(); i++)
+            currentWatchers.at(i)->configChanged(fileName, configID);
+    }//if changed
+}//writeString
+
+void ConfigWriter::writeFile(const string &fileName)
+{
+    NGConfigFile *configFile = NULL;//the contents of fileName
+    NGConfigEntry *oneEntry = NULL;//a single entry to write
+    ostringstream fileText;//the new contents of the file
+    string pathAndName;//the path to the file, including the file name
+    QByteArray fileData;//fileText, ready to write
+    bool result = true;//false if the file couldn't be written
+
+    //### Give the program a chance to make more changes ###
+    QThread::msleep(WRITE_DELAY);
+
+    //### Copy the file contents, so the lock isn't held while writing ###
+    QMutexLocker locker(&cacheMutex);//the GUI thread changes configFiles
+    pathAndName = path;
+    pathAndName.append(fileName);
+    configFile = configFiles[fileName];
+    configFile->writePending = false;
 
-    //### Write the new config file ###
-    for (unsigned int i = 0; i < fileComments.size(); i++)
+    for (unsigned int i = 0; i < configFile->entries.size(); i++)
     {
-        commentGroup = fileComments.at(i);
-        for (unsigned int j = 0; j < commentGroup->size(); j++)
-            outfile << commentGroup->get(j) << endl;
+        oneEntry = &configFile->entries.at(i);
 
-        outfile << fileIDs.at(i) << endl;
-        outfile << fileValues.at(i) << endl;
-        outfile << endl;
+        for (unsigned int j = 0; j < oneEntry->comments.size(); j++)
+            fileText << oneEntry->comments.get(j) << endl;
 
-        if (!outfile.good())
-        {
-            cout << "ConfigWriter: error writing to file " << pathAndName << endl;
-            throw 1;
-        }//if !good()
+        fileText << "%" << oneEntry->configID << endl;
+        fileText << ">" << oneEntry->value << endl;
+        fileText << endl;
     }//for i
+    locker.unlock();
+
+    //### Replace the file, so it's never left half written ###
+    QSaveFile outfile(QString::fromLocal8Bit(pathAndName.c_str()));
+    fileData = QByteArray(fileText.str().data(), fileText.str().size());
+
+    if (!outfile.open(QIODevice::WriteOnly | QIODevice::Text))
+        result = false;
+    else if (outfile.write(fileData) != fileData.size())
+        result = false;
+    else if (!outfile.commit())
+        result = false;
+
+    //### We're on the write thread, so throwing would end the program ###
+    if (!result)
+        cout << "ConfigWriter: error writing to file " << pathAndName << endl;
+}//writeFile
 
-    //### Create a new entry if no existing entry was found ###
-    if (!foundValue)
+void ConfigWriter::flush(void)
+{
+    if (writePool != NULL)
     {
-        outfile << "%" << configID << endl;
-        outfile << ">" << newString << endl;
-        outfile << endl;
-        if (!outfile.good())
-        {
-            cout << "ConfigWriter: error writing to file " << pathAndName << endl;
-            throw 1;
-        }//if !good()
-    }//if !foundValue
+        writePool->waitForDone();
+        delete writePool;
+        writePool = NULL;
+    }//if writePool
+}//flush
 
-    //### Close the output file ###
-    if (outfile.is_open())
-        outfile.close();
+void ConfigWriter::addWatcher(ConfigWatcher *watcher)
+{
+    watchers.push_back(watcher);
+}//addWatcher
 
-    //### Free memory ###
-    for (unsigned int i = 0; i < fileComments.size(); i++)
+void ConfigWriter::removeWatcher(ConfigWatcher *watcher)
+{
+    vector <ConfigWatcher*>::iterator watchIter = watchers.begin();//the watcher to examine
+
+    while (watchIter != watchers.end())
     {
-        delete fileComments.at(i);
-        fileComments.at(i) = NULL;
-    }//for i
-    fileComments.clear();
-}//writeString
+        if (*watchIter == watcher)
+            watchIter = watchers.erase(watchIter);
+        else
+            watchIter++;
+    }//while watchIter
+}//removeWatcher
 
-bool ConfigWriter::readEntry(string oneLine,
+void ConfigWriter::readEntry(string oneLine,
                              ifstream &infile,
-                             const string &configID,
-                             const string &newString,
-                             vector <ConfigComments*> &fileComments,
-                             vector <string> &fileIDs,
-                             vector <string> &fileValues,
+                             NGConfigEntry &newEntry,
                              const string &pathAndName)
 {
-    ConfigComments *commentGroup = NULL;//a group of comments for a single entry
-    string currentID;//the current config ID read from file
-    string newValue;//the new value to use, equal to > plus newString
-    bool result = false;//true if we found configID and replaced it's value with newString
     bool readComments = true;//set to false when we've finished reading comments
 
     //### Verify that oneLine is a comment or ID ###
@@ -246,11 +307,9 @@ bool ConfigWriter::readEntry(string oneLine,
     }//if oneLine && oneLine
 
     //### Read comments ###
-    commentGroup = new ConfigComments;
-    fileComments.push_back(commentGroup);
     if (oneLine.at(0) == '#')
     {
-        commentGroup->add(oneLine);
+        newEntry.comments.add(oneLine);
 
         while (readComments)
         {
@@ -272,7 +331,7 @@ bool ConfigWriter::readEntry(string oneLine,
             }//if size()
 
             if (oneLine.at(0) == '#')
-                commentGroup->add(oneLine);
+                newEntry.comments.add(oneLine);
             else if (oneLine.at(0) == '%')
                 readComments = false;
             else
@@ -291,15 +350,7 @@ bool ConfigWriter::readEntry(string oneLine,
         throw 1;
     }//if size()
 
-    //### See if the config ID matches the ID to change ###
-    fileIDs.push_back(oneLine);
-    currentID = oneLine;
-    currentID.erase(0, 1);
-    if (currentID == configID)
-    {
-        //cout << "Found ID " << configID << endl;
-        result = true;
-    }//if currentID
+    newEntry.configID = oneLine.substr(1);
 
     //### Read the value ###
     getline(infile, oneLine);
@@ -308,7 +359,7 @@ bool ConfigWriter::readEntry(string oneLine,
     {
         if (!infile.eof())
         {
-            cout << "ConfigWriter: expected value after ID " << fileIDs.at(fileIDs.size() - 1)
+            cout << "ConfigWriter: expected value after ID %" << newEntry.configID
                  << " in file " << pathAndName << endl;
             throw 1;
         }//if !eof()
@@ -317,7 +368,7 @@ bool ConfigWriter::readEntry(string oneLine,
     //### Verify that there was a value present in the file ###
     if (oneLine.size() <= 1)
     {
-        cout << "ConfigWriter: expected value after ID " << fileIDs.at(fileIDs.size() - 1)
+        cout << "ConfigWriter: expected value after ID %" << newEntry.configID
              << " in file " << pathAndName << endl;
         throw 1;
     }//if size()
@@ -325,22 +376,12 @@ bool ConfigWriter::readEntry(string oneLine,
     //### Verify that the value is preceeded by > ###
     if (oneLine.at(0) != '>')
     {
-        cout << "ConfigWriter expected > to preceed the value for "
-             << fileIDs.at(fileIDs.size() - 1) << " in file " << pathAndName << endl;
+        cout << "ConfigWriter expected > to preceed the value for %"
+             << newEntry.configID << " in file " << pathAndName << endl;
         throw 1;
     }//if oneLine
 
-    //### Use the new value, if the config ID matches ###
-    if (result)
-    {
-        newValue = ">";
-        newValue.append(newString);
-        fileValues.push_back(newValue);
-    }//if result
-    else
-        fileValues.push_back(oneLine);
-
-    return result;
+    newEntry.value = oneLine.substr(1);
 }//readEntry
 
 int ConfigWriter::loadInt(const string &fileName,
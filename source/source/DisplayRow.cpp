@@ -27,10 +27,17 @@ DisplayRow::DisplayRow(WhiteBoard *newWhiteBoard,
                        uint8_t newSize,
                        int y)
 {
+    NetSprite *oneSprite = NULL;//the sprite being created
+
     whiteBoard = newWhiteBoard;
+    rowHash = 0;
 
     for (unsigned int x = 0; x < newSize; x++)
-        theSprites.push_back(new NetSprite(NULL, whiteBoard, x, y));
+    {
+        oneSprite = new NetSprite(NULL, whiteBoard, x, y);
+        theSprites.push_back(oneSprite);
+        rowHash ^= getCellHash(x, oneSprite->getChar(), oneSprite->getAttributes(), oneSprite->getServerTile());
+    }//for x
 }//constructor
 
 DisplayRow::~DisplayRow(void)
@@ -40,12 +47,42 @@ DisplayRow::~DisplayRow(void)
     theSprites.clear();
 }//destructor
 
+void DisplayRow::addToScene(QGraphicsScene *theScene)
+{
+    for (unsigned int i = 0; i < theSprites.size(); i++)
+        theScene->addItem(theSprites.at(i));
+}//addToScene
+
 void DisplayRow::removeFromScene(QGraphicsScene *theScene)
 {
     for (unsigned int i = 0; i < theSprites.size(); i++)
         theScene->removeItem(theSprites.at(i));
 }//removeFromScene
 
+void DisplayRow::setRow(int y)
+{
+    for (unsigned int i = 0; i < theSprites.size(); i++)
+        theSprites.at(i)->setRow(y);
+}//setRow
+
+void DisplayRow::updateGeometry(int y)
+{
+    for (unsigned int i = 0; i < theSprites.size(); i++)
+        theSprites.at(i)->updateGeometry(y);
+}//updateGeometry
+
+void DisplayRow::setVisible(bool visible)
+{
+    for (unsigned int i = 0; i < theSprites.size(); i++)
+        theSprites.at(i)->setVisible(visible);
+}//setVisible
+
+void DisplayRow::setOffscreen(bool offscreen)
+{
+    for (unsigned int i = 0; i < theSprites.size(); i++)
+        theSprites.at(i)->setOffscreen(offscreen);
+}//setOffscreen
+
 unsigned int DisplayRow::size(void)
 {
     return theSprites.size();
@@ -53,11 +90,50 @@ unsigned int DisplayRow::size(void)
 
 void DisplayRow::setChar(uint8_t index,
                          uint8_t value,
-                         SGRAttribute *writeAttributes)
+                         SGRAttribute *writeAttributes,
+                         int serverTile)
 {
-    theSprites.at(index)->setChar(value, writeAttributes);
+    NetSprite *oneSprite = theSprites.at(index);//the sprite being written
+
+    //### Swap the old cell out of the hash and the new one in ###
+    rowHash ^= getCellHash(index, oneSprite->getChar(), oneSprite->getAttributes(), oneSprite->getServerTile());
+    oneSprite->setChar(value, writeAttributes, serverTile);
+    rowHash ^= getCellHash(index, oneSprite->getChar(), oneSprite->getAttributes(), oneSprite->getServerTile());
 }//setChar
 
+quint64 DisplayRow::getHash(void)
+{
+    return rowHash;
+}//getHash
+
+quint64 DisplayRow::mixHash(quint64 value)
+{
+    //The splitmix64 finalizer
+    value = (value ^ (value >> 30)) * Q_UINT64_C(0xbf58476d1ce4e5b9);
+    value = (value ^ (value >> 27)) * Q_UINT64_C(0x94d049bb133111eb);
+    return value ^ (value >> 31);
+}//mixHash
+
+quint64 DisplayRow::getCellHash(uint8_t index,
+                                uint8_t value,
+                                SGRAttribute *attributes,
+                                int serverTile)
+{
+    quint64 packed = 0;//every field of the cell in its own bits
+
+    packed = value;
+    packed |= quint64(attributes->getForeground() & 0xF) << 8;
+    packed |= quint64(attributes->getBackground() & 0xF) << 12;
+    packed |= quint64(attributes->getBold()) << 16;
+    packed |= quint64(attributes->getInverse()) << 17;
+    packed |= quint64(attributes->getInvisible()) << 18;
+    packed |= quint64(attributes->getUnderlined()) << 19;
+    packed |= quint64(index) << 24;
+    packed |= quint64(quint32(serverTile + 1)) << 32;
+
+    return mixHash(packed);
+}//getCellHash
+
 uint8_t DisplayRow::getChar(uint8_t index)
 {
     return theSprites.at(index)->getChar();
@@ -72,3 +148,8 @@ SGRAttribute* DisplayRow::getAttributes(uint8_t index)
 {
     return theSprites.at(index)->getAttributes();
 }//getAttributes
+
+int DisplayRow::getServerTile(uint8_t index)
+{
+    return theSprites.at(index)->getServerTile();
+}//getServerTile
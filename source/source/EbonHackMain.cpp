@@ -19,7 +19,11 @@ This file is part of EbonHack.
 #include <iostream>
 #include <string>
 #include <QApplication>
+#include <QString>
 #include "WhiteBoard.hpp"
+#include "ConfigWriter.hpp"
+#include "RuleLoader.hpp"
+#include "NGSettings.hpp"
 
 int main(int argc,
          char *argv[])
@@ -28,16 +32,21 @@ int main(int argc,
     WhiteBoard *whiteBoard = NULL;//contains the program
     std::string parameter;//a command-line parameter
     bool debugMode = false;//true if we should output debugging information
+    bool benchmarkRules = false;//true if we should time the graphics rules instead of running
+    bool benchmarkRender = false;//true if we should time rendering a recorded session instead
+    bool exportFrames = false;//true if we should render a recorded session to frames instead
+    bool exportPipe = false;//true if the frames go to an encoder command rather than PNGs
+    QString exportTarget;//the PNG directory or encoder command
     int result = 0;//return value for this program
 
     //### Verify that a proper number of parameters was given ###
-    if (argc > 2)
+    if (argc > 3)
     {
-         std::cout << "Usage: ebonhack [--debug]" << std::endl;
+         std::cout << "Usage: ebonhack [--debug | --benchmark-rules | --benchmark-render | --export-frames DIR | --export-pipe COMMAND]" << std::endl;
          result = 1;
     }//else if argc
 
-    //### Check for the --debug parameter ###
+    //### Check for the --debug, --benchmark and --export parameters ###
     if (result == 0)
     {
         if (argc == 2)
@@ -45,16 +54,62 @@ int main(int argc,
             parameter = argv[1];
             if (parameter == "--debug")
                 debugMode = true;
+            else if (parameter == "--benchmark-rules")
+                benchmarkRules = true;
+            else if (parameter == "--benchmark-render")
+                benchmarkRender = true;
             else
             {
-                std::cout << "Usage: ebonhack [--debug]" << std::endl;
+                std::cout << "Usage: ebonhack [--debug | --benchmark-rules | --benchmark-render | --export-frames DIR | --export-pipe COMMAND]" << std::endl;
                 result = 1;
             }//else argv
         }//if argc
+
+        else if (argc == 3)
+        {
+            parameter = argv[1];
+            exportTarget = QString::fromLocal8Bit(argv[2]);
+            if (parameter == "--export-frames")
+                exportFrames = true;
+            else if (parameter == "--export-pipe")
+            {
+                exportFrames = true;
+                exportPipe = true;
+            }//else if parameter
+            else
+            {
+                std::cout << "Usage: ebonhack [--debug | --benchmark-rules | --benchmark-render | --export-frames DIR | --export-pipe COMMAND]" << std::endl;
+                result = 1;
+            }//else argv
+        }//else if argc
     }//if result
 
+    //### Time the graphics rules against a corpus of first lines ###
+    if ((result == 0) && (benchmarkRules))
+    {
+        if (!RuleLoader::benchmark(NGSettings::DATA_PATH + "gfxrules.txt",
+                                   NGSettings::DATA_PATH + "toplines.txt"))
+            result = 1;
+    }//if result && benchmarkRules
+
+    //### Time rendering a recorded session, run with QT_QPA_PLATFORM=offscreen for no display ###
+    else if ((result == 0) && (benchmarkRender))
+    {
+        whiteBoard = new WhiteBoard(&qtApp, false);
+        if (!whiteBoard->benchmarkRender())
+            result = 1;
+    }//if result && benchmarkRender
+
+    //### Render a recorded session to PNGs or an encoder, also without a display ###
+    else if ((result == 0) && (exportFrames))
+    {
+        whiteBoard = new WhiteBoard(&qtApp, false);
+        if (!whiteBoard->exportFrames(exportTarget, exportPipe))
+            result = 1;
+    }//if result && exportFrames
+
     //### Run the program ###
-    if (result == 0)
+    else if (result == 0)
     {
         whiteBoard = new WhiteBoard(&qtApp, debugMode);
         result = whiteBoard->run();
@@ -64,6 +119,9 @@ int main(int argc,
     delete whiteBoard;
     whiteBoard = NULL;
 
+    //### Finish writing config changes ###
+    ConfigWriter::flush();
+
     std::cout << "Program halted." << std::endl;
 
     return result;
@@ -83,18 +83,27 @@ bool FXRule::checkRule(const std::string &firstLine,
 
     if (theRule.indexIn(QString::fromStdString(firstLine), 0, QRegExp::CaretAtZero) >= 0)
     {
-        if (action == NGFX_ENABLE)
-            useGraphics = true;
-        else if (action == NGFX_DISABLE)
-            useGraphics = false;
-        else
-        {
-            cout << "FXRule::checkRule(): invalid action detected" << endl;
-            throw 1;
-        }//else action
-
+        applyAction(useGraphics);
         result = true;
     }//if indexIn()
 
     return result;
 }//checkRule
+
+void FXRule::applyAction(bool &useGraphics)
+{
+    if (action == NGFX_ENABLE)
+        useGraphics = true;
+    else if (action == NGFX_DISABLE)
+        useGraphics = false;
+    else
+    {
+        cout << "FXRule::applyAction(): invalid action detected" << endl;
+        throw 1;
+    }//else action
+}//applyAction
+
+string FXRule::getPattern(void)
+{
+    return theRule.pattern().toStdString();
+}//getPattern
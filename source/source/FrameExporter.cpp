@@ -0,0 +1,246 @@
+/*Copyright 2009-2013 David McCallum
+
+This file is part of EbonHack.
+
+    EbonHack is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    EbonHack is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with EbonHack.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FrameExporter.hpp"
+#include "WhiteBoard.hpp"
+#include "MainWindow.hpp"
+#include "NethackFX.hpp"
+#include "TelnetProtocol.hpp"
+#include "TileCache.hpp"
+#include <QApplication>
+#include <QGraphicsScene>
+#include <QDir>
+#include <QProcess>
+#include <QThread>
+#include <QFuture>
+#include <QtConcurrent/QtConcurrentRun>
+#include <iostream>
+#include <list>
+#include <cmath>
+
+using namespace std;
+
+bool FrameExporter::exportPNG(WhiteBoard *whiteBoard,
+                              const string &sessionFile,
+                              const QString &directory)
+{
+    vector <QByteArray> theSession;//every batch of data in the session
+    QImage frame;//the offscreen "display"
+    QImage lastFrame;//the last frame saved
+    QDir outDir(directory);//where the PNGs go
+    list < QFuture<bool> > pending;//PNGs being encoded on the thread pool
+    int maxPending = max(QThread::idealThreadCount(), 1) * PENDING_PER_THREAD;
+    unsigned int numSaved = 0;//frames saved so far
+    bool result = true;//false on errors
+
+    //### Create the output directory ###
+    if (!outDir.mkpath("."))
+    {
+        cout << "FrameExporter::exportPNG(): couldn't create " << directory.toStdString() << endl;
+        result = false;
+    }//if !mkpath()
+
+    if (result)
+        result = startExport(whiteBoard, sessionFile, theSession, frame);
+
+    for (unsigned int i = 0; (result) && (i < theSession.size()); i++)
+    {
+        //### Render the batch, and encode it if it changed the picture ###
+        if (renderBatch(whiteBoard, theSession.at(i), frame, lastFrame))
+        {
+            //Wait for the oldest PNG if the pool is already busy
+            if (static_cast<int>(pending.size()) >= maxPending)
+            {
+                if (!pending.front().result())
+                    result = false;
+                pending.pop_front();
+            }//if size()
+
+            pending.push_back(QtConcurrent::run(savePNG, frame,
+                              outDir.filePath(QString("frame_%1.png").arg(i, 6, 10, QChar('0')))));
+            lastFrame = frame;
+            numSaved++;
+        }//if renderBatch()
+    }//for i
+
+    //### Wait for the rest of the PNGs ###
+    while (!pending.empty())
+    {
+        if (!pending.front().result())
+            result = false;
+        pending.pop_front();
+    }//while !empty()
+
+    if (result)
+        cout << "Saved " << numSaved << " of " << theSession.size() << " frames to "
+             << directory.toStdString() << endl;
+
+    return result;
+}//exportPNG
+
+bool FrameExporter::exportPipe(WhiteBoard *whiteBoard,
+                               const string &sessionFile,
+                               const QString &command)
+{
+    vector <QByteArray> theSession;//every batch of data in the session
+    QImage frame;//the offscreen "display"
+    QImage lastFrame;//the last frame written
+    QProcess encoder;//reads the raw frames from its standard input
+    QString frameSize;//WIDTHxHEIGHT
+    QString fullCommand;//command with %SIZE% filled in
+    unsigned int numWritten = 0;//frames written so far
+    bool result = true;//false on errors
+
+    result = startExport(whiteBoard, sessionFile, theSession, frame);
+
+    //### Start the encoder ###
+    if (result)
+    {
+        frameSize = QString("%1x%2").arg(frame.width()).arg(frame.height());
+        fullCommand = command;
+        fullCommand.replace("%SIZE%", frameSize);
+
+        cout << "Writing " << frameSize.toStdString() << " bgra frames to: "
+             << fullCommand.toStdString() << endl;
+
+        encoder.setProcessChannelMode(QProcess::ForwardedChannels);
+        encoder.start(fullCommand, QIODevice::WriteOnly);
+        if (!encoder.waitForStarted(PIPE_TIMEOUT))
+        {
+            cout << "FrameExporter::exportPipe(): couldn't start " << fullCommand.toStdString() << endl;
+            result = false;
+        }//if !waitForStarted()
+    }//if result
+
+    for (unsigned int i = 0; (result) && (i < theSession.size()); i++)
+    {
+        //### Render the batch, and write it if it changed the picture ###
+        if (renderBatch(whiteBoard, theSession.at(i), frame, lastFrame))
+        {
+            if (encoder.write(reinterpret_cast<const char*>(frame.constBits()), frame.byteCount())
+                != frame.byteCount())
+                result = false;
+
+            //Let the encoder catch up, rather than buffering the whole session
+            while ((result) && (encoder.bytesToWrite() > MAX_PIPE_BUFFER))
+            {
+                if (!encoder.waitForBytesWritten(PIPE_TIMEOUT))
+                    result = false;
+            }//while bytesToWrite()
+
+            if (!result)
+                cout << "FrameExporter::exportPipe(): the encoder stopped reading" << endl;
+
+            lastFrame = frame;
+            numWritten++;
+        }//if renderBatch()
+    }//for i
+
+    //### Let the encoder finish ###
+    if (encoder.state() != QProcess::NotRunning)
+    {
+        while ((result) && (encoder.bytesToWrite() > 0))
+        {
+            if (!encoder.waitForBytesWritten(PIPE_TIMEOUT))
+                result = false;
+        }//while bytesToWrite()
+
+        encoder.closeWriteChannel();
+        encoder.waitForFinished(-1);
+
+        if ((encoder.exitStatus() != QProcess::NormalExit) || (encoder.exitCode() != 0))
+        {
+            cout << "FrameExporter::exportPipe(): the encoder failed" << endl;
+            result = false;
+        }//if exitStatus()
+    }//if state()
+
+    if (result)
+        cout << "Wrote " << numWritten << " of " << theSession.size() << " frames" << endl;
+
+    return result;
+}//exportPipe
+
+bool FrameExporter::startExport(WhiteBoard *whiteBoard,
+                                const string &sessionFile,
+                                vector <QByteArray> &theSession,
+                                QImage &theFrame)
+{
+    MainWindow *mainWindow = whiteBoard->getMainWindow();
+    NethackFX *netFX = whiteBoard->getNetFX();
+    QRectF sceneRect;//the area to render
+    double zoom = 1;//the zoom chosen by the user
+    bool result = true;//false on errors
+
+    //### Load the session and wait for the user's tileset ###
+    result = TelnetProtocol::loadSession(sessionFile, theSession);
+
+    if (result)
+    {
+        if (!netFX->finishLoading(true))
+        {
+            cout << "FrameExporter::startExport(): couldn't load the tiles" << endl;
+            result = false;
+        }//if !finishLoading()
+    }//if result
+
+    //### Scale the tiles and size the frame for the user's zoom ###
+    if (result)
+    {
+        zoom = mainWindow->getZoom();
+        mainWindow->setZoom(zoom);
+        netFX->getTileCache()->waitForScaling();
+
+        sceneRect = mainWindow->getScene()->sceneRect();
+        theFrame = QImage(static_cast<int>(ceil(sceneRect.width() * zoom)),
+                          static_cast<int>(ceil(sceneRect.height() * zoom)),
+                          QImage::Format_ARGB32_Premultiplied);
+
+        whiteBoard->getTelnetPro()->startReplay();
+    }//if result
+
+    return result;
+}//startExport
+
+bool FrameExporter::renderBatch(WhiteBoard *whiteBoard,
+                                const QByteArray &theBatch,
+                                QImage &theFrame,
+                                const QImage &lastFrame)
+{
+    whiteBoard->getTelnetPro()->parseData(theBatch);
+    whiteBoard->getMainWindow()->renderScene(theFrame);
+
+    //### Let the timers and background scaling run ###
+    whiteBoard->getQTApp()->processEvents();
+
+    return (theFrame != lastFrame);
+}//renderBatch
+
+bool FrameExporter::savePNG(QImage theFrame,
+                            QString filename)
+{
+    bool result = true;//false on errors
+
+    if (!theFrame.save(filename, "PNG"))
+    {
+        cout << "FrameExporter::savePNG(): couldn't save " << filename.toStdString() << endl;
+        result = false;
+    }//if !save()
+
+    return result;
+}//savePNG
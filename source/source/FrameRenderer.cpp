@@ -0,0 +1,474 @@
+/*Copyright 2009-2013 David McCallum
+
+This file is part of EbonHack.
+
+    EbonHack is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    EbonHack is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with EbonHack.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FrameRenderer.hpp"
+#include "WhiteBoard.hpp"
+#include "NGSettings.hpp"
+#include "NethackFX.hpp"
+#include "NetSprite.hpp"
+#include "TelnetProtocol.hpp"
+#include "TelnetWindow.hpp"
+#include "TileCache.hpp"
+#include "ConfigWriter.hpp"
+#include "NGTrace.hpp"
+#include <QPainter>
+#include <QFontDatabase>
+#include <QMutexLocker>
+#include <QTransform>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+FrameRenderer::FrameRenderer(WhiteBoard *newWhiteBoard) : QGraphicsObject(NULL)
+{
+    whiteBoard = newWhiteBoard;
+
+    rebuildJob = NULL;
+    currentJob = NULL;
+    windowWidth = 0;
+    windowHeight = 0;
+    atlasZoom = 1;
+    glyphOffset = 0;
+    frontFrame = 0;
+    frameZoom = 1;
+    jobZoom = 1;
+    threadedFonts = QFontDatabase::supportsThreadedFontRendering();
+
+    //### Clicks go to the sprites underneath ###
+    setAcceptedMouseButtons(Qt::NoButton);
+
+    startTimer.setSingleShot(true);
+    startTimer.setInterval(0);
+    connect(&startTimer, SIGNAL(timeout()),
+            this, SLOT(startFrame()));
+    connect(&frameWatcher, SIGNAL(finished()),
+            this, SLOT(frameFinished()));
+
+    ConfigWriter::addWatcher(this);
+}//constructor
+
+FrameRenderer::~FrameRenderer(void)
+{
+    ConfigWriter::removeWatcher(this);
+    frameWatcher.waitForFinished();
+
+    delete currentJob;
+    currentJob = NULL;
+
+    delete rebuildJob;
+    rebuildJob = NULL;
+}//destructor
+
+QRectF FrameRenderer::boundingRect(void) const
+{
+    return QRectF(0, 0, windowWidth * spriteSize.width(), windowHeight * spriteSize.height());
+}//boundingRect
+
+void FrameRenderer::paint(QPainter *painter,
+                          const QStyleOptionGraphicsItem *option,
+                          QWidget *widget)
+{
+    NG_TRACE_SPAN("FrameRenderer::paint");
+    QMutexLocker locker(&frameMutex);
+    QTransform deviceTransform;//maps the frame to viewport pixels
+
+    //### Get rid of compiler warnings about unused parameters ###
+    if (option)
+    {
+    }
+    if (widget)
+    {
+    }
+
+    //### Nothing has been drawn yet ###
+    if (frames[frontFrame].isNull())
+        painter->fillRect(boundingRect(), Qt::black);
+
+    //### Blit the frame, 1:1 if it was drawn at the view's zoom ###
+    else
+    {
+        painter->save();
+        painter->scale(1 / frameZoom, 1 / frameZoom);
+
+        deviceTransform = painter->transform();
+        if ((fabs(deviceTransform.m11() - 1) < TileCache::ZOOM_TOLERANCE)
+            && (fabs(deviceTransform.m22() - 1) < TileCache::ZOOM_TOLERANCE))
+        {
+            painter->setTransform(QTransform::fromTranslate(qRound(deviceTransform.dx()),
+                                                            qRound(deviceTransform.dy())));
+        }//if m11 && m22
+
+        painter->drawImage(0, 0, frames[frontFrame]);
+        painter->restore();
+    }//else isNull()
+}//paint
+
+void FrameRenderer::markRow(int sceneRow)
+{
+    int row = sceneRow - NGSettings::getHistoryLines();//the row in the telnet window
+
+    if ((row >= 0) && (row < static_cast<int>(dirtyRows.size())))
+    {
+        dirtyRows.at(row) = true;
+
+        //### Wait for the rest of the batch before starting a frame ###
+        if ((!frameWatcher.isRunning()) && (!startTimer.isActive()))
+            startTimer.start();
+    }//if row
+}//markRow
+
+void FrameRenderer::reset(double newZoom)
+{
+    TelnetWindow *telnetWindow = whiteBoard->getTelnetPro()->getTelnetWindow();
+    NethackFX *netFX = whiteBoard->getNetFX();
+    QPixmap *oneTile = NULL;//a tile to copy into the atlas
+    string filterName = ConfigWriter::loadString("game_config.txt", "Zoom Filter");
+
+    //### The window may have changed size ###
+    prepareGeometryChange();
+    windowWidth = telnetWindow->getWidth();
+    windowHeight = telnetWindow->getHeight();
+    spriteSize = QSize(NGSettings::getSpriteWidth(), NGSettings::getSpriteHeight());
+    setPos(0, NGSettings::getHistoryLines() * spriteSize.height());
+
+    //### Collect the settings for the next frame ###
+    delete rebuildJob;
+    rebuildJob = new NGFrameJob;
+    rebuildJob->rebuild = true;
+    rebuildJob->font = *NGSettings::getTelnetFont();
+    rebuildJob->fontOffset = NGSettings::getFontOffset();
+    rebuildJob->spriteSize = spriteSize;
+    rebuildJob->zoom = newZoom;
+    rebuildJob->windowWidth = windowWidth;
+    rebuildJob->windowHeight = windowHeight;
+
+    if (filterName == "NEAREST")
+        rebuildJob->filter = Qt::FastTransformation;
+    else
+        rebuildJob->filter = Qt::SmoothTransformation;
+
+    //### Text can only be drawn on the GUI thread on some platforms ###
+    jobZoom = newZoom;
+    drawnGlyphs.clear();
+    if (!threadedFonts)
+        rebuildJob->glyphAtlas = drawGlyphAtlas(rebuildJob->font, rebuildJob->fontOffset, spriteSize, newZoom);
+
+    //### Copy the tiles, the worker thread can't use pixmaps ###
+    tileIndices.clear();
+    if (netFX->getAssetsReady())
+    {
+        for (unsigned int i = 0; (oneTile = netFX->getImage(i)) != NULL; i++)
+        {
+            rebuildJob->tiles.push_back(oneTile->toImage());
+            tileIndices.insert(oneTile->cacheKey(), i);
+        }//for i
+    }//if getAssetsReady()
+
+    //### Redraw everything ###
+    dirtyRows.assign(windowHeight, true);
+    lastRows.assign(windowHeight, false);
+
+    if (!frameWatcher.isRunning())
+        startTimer.start();
+}//reset
+
+void FrameRenderer::startFrame(void)
+{
+    NG_TRACE_SPAN("FrameRenderer::startFrame");
+    TelnetWindow *telnetWindow = whiteBoard->getTelnetPro()->getTelnetWindow();
+    NetSprite *oneSprite = NULL;//the sprite being copied
+    QPixmap *oneTile = NULL;//the tile the sprite is showing, or NULL for text
+    NGFrameCell oneCell;//a copy of oneSprite
+    int glyphKey = 0;//key of a character outside the atlas
+    int firstChanged = -1;//the first and last rows that will look different
+    int lastChanged = -1;
+    bool anyDirty = (find(dirtyRows.begin(), dirtyRows.end(), true) != dirtyRows.end());//true if any row changed
+
+    //### One frame at a time, and only if something changed ###
+    if ((!frameWatcher.isRunning()) && ((anyDirty) || (rebuildJob != NULL)))
+    {
+        if (rebuildJob != NULL)
+        {
+            currentJob = rebuildJob;
+            rebuildJob = NULL;
+        }//if rebuildJob
+        else
+        {
+            currentJob = new NGFrameJob;
+            currentJob->rebuild = false;
+        }//else rebuildJob
+
+        //### Copy the rows, the back image also needs the last frame's ###
+        for (int y = 0; y < windowHeight; y++)
+        {
+            if ((dirtyRows.at(y)) || (lastRows.at(y)))
+            {
+                currentJob->rows.push_back(y);
+
+                for (int x = 0; x < windowWidth; x++)
+                {
+                    oneSprite = telnetWindow->getNetSprite(x, y);
+                    oneTile = oneSprite->getDisplayedTile();
+
+                    oneCell.telnetChar = oneSprite->getChar();
+                    oneCell.color = oneSprite->getAttributes()->getForeground();
+                    if (oneTile == NULL)
+                        oneCell.tileIndex = -1;
+                    else
+                        oneCell.tileIndex = tileIndices.value(oneTile->cacheKey(), -1);
+
+                    //### Draw characters outside the atlas here if the worker can't ###
+                    if ((!threadedFonts) && (oneCell.tileIndex < 0)
+                        && ((oneCell.telnetChar < TileCache::FIRST_PRINTABLE) || (oneCell.telnetChar > TileCache::LAST_PRINTABLE)))
+                    {
+                        glyphKey = TileCache::getGlyphKey(oneCell.telnetChar, oneCell.color);
+                        if (!drawnGlyphs.contains(glyphKey))
+                        {
+                            currentJob->glyphs.insert(glyphKey, TileCache::renderGlyph(oneCell.telnetChar, oneCell.color,
+                                                                                       *NGSettings::getTelnetFont(),
+                                                                                       NGSettings::getFontOffset(),
+                                                                                       spriteSize, jobZoom));
+                            drawnGlyphs.insert(glyphKey);
+                        }//if !contains()
+                    }//if !threadedFonts && tileIndex && telnetChar
+
+                    currentJob->cells.push_back(oneCell);
+                }//for x
+            }//if dirtyRows || lastRows
+
+            if (dirtyRows.at(y))
+            {
+                if (firstChanged == -1)
+                    firstChanged = y;
+                lastChanged = y;
+            }//if dirtyRows
+        }//for y
+
+        //### Only the rows changed since the last frame will look different ###
+        if ((currentJob->rebuild) || (firstChanged == -1))
+            changedRect = boundingRect();
+        else
+            changedRect = QRectF(0, firstChanged * spriteSize.height(), windowWidth * spriteSize.width(),
+                                 (lastChanged - firstChanged + 1) * spriteSize.height());
+
+        lastRows = dirtyRows;
+        dirtyRows.assign(windowHeight, false);
+
+        frameWatcher.setFuture(QtConcurrent::run(this, &FrameRenderer::rasterize, currentJob));
+    }//if !isRunning() && anyDirty || rebuildJob
+}//startFrame
+
+void FrameRenderer::frameFinished(void)
+{
+    //### Ignore signals from frames waitForFrames() already finished ###
+    if ((currentJob != NULL) && (frameWatcher.isFinished()))
+    {
+        delete currentJob;
+        currentJob = NULL;
+
+        //### Show the new frame ###
+        update(changedRect);
+
+        //### Draw anything that changed while we were busy ###
+        startFrame();
+    }//if currentJob
+}//frameFinished
+
+void FrameRenderer::waitForFrames(void)
+{
+    startTimer.stop();
+    startFrame();
+
+    while (currentJob != NULL)
+    {
+        frameWatcher.waitForFinished();
+        frameFinished();
+    }//while currentJob
+}//waitForFrames
+
+void FrameRenderer::configChanged(const string &fileName,
+                                  const string &configID)
+{
+    //### Nothing to rebuild until the first reset() ###
+    if ((fileName == "game_config.txt") && (configID == "Zoom Filter") && (windowWidth > 0))
+        reset(jobZoom);
+}//configChanged
+
+void FrameRenderer::rasterize(NGFrameJob *theJob)
+{
+    QPainter painter;//draws into the back image
+    const NGFrameCell *oneCell = NULL;//the cell being drawn
+    QPoint cellPos;//top left corner of the cell in the frame
+    int backFrame = 1 - frontFrame;//only this thread changes frontFrame
+    int y = 0;//the telnet row being drawn
+
+    if (theJob->rebuild)
+    {
+        buildAtlases(theJob);
+
+        frames[backFrame] = QImage(frameSize, QImage::Format_ARGB32_Premultiplied);
+        frames[backFrame].fill(qRgb(0, 0, 0));
+    }//if rebuild
+
+    //### Keep the characters the GUI thread drew for us ###
+    for (QHash <int, QImage>::const_iterator glyphIter = theJob->glyphs.constBegin();
+         glyphIter != theJob->glyphs.constEnd(); glyphIter++)
+        extraGlyphs.insert(glyphIter.key(), glyphIter.value());
+
+    //### Draw the rows into the back image ###
+    painter.begin(&frames[backFrame]);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+
+    for (unsigned int row = 0; row < theJob->rows.size(); row++)
+    {
+        y = theJob->rows.at(row);
+
+        for (int x = 0; x < theJob->windowWidth; x++)
+        {
+            oneCell = &theJob->cells.at(row * theJob->windowWidth + x);
+            cellPos = getCellPos(x, y);
+
+            if (oneCell->tileIndex >= 0)
+                painter.drawImage(cellPos, tileAtlas,
+                                  QRect((oneCell->tileIndex % ATLAS_COLUMNS) * cellSize.width(),
+                                        (oneCell->tileIndex / ATLAS_COLUMNS) * cellSize.height(),
+                                        cellSize.width(), cellSize.height()));
+            else
+                drawGlyph(painter, cellPos, oneCell->telnetChar, oneCell->color);
+        }//for x
+    }//for row
+
+    painter.end();
+
+    //### Swap the finished frame to the front ###
+    frameMutex.lock();
+    frontFrame = backFrame;
+    frameZoom = atlasZoom;
+
+    //The old front image missed everything, it'll be drawn over by the next frame
+    if (theJob->rebuild)
+    {
+        frames[1 - backFrame] = QImage(frameSize, QImage::Format_ARGB32_Premultiplied);
+        frames[1 - backFrame].fill(qRgb(0, 0, 0));
+    }//if rebuild
+
+    frameMutex.unlock();
+}//rasterize
+
+void FrameRenderer::buildAtlases(NGFrameJob *theJob)
+{
+    QPainter painter;//draws into the atlases
+    NGTileScaler tileScaler;//scales the tiles for the zoom
+    int atlasRows = (theJob->tiles.size() + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS;
+
+    atlasZoom = theJob->zoom;
+    glyphFont = theJob->font;
+    glyphOffset = theJob->fontOffset;
+    atlasSpriteSize = theJob->spriteSize;
+    cellSize.setWidth(static_cast<int>(ceil(atlasSpriteSize.width() * atlasZoom)));
+    cellSize.setHeight(static_cast<int>(ceil(atlasSpriteSize.height() * atlasZoom)));
+    frameSize.setWidth(static_cast<int>(ceil(theJob->windowWidth * atlasSpriteSize.width() * atlasZoom)));
+    frameSize.setHeight(static_cast<int>(ceil(theJob->windowHeight * atlasSpriteSize.height() * atlasZoom)));
+
+    //### Scale the tiles into a grid ###
+    tileScaler.tileSize = cellSize;
+    tileScaler.filter = theJob->filter;
+    tileAtlas = QImage(ATLAS_COLUMNS * cellSize.width(), atlasRows * cellSize.height(),
+                       QImage::Format_ARGB32_Premultiplied);
+    tileAtlas.fill(qRgb(0, 0, 0));
+
+    if (!tileAtlas.isNull())
+    {
+        painter.begin(&tileAtlas);
+        for (int i = 0; i < theJob->tiles.size(); i++)
+            painter.drawImage((i % ATLAS_COLUMNS) * cellSize.width(), (i / ATLAS_COLUMNS) * cellSize.height(),
+                              tileScaler(theJob->tiles.at(i)));
+        painter.end();
+    }//if !isNull()
+
+    //### Draw the printable characters, unless the GUI thread already has ###
+    if (theJob->glyphAtlas.isNull())
+        glyphAtlas = drawGlyphAtlas(glyphFont, glyphOffset, atlasSpriteSize, atlasZoom);
+    else
+        glyphAtlas = theJob->glyphAtlas;
+    extraGlyphs.clear();
+}//buildAtlases
+
+QImage FrameRenderer::drawGlyphAtlas(const QFont &theFont,
+                                     int fontOffset,
+                                     QSize spriteSize,
+                                     double zoom)
+{
+    QPainter painter;//draws into the atlas
+    int numGlyphs = TileCache::LAST_PRINTABLE - TileCache::FIRST_PRINTABLE + 1;
+    QSize glyphSize(static_cast<int>(ceil(spriteSize.width() * zoom)),
+                    static_cast<int>(ceil(spriteSize.height() * zoom)));//size of each character
+    QImage result(numGlyphs * glyphSize.width(), (NGSA_WHITE + 1) * glyphSize.height(),
+                  QImage::Format_ARGB32_Premultiplied);//the characters, one row per color
+
+    result.fill(qRgb(0, 0, 0));
+
+    painter.begin(&result);
+    for (int color = NGSA_BLACK; color <= NGSA_WHITE; color++)
+    {
+        for (int i = 0; i < numGlyphs; i++)
+            painter.drawImage(i * glyphSize.width(), color * glyphSize.height(),
+                              TileCache::renderGlyph(TileCache::FIRST_PRINTABLE + i, static_cast<NGS_Attribute>(color),
+                                                     theFont, fontOffset, spriteSize, zoom));
+    }//for color
+    painter.end();
+
+    return result;
+}//drawGlyphAtlas
+
+void FrameRenderer::drawGlyph(QPainter &painter,
+                              QPoint cellPos,
+                              uint8_t telnetChar,
+                              NGS_Attribute color)
+{
+    int glyphKey = TileCache::getGlyphKey(telnetChar, color);
+    QHash <int, QImage>::iterator found;//a character that isn't in the atlas
+
+    //### Printable characters come from the atlas ###
+    if ((telnetChar >= TileCache::FIRST_PRINTABLE) && (telnetChar <= TileCache::LAST_PRINTABLE))
+        painter.drawImage(cellPos, glyphAtlas,
+                          QRect((telnetChar - TileCache::FIRST_PRINTABLE) * cellSize.width(),
+                                color * cellSize.height(), cellSize.width(), cellSize.height()));
+
+    //### Anything else is drawn the first time it's needed, by the GUI thread if the
+    //platform can't draw text here ###
+    else
+    {
+        found = extraGlyphs.find(glyphKey);
+        if ((found == extraGlyphs.end()) && (threadedFonts))
+            found = extraGlyphs.insert(glyphKey, TileCache::renderGlyph(telnetChar, color, glyphFont,
+                                                                        glyphOffset, atlasSpriteSize, atlasZoom));
+
+        if (found != extraGlyphs.end())
+            painter.drawImage(cellPos, found.value());
+    }//else telnetChar
+}//drawGlyph
+
+QPoint FrameRenderer::getCellPos(int x,
+                                 int y)
+{
+    return QPoint(qRound(x * atlasSpriteSize.width() * atlasZoom),
+                  qRound(y * atlasSpriteSize.height() * atlasZoom));
+}//getCellPos
@@ -219,12 +219,6 @@ bool GraphicsSettings::applyChanges(void)
     //### Save settings and close the dialog ###
     if (result)
     {
-        if (graphicsModeChanged)
-        {
-            whiteBoard->showMessage("EbonHack must be restarted for the changes to take effect.");
-            graphicsModeChanged = false;
-        }//if graphicsModeChanged
-
         tilesetChanged = false;
 
         ConfigWriter::writeBool("game_config.txt", "Use Tileset", useTileset);
@@ -236,6 +230,13 @@ bool GraphicsSettings::applyChanges(void)
         ConfigWriter::writeInt("game_config.txt", "Custom Font Size", gui.customFontSizeBox->value());
         ConfigWriter::writeInt("game_config.txt", "History Size", gui.historyLinesBox->value());
 
+        //### Switch between OpenGL and native painting without a restart ###
+        if (graphicsModeChanged)
+        {
+            mainWindow->applyViewport();
+            graphicsModeChanged = false;
+        }//if graphicsModeChanged
+
         mainWindow->resetGraphics();
     }//if result
 
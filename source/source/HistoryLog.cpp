@@ -20,44 +20,47 @@ This file is part of EbonHack.
 #include "WhiteBoard.hpp"
 #include "TelnetProtocol.hpp"
 #include "NetSprite.hpp"
+#include "NethackFX.hpp"
+#include "MessageLog.hpp"
+#include "NGTrace.hpp"
 
 using namespace std;
 
-HistoryLog::HistoryLog(WhiteBoard *newWhiteBoard)
+HistoryLog::HistoryLog(WhiteBoard *newWhiteBoard,
+                       MessageLog *newMessageLog)
 {
     int logLines = NGSettings::getHistoryLines();
-    string blankLine;//a blank line to add to the history buffer
 
     whiteBoard = newWhiteBoard;
+    messageLog = newMessageLog;
     addedToScene = false;
     hidden = false;
-
-    for (int i = 0; i < TelnetProtocol::WINDOW_WIDTH; i++)
-        blankLine.push_back(' ');
+    firstRow = 0;
+    displayStart = 0;
 
     for (int i = 0; i < logLines; i++)
-    {
         history.push_back(new DisplayRow(whiteBoard, TelnetProtocol::WINDOW_WIDTH, i));
-        historyBuf.push_back(new string(blankLine));
-    }//for i
 }//constructor
 
 HistoryLog::~HistoryLog(void)
 {
+    TelnetProtocol *telnetPro = whiteBoard->getTelnetPro();
+
+    //### The telnet window may already be gone ###
+    if (telnetPro != NULL)
+        telnetPro->getTelnetWindow()->removeRowWatches(this);
+
     if (!addedToScene)
     {
         for (unsigned int i = 0; i < history.size(); i++)
             delete history.at(i);
         history.clear();
     }//if !addedToScene
-
-    for (unsigned int i = 0; i < historyBuf.size(); i++)
-        delete historyBuf.at(i);
-    historyBuf.clear();
 }//destructor
 
 void HistoryLog::setGraphicsScene(QGraphicsScene *theScene)
 {
+    TelnetWindow *telnetWindow = whiteBoard->getTelnetPro()->getTelnetWindow();
     DisplayRow *oneRow = NULL;//the current window row
     NetSprite *currentSprite = NULL;//the current sprite to add to the scene
 
@@ -81,10 +84,14 @@ void HistoryLog::setGraphicsScene(QGraphicsScene *theScene)
     }//for y
 
     addedToScene = true;
+
+    //### Watch the first line after NethackFX, so its graphics mode is up to date ###
+    telnetWindow->addRowWatch(this, 0, 1, "");
 }//setGraphicsScene
 
 void HistoryLog::removeFromScene(QGraphicsScene *theScene)
 {
+    TelnetWindow *telnetWindow = whiteBoard->getTelnetPro()->getTelnetWindow();
     DisplayRow *oneRow = NULL;//the current window row
     NetSprite *currentSprite = NULL;//the current sprite to add to the scene
 
@@ -103,22 +110,47 @@ void HistoryLog::removeFromScene(QGraphicsScene *theScene)
 
         addedToScene = false;
     }//if addedToScene
+
+    telnetWindow->removeRowWatches(this);
 }//removeFromScene
 
+void HistoryLog::rowChanged(int watchID,
+                            uint8_t row,
+                            const string &rowText,
+                            bool matched)
+{
+    NethackFX *netFX = whiteBoard->getNetFX();
+    bool showGraphics = netFX->getShowGraphics();//true if the history should be displayed
+
+    //### Get rid of compiler warnings about unused parameters ###
+    if (watchID)
+    {
+    }
+    if (row)
+    {
+    }
+    if (matched)
+    {
+    }
+
+    //### Add the first line to the user's history ###
+    updateLogic(rowText, showGraphics);
+    if (showGraphics)
+        show();
+    else
+        hide();
+}//rowChanged
+
 void HistoryLog::updateLogic(const string &newLine,
                              bool showGraphics)
 {
     TelnetProtocol *telnetPro = whiteBoard->getTelnetPro();
     TelnetWindow *telnetWindow = telnetPro->getTelnetWindow();
-    DisplayRow *source = NULL;//the history line to copy from
-    DisplayRow *dest = NULL;//the history line to write to
-    string *bufDest = NULL;//the historyBuf line to write to
     int charPos = 0;//the index of a character to examine
     int nonSpaceIndex = 0;//the index of the last non-space character in oldHistoryLine
-    int logLines = NGSettings::getHistoryLines();
-    uint8_t oneChar = ' ';//a single character to copy
     bool foundNonSpace = false;//true if the line we're examining has a non-space character
     bool historyReplaced = false;//true if the oldHistoryLine contents were overwritten
+    NG_TRACE_SPAN("HistoryLog::updateLogic");
 
     //### Verify that newLine is the entire first line from the telnet window ###
     if (newLine.size() != static_cast<unsigned int>(TelnetProtocol::WINDOW_WIDTH))
@@ -151,42 +183,13 @@ void HistoryLog::updateLogic(const string &newLine,
             }//if !foundNonSpace
 
             //### See if the history text was overwritten ###
-            charPos = 0;
-            while ((charPos <= nonSpaceIndex) && (!historyReplaced))
-            {
-                if (telnetWindow->charChanged(charPos, 0))
-                    historyReplaced = true;
-                charPos++;
-            }//while charPos && !historyReplaced
+            historyReplaced = telnetWindow->getChangeJournal().getCellsChanged(0, 0, nonSpaceIndex);
 
             //### We have a new history line, add it to the user history ###
             if (historyReplaced)
             {
-                //Shuffle the history up one line
-                for (int y = 1; y < logLines; y++)
-                {
-                    dest = history.at(y - 1);
-                    bufDest = historyBuf.at(y - 1);
-                    source = history.at(y);
-
-                    for (unsigned int x = 0; x < source->size(); x++)
-                    {
-                        oneChar = source->getChar(x);
-                        dest->setChar(x, oneChar, &logAttributes);
-                        bufDest->at(x) = oneChar;
-                    }//for x
-                }//for y
-
-                //Add the oldHistoryLine to the history
-                dest = history.at(logLines - 1);
-                bufDest = historyBuf.at(logLines - 1);
-
-                for (unsigned int i = 0; i < newLine.size(); i++)
-                {
-                    oneChar = oldHistoryLine.at(i);
-                    dest->setChar(i, oneChar, &logAttributes);
-                    bufDest->at(i) = oneChar;
-                }//for i
+                messageLog->append(oldHistoryLine);
+                addDisplayLine(oldHistoryLine);
             }//if historyReplaced
 
             //Clear the old line
@@ -211,70 +214,137 @@ void HistoryLog::updateLogic(const string &newLine,
             }//while !foundNonSpace && charPos
         }//if newLine
     }//if showGraphics
-
-    //### Clear the changed flag from the first line ###
-    for (int i = 0; i < TelnetProtocol::WINDOW_WIDTH; i++)
-        telnetWindow->charChanged(i, 0);
 }//updateLogic
 
 void HistoryLog::show(void)
 {
-    DisplayRow *dest = NULL;//the current row to show
-    string *bufSource = NULL;//a single line from the history buffer
-    char oneChar = ' ';//the current character to show
-
     if (hidden)
     {
         hidden = false;
-
-        for (unsigned int y = 0; y < history.size(); y++)
-        {
-            dest = history.at(y);
-            bufSource = historyBuf.at(y);
-
-            for (unsigned int x = 0; x < dest->size(); x++)
-            {
-                oneChar = bufSource->at(x);
-                dest->setChar(x, oneChar, &logAttributes);
-            }//for x
-        }//for y
+        refresh();
     }//if hidden
 }//show
 
 void HistoryLog::hide(void)
 {
-    DisplayRow *oneRow = NULL;//the current history row to clear
-
     if (!hidden)
     {
         hidden = true;
 
         for (unsigned int y = 0; y < history.size(); y++)
-        {
-            oneRow = history.at(y);
-
-            for (unsigned int x = 0; x < oneRow->size(); x++)
-                oneRow->setChar(x, ' ', &logAttributes);
-        }//for y
+            writeRow(history.at(y), "");
     }//if !hidden
 }//hide
 
 void HistoryLog::clearHistory(void)
 {
-    DisplayRow *oneRow = NULL;//the current history row to clear
-    string *oneBufRow = NULL;//the current history buffer row to clear
+    displayStart = messageLog->getNumLines();
 
+    for (unsigned int y = 0; y < history.size(); y++)
+        writeRow(history.at(y), "");
+
+    oldHistoryLine.clear();
+}//clearHistory
+
+void HistoryLog::refresh(void)
+{
+    unsigned int numLines = messageLog->getNumLines();//the number of logged lines
+    unsigned int logIndex = 0;//the line from messageLog to display
+    DisplayRow *dest = NULL;//the current row to show
+
+    //### Start with the top row in its usual place ###
+    firstRow = 0;
+    positionRows();
+
+    //### Show the end of the log, with blank rows above it if it's short ###
     for (unsigned int y = 0; y < history.size(); y++)
     {
-        oneRow = history.at(y);
-        oneBufRow = historyBuf.at(y);
+        dest = history.at(y);
 
-        for (unsigned int x = 0; x < oneRow->size(); x++)
+        if (numLines + y >= displayStart + history.size())
         {
-            oneRow->setChar(x, ' ', &logAttributes);
-            oneBufRow->at(x) = ' ';
-        }//for x
+            logIndex = numLines + y - history.size();
+            writeRow(dest, messageLog->getLine(logIndex));
+        }//if numLines
+        else
+            writeRow(dest, "");
     }//for y
+}//refresh
 
-    oldHistoryLine.clear();
-}//clearHistory
+void HistoryLog::resize(QGraphicsScene *theScene)
+{
+    unsigned int logLines = NGSettings::getHistoryLines();
+    DisplayRow *oneRow = NULL;//a row being added or deleted
+    NG_TRACE_SPAN("HistoryLog::resize");
+
+    //### Only create or delete the rows that changed ###
+    while (history.size() < logLines)
+    {
+        oneRow = new DisplayRow(whiteBoard, TelnetProtocol::WINDOW_WIDTH, history.size());
+        history.push_back(oneRow);
+
+        if (addedToScene)
+            oneRow->addToScene(theScene);
+    }//while size()
+
+    while (history.size() > logLines)
+    {
+        oneRow = history.back();
+        history.pop_back();
+
+        if (addedToScene)
+            oneRow->removeFromScene(theScene);
+        delete oneRow;
+    }//while size()
+
+    //### Resize the rest in place, starting the ring buffer over ###
+    firstRow = 0;
+    for (unsigned int y = 0; y < history.size(); y++)
+        history.at(y)->updateGeometry(y);
+
+    //### Show the same lines as before, with the new tiles ###
+    if (hidden)
+    {
+        for (unsigned int y = 0; y < history.size(); y++)
+            writeRow(history.at(y), "");
+    }//if hidden
+    else
+        refresh();
+}//resize
+
+void HistoryLog::addDisplayLine(const string &newLine)
+{
+    writeRow(history.at(firstRow), newLine);
+
+    firstRow++;
+    if (firstRow >= history.size())
+        firstRow = 0;
+
+    positionRows();
+}//addDisplayLine
+
+void HistoryLog::positionRows(void)
+{
+    unsigned int ringIndex = firstRow;//the index in history of the row at y
+
+    for (unsigned int y = 0; y < history.size(); y++)
+    {
+        history.at(ringIndex)->setRow(y);
+
+        ringIndex++;
+        if (ringIndex >= history.size())
+            ringIndex = 0;
+    }//for y
+}//positionRows
+
+void HistoryLog::writeRow(DisplayRow *oneRow,
+                          const string &newLine)
+{
+    for (unsigned int x = 0; x < oneRow->size(); x++)
+    {
+        if (x < newLine.size())
+            oneRow->setChar(x, newLine.at(x), &logAttributes, NetSprite::NO_TILE);
+        else
+            oneRow->setChar(x, ' ', &logAttributes, NetSprite::NO_TILE);
+    }//for x
+}//writeRow
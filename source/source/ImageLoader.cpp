@@ -22,6 +22,7 @@ This file is part of EbonHack.
 #include <QImage>
 #include <QColor>
 #include <QPainter>
+#include <QtConcurrent/QtConcurrentRun>
 
 using namespace std;
 
@@ -29,6 +30,7 @@ ImageLoader::ImageLoader(WhiteBoard *newWhiteBoard)
 {
     whiteBoard = newWhiteBoard;
     dataLoaded = false;
+    namesOnly = false;
 }//constructor
 
 ImageLoader::~ImageLoader(void)
@@ -36,39 +38,85 @@ ImageLoader::~ImageLoader(void)
     for (unsigned int i = 0; i < imageList.size(); i++)
         delete imageList.at(i);
     imageList.clear();
+
+    for (unsigned int i = 0; i < loadedImages.size(); i++)
+        delete loadedImages.at(i);
+    loadedImages.clear();
 }//destructor
 
-bool ImageLoader::loadImages(void)
+bool ImageLoader::loadImages(bool newNamesOnly)
 {
+    ImageLoader objectLoader(whiteBoard);//loads object sprites on another thread
+    ImageLoader otherLoader(whiteBoard);//loads miscellaneous sprites on another thread
+    QFuture<bool> objectsLoaded;//true when objectLoader has succeeded
+    QFuture<bool> othersLoaded;//true when otherLoader has succeeded
     bool result = true;
 
     if (!dataLoaded)
     {
+        namesOnly = newNamesOnly;
+        objectLoader.namesOnly = namesOnly;
+        otherLoader.namesOnly = namesOnly;
+
+        //### Load object and miscellaneous sprites in the background ###
+        objectsLoaded = QtConcurrent::run(&objectLoader, &ImageLoader::loadFile, string("objects.txt"));
+        othersLoaded = QtConcurrent::run(&otherLoader, &ImageLoader::loadFile, string("other.txt"));
+
         //### Load monster sprites ###
         if (!loadFile("monsters.txt"))
             result = false;
 
-        //### Load object sprites ###
-        if (result)
-        {
-            if (!loadFile("objects.txt"))
-                result = false;
-        }//if result
+        //### Add the others in file order, so the tile indices don't change ###
+        if (!objectsLoaded.result())
+            result = false;
 
-        //### Load miscellaneous sprites ###
-        if (result)
-        {
-            if (!loadFile("other.txt"))
-                result = false;
-        }//if result
+        if (!othersLoaded.result())
+            result = false;
 
         if (result)
+        {
+            appendImages(objectLoader);
+            appendImages(otherLoader);
             dataLoaded = true;
+        }//if result
     }//if !dataLoaded
 
     return result;
 }//loadSprites
 
+void ImageLoader::appendImages(ImageLoader &other)
+{
+    map <string, unsigned int>::iterator mapIter;//points to an element in other.nameMap
+    unsigned int firstIndex = loadedImages.size();//where other's images start in our list
+
+    loadedImages.insert(loadedImages.end(), other.loadedImages.begin(), other.loadedImages.end());
+    other.loadedImages.clear();
+
+    for (mapIter = other.nameMap.begin(); mapIter != other.nameMap.end(); mapIter++)
+        nameMap.insert(pair<string, unsigned int>(mapIter->first, mapIter->second + firstIndex));
+    other.nameMap.clear();
+}//appendImages
+
+void ImageLoader::createPixmaps(void)
+{
+    QImage *oneImage = NULL;//a single loaded image
+
+    for (unsigned int i = 0; i < loadedImages.size(); i++)
+    {
+        oneImage = loadedImages.at(i);
+
+        if (oneImage == NULL)
+            imageList.push_back(NULL);
+        else
+        {
+            imageList.push_back(new QPixmap(QPixmap::fromImage(*oneImage, Qt::ColorOnly)));
+            delete oneImage;
+        }//else oneImage
+    }//for i
+
+    loadedImages.clear();
+}//createPixmaps
+
 bool ImageLoader::loadFile(const string &fileName)
 {
     ifstream infile;//the sprite file to read
@@ -153,8 +201,9 @@ bool ImageLoader::loadTile(ifstream &infile,
     unsigned int yPos = 0;//y-coordinate to draw to
     bool result = true;//false on file access error
 
-    //### Create the image ###
-    oneImage = new QImage(DEFAULT_SPRITE_SIZE, DEFAULT_SPRITE_SIZE, QImage::Format_ARGB32);
+    //### Create the image, unless a custom tileset will replace it ###
+    if (!namesOnly)
+        oneImage = new QImage(DEFAULT_SPRITE_SIZE, DEFAULT_SPRITE_SIZE, QImage::Format_ARGB32);
 
     //### Scan to the opening bracket ###
     while ((headerPos < header.size()) && (header.at(headerPos) != '('))
@@ -215,13 +264,14 @@ bool ImageLoader::loadTile(ifstream &infile,
         getline(infile, oneLine);
         if (!infile.good())
         {
-            whiteBoard->showMessage("ImageLoader::loadTile: " + QString::fromStdString(tileName)
-                                    + " error reading from file");
+            cout << "ImageLoader::loadTile: " << tileName << " error reading from file" << endl;
             result = false;
         }//if !good()
 
         //### Load a line of pixels ###
-        if (result)
+        if ((result) && (namesOnly))
+            yPos++;
+        else if (result)
         {
             if (loadGraphicsLine(oneLine, oneImage, yPos))
                 yPos++;
@@ -256,23 +306,17 @@ bool ImageLoader::loadTile(ifstream &infile,
 bool ImageLoader::storeImage(string &tileName,
                              QImage* oneImage)
 {
-    QPixmap *onePixmap = NULL;//pixmap version of oneImage
     string firstName;//the first name, if the sprite has two names
     string secondName;//the second name
     size_t nameIndex = 0;//index of a character in tileName
     bool result = true;//false if tileName was malformed
 
-    //### Move the image to a pixmap format ###
-    onePixmap = new QPixmap(QPixmap::fromImage(*oneImage, Qt::ColorOnly));
-    delete oneImage;
-    oneImage = NULL;
-
     //### Store sprites with a single name ###
     nameIndex = tileName.find(" / ");
     if (nameIndex == string::npos)
     {
-        imageList.push_back(onePixmap);
-        nameMap.insert(pair<string, unsigned int>(tileName, imageList.size() - 1));
+        loadedImages.push_back(oneImage);
+        nameMap.insert(pair<string, unsigned int>(tileName, loadedImages.size() - 1));
     }//if find()
 
     //### Store sprites with a dual name ###
@@ -302,9 +346,9 @@ bool ImageLoader::storeImage(string &tileName,
         //### Add the sprites to the list ###
         if (result)
         {
-            imageList.push_back(onePixmap);
-            nameMap.insert(pair<string, unsigned int>(firstName, imageList.size() - 1));
-            nameMap.insert(pair<string, unsigned int>(secondName, imageList.size() - 1));
+            loadedImages.push_back(oneImage);
+            nameMap.insert(pair<string, unsigned int>(firstName, loadedImages.size() - 1));
+            nameMap.insert(pair<string, unsigned int>(secondName, loadedImages.size() - 1));
         }//if result
     }//else find
 
@@ -0,0 +1,186 @@
+/*Copyright 2009-2013 David McCallum
+
+This file is part of EbonHack.
+
+    EbonHack is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    EbonHack is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with EbonHack.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LatencyForm.hpp"
+#include "LatencyHistogram.hpp"
+#include "LatencyWidget.hpp"
+#include "WhiteBoard.hpp"
+#include "MainWindow.hpp"
+#include <QFileDialog>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+
+using namespace std;
+
+LatencyForm::LatencyForm(QWidget* parent,
+                         Qt::WindowFlags flags,
+                         WhiteBoard *newWhiteBoard) : QDialog(parent, flags)
+{
+    QFont statsFont("Courier");//the stats are laid out in columns
+
+    whiteBoard = newWhiteBoard;
+
+    gui.setupUi(this);
+
+    statsFont.setStyleHint(QFont::TypeWriter);
+    gui.statsText->setFont(statsFont);
+
+    connect(gui.refreshButton, SIGNAL(clicked(bool)),
+            this, SLOT(refreshStats()));
+    connect(gui.exportButton, SIGNAL(clicked(bool)),
+            this, SLOT(exportClicked()));
+    connect(gui.closeButton, SIGNAL(clicked(bool)),
+            this, SLOT(closeClicked()));
+}//constructor
+
+LatencyForm::~LatencyForm(void)
+{
+}//destructor
+
+void LatencyForm::showStats(void)
+{
+    refreshStats();
+    show();
+}//showStats
+
+void LatencyForm::refreshStats(void)
+{
+    LatencyWidget *latencyWidget = whiteBoard->getMainWindow()->getLatencyWidget();
+    ostringstream statsText;//the text to display
+
+    writeSummary(statsText);
+
+    statsText << endl << "All commands:" << endl;
+    writeBarGraph(statsText, latencyWidget->getTotalHistogram());
+
+    gui.statsText->setPlainText(QString::fromStdString(statsText.str()));
+}//refreshStats
+
+void LatencyForm::exportClicked(void)
+{
+    LatencyWidget *latencyWidget = whiteBoard->getMainWindow()->getLatencyWidget();
+    QString fileName;//the file to export to
+    ofstream outFile;//the exported statistics
+    int numWindows = latencyWidget->getNumWindows();//number of completed windows
+
+    fileName = QFileDialog::getSaveFileName(this, "Export Latency Statistics",
+                                            "latency.txt", "Text files (*.txt)");
+
+    if (!fileName.isEmpty())
+    {
+        outFile.open(fileName.toLocal8Bit().constData());
+        if (!outFile.is_open())
+            whiteBoard->showMessage("LatencyForm::exportClicked(): couldn't open " + fileName);
+        else
+        {
+            writeSummary(outFile);
+
+            outFile << endl << "#### All commands ####" << endl;
+            latencyWidget->getTotalHistogram().writeDistribution(outFile);
+
+            for (int i = 0; i < numWindows; i++)
+            {
+                outFile << endl << "#### Window starting "
+                        << latencyWidget->getWindowStartTime(i).toString(Qt::ISODate).toStdString()
+                        << " ####" << endl;
+                latencyWidget->getWindow(i).writeDistribution(outFile);
+            }//for i
+
+            outFile << endl << "#### Current window starting "
+                    << latencyWidget->getWindowStartTime(numWindows).toString(Qt::ISODate).toStdString()
+                    << " ####" << endl;
+            latencyWidget->getCurrentWindow().writeDistribution(outFile);
+
+            outFile.close();
+        }//else is_open()
+    }//if !isEmpty()
+}//exportClicked
+
+void LatencyForm::closeClicked(void)
+{
+    hide();
+}//closeClicked
+
+void LatencyForm::writeSummary(ostream &out)
+{
+    LatencyWidget *latencyWidget = whiteBoard->getMainWindow()->getLatencyWidget();
+    int numWindows = latencyWidget->getNumWindows();//number of completed windows
+
+    out << left << setw(20) << "Window" << right
+        << setw(8) << "Count" << setw(10) << "p50 ms" << setw(10) << "p90 ms"
+        << setw(10) << "p99 ms" << setw(10) << "max ms" << endl;
+
+    for (int i = 0; i < numWindows; i++)
+        writeSummaryRow(out, latencyWidget->getWindowStartTime(i).toString("hh:mm:ss"),
+                        latencyWidget->getWindow(i));
+
+    writeSummaryRow(out, latencyWidget->getWindowStartTime(numWindows).toString("hh:mm:ss") + " (now)",
+                    latencyWidget->getCurrentWindow());
+    writeSummaryRow(out, "All", latencyWidget->getTotalHistogram());
+
+    out << endl << "Commands without a reply: " << latencyWidget->getNumUnanswered() << endl;
+}//writeSummary
+
+void LatencyForm::writeSummaryRow(ostream &out,
+                                  const QString &label,
+                                  const LatencyHistogram &histogram)
+{
+    out << left << setw(20) << label.toStdString() << right
+        << setw(8) << histogram.getCount() << fixed << setprecision(1)
+        << setw(10) << static_cast<double>(histogram.getValueAtPercentile(50)) / 1000.0
+        << setw(10) << static_cast<double>(histogram.getValueAtPercentile(90)) / 1000.0
+        << setw(10) << static_cast<double>(histogram.getValueAtPercentile(99)) / 1000.0
+        << setw(10) << static_cast<double>(histogram.getMax()) / 1000.0 << endl;
+}//writeSummaryRow
+
+void LatencyForm::writeBarGraph(ostream &out,
+                                const LatencyHistogram &histogram)
+{
+    qint64 lowValue = 0;//the bottom of the current bar's range in microseconds
+    qint64 highValue = 1000;//the top of the current bar's range in microseconds
+    quint64 barCount = 0;//number of values in the current bar
+    quint64 largestCount = 0;//number of values in the largest bar
+    int barWidth = 0;//the width of the current bar in characters
+
+    //### Find the largest bar so the others can be scaled to it ###
+    while (lowValue <= histogram.getMax())
+    {
+        barCount = histogram.getCountBetween(lowValue, highValue);
+        if (barCount > largestCount)
+            largestCount = barCount;
+
+        lowValue = highValue;
+        highValue *= 2;
+    }//while lowValue
+
+    //### Draw the bars ###
+    lowValue = 0;
+    highValue = 1000;
+    while ((largestCount > 0) && (lowValue <= histogram.getMax()))
+    {
+        barCount = histogram.getCountBetween(lowValue, highValue);
+        barWidth = static_cast<int>((barCount * MAX_BAR_WIDTH + largestCount - 1) / largestCount);
+
+        out << setw(7) << lowValue / 1000 << " - " << setw(7) << highValue / 1000 << " ms |"
+            << string(barWidth, '#') << " " << barCount << endl;
+
+        lowValue = highValue;
+        highValue *= 2;
+    }//while largestCount
+}//writeBarGraph
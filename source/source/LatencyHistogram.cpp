@@ -0,0 +1,243 @@
+/*Copyright 2009-2013 David McCallum
+
+This file is part of EbonHack.
+
+    EbonHack is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    EbonHack is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with EbonHack.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LatencyHistogram.hpp"
+#include <iomanip>
+
+using namespace std;
+
+LatencyHistogram::LatencyHistogram(void)
+{
+    int numBuckets = 32 - SUB_BUCKET_BITS;//number of powers of two above the first bucket
+
+    counts.resize((numBuckets + 1) * SUB_BUCKET_HALF, 0);
+    reset();
+}//constructor
+
+LatencyHistogram::~LatencyHistogram(void)
+{
+}//destructor
+
+void LatencyHistogram::reset(void)
+{
+    for (unsigned int i = 0; i < counts.size(); i++)
+        counts[i] = 0;
+
+    totalCount = 0;
+    minValue = 0;
+    maxValue = 0;
+    valueSum = 0;
+}//reset
+
+void LatencyHistogram::recordValue(qint64 value)
+{
+    if (value < 0)
+        value = 0;
+    else if (value > MAX_VALUE)
+        value = MAX_VALUE;
+
+    counts[getCountsIndex(value)]++;
+
+    if ((totalCount == 0) || (value < minValue))
+        minValue = value;
+    if (value > maxValue)
+        maxValue = value;
+
+    totalCount++;
+    valueSum += static_cast<double>(value);
+}//recordValue
+
+void LatencyHistogram::add(const LatencyHistogram &other)
+{
+    if (other.totalCount > 0)
+    {
+        for (unsigned int i = 0; i < counts.size(); i++)
+            counts[i] += other.counts[i];
+
+        if ((totalCount == 0) || (other.minValue < minValue))
+            minValue = other.minValue;
+        if (other.maxValue > maxValue)
+            maxValue = other.maxValue;
+
+        totalCount += other.totalCount;
+        valueSum += other.valueSum;
+    }//if totalCount
+}//add
+
+qint64 LatencyHistogram::getValueAtPercentile(double percentile) const
+{
+    quint64 targetCount = 0;//number of values at or below the result
+    quint64 runningCount = 0;//number of values in the buckets we've walked through
+    qint64 result = 0;//the value at percentile
+    bool found = false;//true once we've reached targetCount
+
+    if (percentile > 100)
+        percentile = 100;
+    else if (percentile < 0)
+        percentile = 0;
+
+    if (totalCount > 0)
+    {
+        targetCount = static_cast<quint64>((percentile / 100.0) * static_cast<double>(totalCount) + 0.5);
+        if (targetCount < 1)
+            targetCount = 1;
+
+        for (unsigned int i = 0; (i < counts.size()) && (!found); i++)
+        {
+            runningCount += counts[i];
+            if (runningCount >= targetCount)
+            {
+                result = highestValueAt(i);
+                found = true;
+            }//if runningCount
+        }//for i
+
+        //### Buckets are approximate, the extremes are exact ###
+        if (result > maxValue)
+            result = maxValue;
+        if (result < minValue)
+            result = minValue;
+    }//if totalCount
+
+    return result;
+}//getValueAtPercentile
+
+quint64 LatencyHistogram::getCountBetween(qint64 lowValue,
+                                          qint64 highValue) const
+{
+    quint64 result = 0;//number of values in the range
+    qint64 bucketValue = 0;//the smallest value in the current bucket
+
+    for (unsigned int i = 0; i < counts.size(); i++)
+    {
+        bucketValue = lowestValueAt(i);
+        if ((bucketValue >= lowValue) && (bucketValue < highValue))
+            result += counts[i];
+    }//for i
+
+    return result;
+}//getCountBetween
+
+quint64 LatencyHistogram::getCount(void) const
+{
+    return totalCount;
+}//getCount
+
+qint64 LatencyHistogram::getMin(void) const
+{
+    return minValue;
+}//getMin
+
+qint64 LatencyHistogram::getMax(void) const
+{
+    return maxValue;
+}//getMax
+
+double LatencyHistogram::getMean(void) const
+{
+    double result = 0;//the average recorded value
+
+    if (totalCount > 0)
+        result = valueSum / static_cast<double>(totalCount);
+
+    return result;
+}//getMean
+
+void LatencyHistogram::writeDistribution(ostream &out) const
+{
+    quint64 runningCount = 0;//number of values in the buckets we've written so far
+    double percentile = 0;//fraction of values at or below the current bucket
+    qint64 bucketValue = 0;//the largest value in the current bucket
+
+    out << setw(12) << "Value" << " " << setw(14) << "Percentile" << " "
+        << setw(10) << "TotalCount" << " " << setw(14) << "1/(1-Percentile)" << endl << endl;
+
+    out << fixed;
+    for (unsigned int i = 0; i < counts.size(); i++)
+    {
+        if (counts[i] > 0)
+        {
+            runningCount += counts[i];
+            percentile = static_cast<double>(runningCount) / static_cast<double>(totalCount);
+
+            bucketValue = highestValueAt(i);
+            if (bucketValue > maxValue)
+                bucketValue = maxValue;
+
+            out << setw(12) << setprecision(3) << static_cast<double>(bucketValue) / 1000.0 << " "
+                << setw(14) << setprecision(12) << percentile << " "
+                << setw(10) << runningCount << " ";
+
+            if (runningCount < totalCount)
+                out << setw(14) << setprecision(2) << 1.0 / (1.0 - percentile) << endl;
+            else
+                out << setw(14) << "inf" << endl;
+        }//if counts
+    }//for i
+
+    out << setprecision(3);
+    out << "#[Mean    = " << setw(12) << getMean() / 1000.0
+        << ", Min            = " << setw(12) << static_cast<double>(minValue) / 1000.0 << "]" << endl;
+    out << "#[Max     = " << setw(12) << static_cast<double>(maxValue) / 1000.0
+        << ", Total count    = " << setw(12) << totalCount << "]" << endl;
+    out << "#[Buckets = " << setw(12) << counts.size() / SUB_BUCKET_HALF
+        << ", SubBuckets     = " << setw(12) << SUB_BUCKET_HALF * 2 << "]" << endl;
+}//writeDistribution
+
+int LatencyHistogram::getCountsIndex(qint64 value) const
+{
+    quint64 masked = static_cast<quint64>(value) | static_cast<quint64>(SUB_BUCKET_HALF * 2 - 1);//forces at least SUB_BUCKET_BITS + 1 bits
+    int highestBit = 0;//position of the highest set bit in masked
+    int bucketIndex = 0;//the power of two value falls into
+    int subBucketIndex = 0;//the linear position within bucketIndex
+
+    while (masked > 1)
+    {
+        masked >>= 1;
+        highestBit++;
+    }//while masked
+
+    bucketIndex = highestBit - SUB_BUCKET_BITS;
+    subBucketIndex = static_cast<int>(value >> bucketIndex);
+
+    return bucketIndex * SUB_BUCKET_HALF + subBucketIndex;
+}//getCountsIndex
+
+qint64 LatencyHistogram::lowestValueAt(int index) const
+{
+    int bucketIndex = 0;//the power of two index falls into
+    int subBucketIndex = index;//the linear position within bucketIndex
+
+    if (index >= SUB_BUCKET_HALF * 2)
+    {
+        bucketIndex = index / SUB_BUCKET_HALF - 1;
+        subBucketIndex = index - bucketIndex * SUB_BUCKET_HALF;
+    }//if index
+
+    return static_cast<qint64>(subBucketIndex) << bucketIndex;
+}//lowestValueAt
+
+qint64 LatencyHistogram::highestValueAt(int index) const
+{
+    int bucketIndex = 0;//the power of two index falls into
+
+    if (index >= SUB_BUCKET_HALF * 2)
+        bucketIndex = index / SUB_BUCKET_HALF - 1;
+
+    return lowestValueAt(index) + (static_cast<qint64>(1) << bucketIndex) - 1;
+}//highestValueAt
@@ -33,6 +33,12 @@ LatencyWidget::LatencyWidget(QWidget* parent,
     waitingReply = false;
     averageLatency = 0;
     textWidth = 0;
+    windowStart = 0;
+    numUnanswered = 0;
+    lastPacketTime = -1;
+
+    latencyClock.start();
+    windowStartTime = QDateTime::currentDateTime();
 
     setText("Latency: 0 ms");
 }//constructor
@@ -117,10 +123,13 @@ void LatencyWidget::reportCommand(void)
 {
     MainWindow *mainWindow = whiteBoard->getMainWindow();
 
+    //### Tag the command so its reply can be matched to it ###
+    expireCommands();
+    outstandingCommands.push_back(latencyClock.nsecsElapsed() / 1000);
+
     if (!waitingReply)
     {
         waitingReply = true;
-        commandTime.start();
 
         if (averageLatency > LATENCY_THRESHOLD)
         {
@@ -136,6 +145,8 @@ void LatencyWidget::reportDisconnect(void)
 {
     updateTimer.stop();
     waitingReply = false;
+    outstandingCommands.clear();
+    lastPacketTime = -1;
     doUpdate();
 }//reportAllSent
 
@@ -154,19 +165,47 @@ void LatencyWidget::doUpdate(void)
 void LatencyWidget::reportReply(void)
 {
     MainWindow *mainWindow = whiteBoard->getMainWindow();
+    qint64 replyTime = latencyClock.nsecsElapsed() / 1000;//time we got the reply in microseconds
+    qint64 latency = 0;//round trip time of the newest answered command in microseconds
+    qint64 newestCommand = -1;//send time of the newest command this reply answers
 
-    if (waitingReply)
+    expireCommands();
+    rotateWindows();
+
+    //### Only a packet after a quiet spell starts a new reply, the rest of a reply
+    //answers nothing ###
+    if ((lastPacketTime < 0) || (replyTime - lastPacketTime > static_cast<qint64>(REPLY_QUIET_TIME) * 1000))
     {
-        updateTimer.stop();
+        //A reply answers every command sent before it started. Commands typed while
+        //the last reply was streaming are answered here too, not left to lag behind.
+        while (!outstandingCommands.empty())
+        {
+            newestCommand = outstandingCommands.front();
+            outstandingCommands.pop_front();
+        }//while !empty()
+    }//if lastPacketTime
+    lastPacketTime = replyTime;
+
+    //### Record the round trip time of the newest command the reply answered ###
+    if (newestCommand >= 0)
+    {
+        latency = replyTime - newestCommand;
+
+        currentWindow.recordValue(latency);
+        totalHistogram.recordValue(latency);
 
         averageLatency *= static_cast<float>(RUNNING_AVG_SIZE - 1) / static_cast<float>(RUNNING_AVG_SIZE);
-        if (commandTime.elapsed() != 0)
-            averageLatency += static_cast<float>(commandTime.elapsed()) / static_cast<float>(RUNNING_AVG_SIZE);
+        averageLatency += static_cast<float>(latency) / static_cast<float>(1000 * RUNNING_AVG_SIZE);
 
         if (averageLatency > 9999)
             averageLatency = 9999;
 
-        setText("Latency: " + QString::number(commandTime.elapsed(), 10) + " ms");
+        setText("Latency: " + QString::number(latency / 1000, 10) + " ms");
+    }//if newestCommand
+
+    if (waitingReply)
+    {
+        updateTimer.stop();
         waitingReply = false;
         //mainWindow->alertTilesFinished();
         update();
@@ -174,3 +213,77 @@ void LatencyWidget::reportReply(void)
         mainWindow->restoreCursor();
     }//if waitingReply
 }//reportReply
+
+void LatencyWidget::expireCommands(void)
+{
+    qint64 currentTime = latencyClock.nsecsElapsed() / 1000;//the current time in microseconds
+    qint64 timeout = static_cast<qint64>(REPLY_TIMEOUT) * 1000;//REPLY_TIMEOUT in microseconds
+
+    while ((!outstandingCommands.empty())
+           && (currentTime - outstandingCommands.front() > timeout))
+    {
+        outstandingCommands.pop_front();
+        numUnanswered++;
+    }//while !empty()
+}//expireCommands
+
+void LatencyWidget::rotateWindows(void)
+{
+    qint64 currentTime = latencyClock.elapsed();//the current time in milliseconds
+
+    if (currentTime - windowStart >= WINDOW_LENGTH)
+    {
+        if (currentWindow.getCount() > 0)
+        {
+            windows.push_back(currentWindow);
+            windowStartTimes.push_back(windowStartTime);
+            if (static_cast<int>(windows.size()) > MAX_WINDOWS)
+            {
+                windows.pop_front();
+                windowStartTimes.pop_front();
+            }//if size()
+        }//if getCount()
+
+        currentWindow.reset();
+        windowStart = currentTime;
+        windowStartTime = QDateTime::currentDateTime();
+    }//if currentTime
+}//rotateWindows
+
+int LatencyWidget::getNumWindows(void)
+{
+    rotateWindows();
+    return static_cast<int>(windows.size());
+}//getNumWindows
+
+const LatencyHistogram& LatencyWidget::getWindow(int index)
+{
+    return windows.at(index);
+}//getWindow
+
+QDateTime LatencyWidget::getWindowStartTime(int index)
+{
+    QDateTime result = windowStartTime;//when the window started
+
+    if (index < static_cast<int>(windowStartTimes.size()))
+        result = windowStartTimes.at(index);
+
+    return result;
+}//getWindowStartTime
+
+const LatencyHistogram& LatencyWidget::getCurrentWindow(void)
+{
+    rotateWindows();
+    return currentWindow;
+}//getCurrentWindow
+
+const LatencyHistogram& LatencyWidget::getTotalHistogram(void)
+{
+    return totalHistogram;
+}//getTotalHistogram
+
+quint64 LatencyWidget::getNumUnanswered(void)
+{
+    expireCommands();
+    return numUnanswered;
+}//getNumUnanswered
@@ -27,6 +27,8 @@ This file is part of EbonHack.
 #include <QUrl>
 #include <QDir>
 #include <QApplication>
+#include <QScreen>
+#include <QPainter>
 #include "WhiteBoard.hpp"
 #include "NGSettings.hpp"
 #include "NethackFX.hpp"
@@ -38,10 +40,20 @@ This file is part of EbonHack.
 #include "MessageForm.hpp"
 #include "NetCursor.hpp"
 #include "HistoryLog.hpp"
+#include "MessageLog.hpp"
 #include "TipForm.hpp"
 #include <farmdockwidget.h>
 #include "LatencyWidget.hpp"
+#include "LatencyForm.hpp"
+#include "NotificationForm.hpp"
+#include "TimelineForm.hpp"
 #include "GraphicsSettings.hpp"
+#include "NGTrace.hpp"
+#include "FrameRenderer.hpp"
+#include <QFileDialog>
+#include <QInputDialog>
+#include <fstream>
+#include <sstream>
 
 using namespace std;
 
@@ -62,11 +74,17 @@ MainWindow::MainWindow(QWidget* parent,
     tipForm = new TipForm(this, NULL);
     netCursor = new NetCursor(NULL, whiteBoard);
     latencyWidget = new LatencyWidget(this, NULL, whiteBoard);
+    latencyForm = new LatencyForm(this, NULL, whiteBoard);
+    notificationForm = new NotificationForm(this, NULL, whiteBoard);
+    timelineForm = new TimelineForm(this, NULL, whiteBoard);
     graphicsSettings = new GraphicsSettings(this, NULL, whiteBoard);
+    frameRenderer = NULL;
     farmingWidget = new FarmDockWidget(this);
     farmingWidget->initialize(whiteBoard);
 
     isConnected = false;
+    frameInterval = 1000 / DEFAULT_REFRESH_RATE;
+    partialUpdates = true;
 
     //### Configure GUI ###
     gui.setupUi(this);
@@ -115,6 +133,18 @@ MainWindow::~MainWindow()
     delete zoomForm;
     zoomForm = NULL;
 
+    delete latencyForm;
+    latencyForm = NULL;
+
+    delete notificationForm;
+    notificationForm = NULL;
+
+    delete timelineForm;
+    timelineForm = NULL;
+
+    delete frameRenderer;
+    frameRenderer = NULL;
+
     //deleted automatically
     netCursor = NULL;
     latencyWidget = NULL;
@@ -123,56 +153,26 @@ MainWindow::~MainWindow()
 
 bool MainWindow::start(void)
 {
-    NethackFX *netFX = whiteBoard->getNetFX();
     TelnetProtocol *telnetPro = whiteBoard->getTelnetPro();
-    string tileset = ConfigWriter::loadString("game_config.txt", "Tileset");
     double zoomAmount = 0;//Amount to scale the graphics view
-    unsigned int spriteWidth = 0;//the dimensions of each sprite in pixels
-    unsigned int spriteHeight = 0;
-    int startingWidth = 0;//initial dimensions of the main window
-    int startingHeight = 0;
-    bool useTileset = ConfigWriter::loadBool("game_config.txt", "Use Tileset");
     bool result = true;//false on errors
 
-    //### Set the zoom value ###
+    //### Get the zoom value ###
     zoomAmount = static_cast<double>(zoomForm->getZoomAmount()) / static_cast<double>(100);
-    gui.graphicsView->resetMatrix();
-    gui.graphicsView->scale(zoomAmount, zoomAmount);
 
     //### Initialize the telnet protocol and display handlers ###
+    //The tiles load in the background, NethackFX swaps them in when they're ready
     if (telnetPro->initialize(netCursor))
+    {
         configureScene();
+        setZoom(zoomAmount);
+    }//if initialize()
     else
         result = false;
 
-    //### Load a custom tileset ###
-    if (result)
-    {
-        if (useTileset)
-            netFX->loadCustomTiles(QString::fromStdString(tileset));
-    }//if result
-
     //### Resize the window ###
     if (result)
-    {
-        spriteWidth = NGSettings::getSpriteWidth();
-        spriteHeight = NGSettings::getSpriteHeight();
-
-        startingWidth = spriteWidth * TelnetProtocol::WINDOW_WIDTH;
-        startingWidth = static_cast<int>(startingWidth * zoomAmount);
-        startingWidth += BORDER_WIDTH;
-        // startingWidth += farmingWidget->width();
-
-
-        startingHeight = spriteHeight * (TelnetProtocol::WINDOW_HEIGHT + NGSettings::getHistoryLines());
-        startingHeight = static_cast<int>(startingHeight * zoomAmount);
-        startingHeight += BORDER_HEIGHT;
-        startingHeight += latencyWidget->height();
-
-        startingHeight += farmingWidget->height();
-
-        resize(startingWidth, startingHeight);
-    }//if result
+        fitWindow();
 
     //### Start the logic timer ###
     if (result)
@@ -199,9 +199,12 @@ bool MainWindow::start(void)
         if (!latencyWidget->initialize())
             result = false;
     }//if result
-    //### Display the window ###
+    //### Display the window, and watch for the first frame ###
     if (result)
+    {
+        gui.graphicsView->viewport()->installEventFilter(this);
         show();
+    }//if result
 
     return result;
 
@@ -210,14 +213,38 @@ bool MainWindow::start(void)
      */
 }//start
 
+void MainWindow::fitWindow(void)
+{
+    double zoomAmount = 0;//Amount the graphics view is scaled
+    unsigned int spriteWidth = NGSettings::getSpriteWidth();//the dimensions of each sprite in pixels
+    unsigned int spriteHeight = NGSettings::getSpriteHeight();
+    int startingWidth = 0;//window dimensions
+    int startingHeight = 0;
+
+    zoomAmount = static_cast<double>(zoomForm->getZoomAmount()) / static_cast<double>(100);
+
+    startingWidth = spriteWidth * TelnetProtocol::WINDOW_WIDTH;
+    startingWidth = static_cast<int>(startingWidth * zoomAmount);
+    startingWidth += BORDER_WIDTH;
+    // startingWidth += farmingWidget->width();
+
+
+    startingHeight = spriteHeight * (TelnetProtocol::WINDOW_HEIGHT + NGSettings::getHistoryLines());
+    startingHeight = static_cast<int>(startingHeight * zoomAmount);
+    startingHeight += BORDER_HEIGHT;
+    startingHeight += latencyWidget->height();
+
+    startingHeight += farmingWidget->height();
+
+    resize(startingWidth, startingHeight);
+}//fitWindow
+
 void MainWindow::configureScene(void)
 {
-    #ifdef NG_OPEN_GL
-        QGLWidget* openGLWidget = NULL;//renders the scene with OpenGL
-    #endif
     TelnetProtocol *telnetPro = whiteBoard->getTelnetPro();
     TelnetWindow *telnetWindow = telnetPro->getTelnetWindow();
     NethackFX *netFX = whiteBoard->getNetFX();
+    QScreen *theScreen = QGuiApplication::primaryScreen();//the display we're shown on
     bool haveOpenGL = false;//true if OpenGL is available
 
     //### Enable OpenGL ###
@@ -226,27 +253,22 @@ void MainWindow::configureScene(void)
             haveOpenGL = true;
 
         graphicsSettings->setOpenGL(haveOpenGL);
-
-        if (graphicsSettings->openGLEnabled())
-        {
-            openGLWidget = new QGLWidget();
-
-            if (openGLWidget->isValid())
-                gui.graphicsView->setViewport(openGLWidget);
-            else
-            {
-                whiteBoard->showMessage("Couldn't create QGLWidget, using software rendering.");
-
-                delete openGLWidget;
-                openGLWidget = NULL;
-            }//else isValid()
-        }//if useOpenGL()
     #else
         graphicsSettings->setOpenGL(false);
     #endif
 
-    //### Set update mode ###
-    gui.graphicsView->setViewportUpdateMode(QGraphicsView::FullViewportUpdate);
+    applyViewport();
+
+    //### Paint changes ourselves, at most once per display refresh ###
+    if ((theScreen != NULL) && (theScreen->refreshRate() >= 1))
+        frameInterval = static_cast<int>(1000 / theScreen->refreshRate());
+
+    gui.graphicsView->setViewportUpdateMode(QGraphicsView::NoViewportUpdate);
+    frameTimer.setSingleShot(true);
+    connect(&frameTimer, SIGNAL(timeout()),
+            this, SLOT(paintFrame()));
+    connect(&theScene, SIGNAL(changed(const QList<QRectF> &)),
+            this, SLOT(sceneChanged(const QList<QRectF> &)));
 
     setSceneSize();
 
@@ -262,14 +284,60 @@ void MainWindow::configureScene(void)
     gui.graphicsView->setFocusPolicy(Qt::NoFocus);
     gui.graphicsView->installEventFilter(this);
 
+    //### Draw the telnet window on a worker thread ###
+    if (ConfigWriter::loadBool("game_config.txt", "Threaded Rendering"))
+    {
+        frameRenderer = new FrameRenderer(whiteBoard);
+        frameRenderer->setZValue(1);
+        theScene.addItem(frameRenderer);
+        telnetWindow->setOffscreen(true);
+    }//if Threaded Rendering
+
     //### Display the scene ###
     NGSettings::setSpriteSize(ImageLoader::DEFAULT_SPRITE_SIZE, ImageLoader::DEFAULT_SPRITE_SIZE);
-    telnetWindow->resetWindow(&theScene);
+    telnetWindow->setGraphicsScene(&theScene);
+    telnetWindow->updateGeometry();
     netFX->setGraphicsScene(&theScene);
     gui.graphicsView->setScene(&theScene);
     gui.graphicsView->show();
 }//configureScene
 
+void MainWindow::applyViewport(void)
+{
+    #ifdef NG_OPEN_GL
+        QGLWidget* openGLWidget = NULL;//renders the scene with OpenGL
+        bool usingOpenGL = (qobject_cast<QGLWidget*>(gui.graphicsView->viewport()) != NULL);
+
+        //### Only replace the viewport if the mode changed ###
+        if (graphicsSettings->openGLEnabled() != usingOpenGL)
+        {
+            if (graphicsSettings->openGLEnabled())
+            {
+                openGLWidget = new QGLWidget();
+
+                if (openGLWidget->isValid())
+                    gui.graphicsView->setViewport(openGLWidget);
+                else
+                {
+                    whiteBoard->showMessage("Couldn't create QGLWidget, using software rendering.");
+
+                    delete openGLWidget;
+                    openGLWidget = NULL;
+                }//else isValid()
+            }//if openGLEnabled()
+            else
+                gui.graphicsView->setViewport(new QWidget());
+        }//if openGLEnabled()
+
+        //### OpenGL doesn't keep its back buffer, so it repaints everything ###
+        partialUpdates = (qobject_cast<QGLWidget*>(gui.graphicsView->viewport()) == NULL);
+    #endif
+
+    //### Paint the whole new viewport ###
+    pendingDamage = QRegion();
+    gui.graphicsView->viewport()->update();
+}//applyViewport
+
 void MainWindow::setSceneSize(void)
 {
     QRectF sceneSize;//the dimensions of the scene in pixels
@@ -301,6 +369,36 @@ void MainWindow::alertTilesFinished(void)
     emit tilesFinished();
 }
 
+void MainWindow::setZoom(double newZoom)
+{
+    NethackFX *netFX = whiteBoard->getNetFX();
+
+    gui.graphicsView->resetMatrix();
+    gui.graphicsView->scale(newZoom, newZoom);
+    netFX->setZoom(newZoom);
+
+    if (frameRenderer != NULL)
+        frameRenderer->reset(newZoom);
+}//setZoom
+
+double MainWindow::getZoom(void)
+{
+    return static_cast<double>(zoomForm->getZoomAmount()) / static_cast<double>(100);
+}//getZoom
+
+void MainWindow::renderScene(QImage &theImage)
+{
+    QPainter painter;//draws the scene into theImage
+
+    if (frameRenderer != NULL)
+        frameRenderer->waitForFrames();
+
+    theImage.fill(Qt::black);
+    painter.begin(&theImage);
+    theScene.render(&painter, QRectF(0, 0, theImage.width(), theImage.height()), theScene.sceneRect());
+    painter.end();
+}//renderScene
+
 void MainWindow::resetGraphics(void)
 {
     TelnetProtocol *telnetPro = whiteBoard->getTelnetPro();
@@ -311,11 +409,15 @@ void MainWindow::resetGraphics(void)
     gameSettings->reloadHistoryLines();
 
     gameSettings->updateFontFromConfig();
-    telnetWindow->resetWindow(&theScene);
-    netFX->resetHistoryLog(&theScene);
+    netFX->resetTileCache();
+    telnetWindow->updateGeometry();
+    netFX->resizeHistoryLog();
 
     setSceneSize();
 
+    if (frameRenderer != NULL)
+        frameRenderer->reset(getZoom());
+
     netFX->setUserFX(!graphicsEnabled);
     netFX->setUserFX(graphicsEnabled);
 }//resetGraphics
@@ -350,16 +452,49 @@ void MainWindow::blinkCursor(void)
         netCursor->show();
 }//blinkCursor
 
+void MainWindow::sceneChanged(const QList<QRectF> &region)
+{
+    QWidget *viewport = gui.graphicsView->viewport();//the widget the scene is painted on
+    int frameDelay = 0;//milliseconds until the next frame is due
+
+    //### Convert the changes to viewport coordinates, rounding outwards for zoom ###
+    for (int i = 0; i < region.size(); i++)
+    {
+        if (partialUpdates)
+            pendingDamage += gui.graphicsView->mapFromScene(region.at(i)).boundingRect().adjusted(-1, -1, 1, 1);
+        else
+            pendingDamage = viewport->rect();
+    }//for i
+
+    //### Schedule a frame, unless one is already waiting ###
+    if ((!pendingDamage.isEmpty()) && (!frameTimer.isActive()))
+    {
+        if (frameClock.isValid())
+            frameDelay = frameInterval - static_cast<int>(frameClock.elapsed());
+        if (frameDelay < 0)
+            frameDelay = 0;
+
+        frameTimer.start(frameDelay);
+    }//if !isEmpty() && !isActive()
+}//sceneChanged
+
+void MainWindow::paintFrame(void)
+{
+    NG_TRACE_SPAN("MainWindow::paintFrame");
+
+    gui.graphicsView->viewport()->update(pendingDamage);
+    pendingDamage = QRegion();
+    frameClock.start();
+}//paintFrame
+
 void MainWindow::menuCommand(const QString &param)
 {
     TelnetProtocol *telnetPro = whiteBoard->getTelnetPro();
-    string keystrokes = param.toStdString();
 
     //### Send buffered arrows before the new command ###
     arrowHandler->sendCommand(Qt::Key_unknown);
 
-    for (unsigned int i = 0; i < keystrokes.size(); i++)
-        telnetPro->sendKeystroke(keystrokes.at(i));
+    telnetPro->sendBytes(param.toLatin1());
 }//menuCommand
 
 void MainWindow::keyReleaseEvent(QKeyEvent *keyEvent)
@@ -374,7 +509,7 @@ void MainWindow::keyReleaseEvent(QKeyEvent *keyEvent)
 
 void MainWindow::keyPressEvent(QKeyEvent *keyEvent)
 {
-    string keyText;//unicode text from the keypress
+    QByteArray keyText;//text from the keypress
     QFlags <Qt::KeyboardModifier> modifiers(keyEvent->modifiers());//status of ALT, CTRL and SHIFT keys
     TelnetProtocol *telnetPro = whiteBoard->getTelnetPro();
     bool handledEvent = false;//true if we used this keyEvent, otherwise pass it along
@@ -386,11 +521,10 @@ void MainWindow::keyPressEvent(QKeyEvent *keyEvent)
     //### Send ASCII commands ###
     if (!handledEvent)
     {
-        keyText = keyEvent->text().toStdString();
+        keyText = keyEvent->text().toLatin1();
         if (keyText.size() > 0)
         {
-            for (unsigned int i = 0; i < keyText.size(); i++)
-                telnetPro->sendKeystroke(keyText.at(i));
+            telnetPro->sendBytes(keyText);
             handledEvent = true;
         }//if size()
     }//if !handledEvent
@@ -411,7 +545,15 @@ bool MainWindow::eventFilter(QObject *obj,
     QKeyEvent *keyEvent = NULL;//event data, if this is a keystroke event
     bool result = false;//return true to consume the keystroke
 
-    if (event->type() == QEvent::KeyPress)
+    //### Report how long it took to show something ###
+    if ((event->type() == QEvent::Paint) && (obj == gui.graphicsView->viewport()))
+    {
+        cout << "First frame after " << whiteBoard->getUptime() << " ms" << endl;
+        obj->removeEventFilter(this);
+        result = QObject::eventFilter(obj, event);
+    }//if type() && obj
+
+    else if (event->type() == QEvent::KeyPress)
     {
          keyEvent = dynamic_cast<QKeyEvent*>(event);
          this->keyPressEvent(keyEvent);
@@ -445,6 +587,22 @@ void MainWindow::closeEvent(QCloseEvent *event)
     event->accept();
 }//close
 
+bool MainWindow::event(QEvent *event)
+{
+    bool result = false;//true if the event was recognized
+
+    //### UpdateRequest paints every dirty widget and flushes it to the screen ###
+    if (event->type() == QEvent::UpdateRequest)
+    {
+        NG_TRACE_SPAN("MainWindow::repaint");
+        result = QMainWindow::event(event);
+    }//if type()
+    else
+        result = QMainWindow::event(event);
+
+    return result;
+}//event
+
 void MainWindow::dumpScreen(void)
 {
     TelnetProtocol *telnetPro = whiteBoard->getTelnetPro();
@@ -480,8 +638,7 @@ void MainWindow::zoomFormNewValue(void)
     double newZoom = 1;//the zoom amount to apply
 
     newZoom = static_cast<double>(zoomForm->getZoomAmount()) / static_cast<double>(100);
-    gui.graphicsView->resetMatrix();
-    gui.graphicsView->scale(newZoom, newZoom);
+    setZoom(newZoom);
 
     ConfigWriter::writeInt("game_config.txt", "Zoom Factor", zoomForm->getZoomAmount());
     zoomForm->hide();
@@ -494,6 +651,14 @@ void MainWindow::toggleGraphics(bool enableGraphics)
     netFX->setUserFX(enableGraphics);
 }//toggleGraphics
 
+void MainWindow::toggleAutoMap(bool enableAutoMap)
+{
+    NethackFX *netFX = whiteBoard->getNetFX();
+
+    netFX->setAutoMap(enableAutoMap);
+    ConfigWriter::writeBool("game_config.txt", "Auto Map", enableAutoMap);
+}//toggleAutoMap
+
 void MainWindow::setGraphicsMode(bool newValue)
 {
     gui.actionGraphics_Enabled->setChecked(newValue);
@@ -523,6 +688,91 @@ void MainWindow::showGraphicsSettings(void)
     graphicsSettings->show();
 }//showGraphicsSettings
 
+void MainWindow::showLatencyStats(void)
+{
+    latencyForm->showStats();
+}//showLatencyStats
+
+void MainWindow::showNotifications(void)
+{
+    notificationForm->showLog();
+}//showNotifications
+
+void MainWindow::showTimeline(void)
+{
+    timelineForm->showTimeline();
+}//showTimeline
+
+void MainWindow::exportHistory(void)
+{
+    MessageLog *messageLog = whiteBoard->getNetFX()->getMessageLog();
+    QString fileName;//the file to export to
+    ofstream outFile;//the exported history
+
+    fileName = QFileDialog::getSaveFileName(this, "Export Message History",
+                                            "history.txt", "Text files (*.txt)");
+
+    if (!fileName.isEmpty())
+    {
+        outFile.open(fileName.toLocal8Bit().constData());
+        if (!outFile.is_open())
+            whiteBoard->showMessage("MainWindow::exportHistory(): couldn't open " + fileName);
+        else
+        {
+            messageLog->exportLines(outFile, 0, messageLog->getNumLines());
+            outFile.close();
+        }//else is_open()
+    }//if !isEmpty()
+}//exportHistory
+
+void MainWindow::searchHistory(void)
+{
+    MessageLog *messageLog = whiteBoard->getNetFX()->getMessageLog();
+    QString findText;//the text to search for
+    vector <unsigned int> results;//the matching line numbers
+    ostringstream resultText;//the matching lines to show the user
+    bool gotText = false;//true if the user entered some text
+    unsigned int firstResult = 0;//the first result to show
+
+    findText = QInputDialog::getText(this, "Search Message History", "Find:",
+                                     QLineEdit::Normal, QString(), &gotText);
+
+    if ((gotText) && (!findText.isEmpty()))
+    {
+        messageLog->search(findText.toStdString(), 0, messageLog->getNumLines(), results);
+
+        //### Show the most recent matches ###
+        resultText << results.size() << " matching lines";
+        if (results.size() > MAX_SEARCH_RESULTS)
+        {
+            resultText << ", showing the last " << MAX_SEARCH_RESULTS;
+            firstResult = results.size() - MAX_SEARCH_RESULTS;
+        }//if size()
+        resultText << endl;
+
+        for (unsigned int i = firstResult; i < results.size(); i++)
+            resultText << results.at(i) + 1 << ": " << messageLog->getLine(results.at(i)) << endl;
+
+        whiteBoard->showMessage(QString::fromStdString(resultText.str()));
+    }//if gotText && !isEmpty()
+}//searchHistory
+
+void MainWindow::saveTrace(void)
+{
+    #ifdef NG_TRACE
+        QString fileName;//the file to save the trace to
+
+        fileName = QFileDialog::getSaveFileName(this, "Save Pipeline Trace",
+                                                NGTrace::DEFAULT_FILE, "Chrome trace (*.json)");
+
+        if (!fileName.isEmpty())
+        {
+            if (!NGTrace::dumpChromeTrace(fileName.toLocal8Bit().constData()))
+                whiteBoard->showMessage("MainWindow::saveTrace(): couldn't write " + fileName);
+        }//if !isEmpty()
+    #endif
+}//saveTrace
+
 void MainWindow::quitClicked(void)
 {
     whiteBoard->getQTApp()->closeAllWindows();
@@ -539,6 +789,24 @@ void MainWindow::addMenuBindings(void)
             this, SLOT(toggleGraphics(bool)));
     connect(gui.actionGraphics_Settings, SIGNAL(triggered(bool)),
             this, SLOT(showGraphicsSettings()));
+    gui.actionAuto_Map->setChecked(ConfigWriter::loadBool("game_config.txt", "Auto Map"));
+    connect(gui.actionAuto_Map, SIGNAL(toggled(bool)),
+            this, SLOT(toggleAutoMap(bool)));
+    connect(gui.actionExport_History, SIGNAL(triggered(bool)),
+            this, SLOT(exportHistory()));
+    connect(gui.actionSearch_History, SIGNAL(triggered(bool)),
+            this, SLOT(searchHistory()));
+    connect(gui.actionLatency_Statistics, SIGNAL(triggered(bool)),
+            this, SLOT(showLatencyStats()));
+    connect(gui.actionNotifications, SIGNAL(triggered(bool)),
+            this, SLOT(showNotifications()));
+    connect(gui.actionScreen_Timeline, SIGNAL(triggered(bool)),
+            this, SLOT(showTimeline()));
+    #ifdef NG_TRACE
+        gui.actionSave_Trace->setVisible(true);
+        connect(gui.actionSave_Trace, SIGNAL(triggered(bool)),
+                this, SLOT(saveTrace()));
+    #endif
     connect(gui.actionTip_of_the_Day, SIGNAL(triggered(bool)),
             this, SLOT(showTipOfTheDay()));
     connect(gui.actionZoom, SIGNAL(triggered(bool)),
@@ -671,6 +939,16 @@ GraphicsSettings* MainWindow::getGraphicsSettings(void)
     return graphicsSettings;
 }//getGraphicsSettings
 
+FrameRenderer* MainWindow::getFrameRenderer(void)
+{
+    return frameRenderer;
+}//getFrameRenderer
+
+QGraphicsScene* MainWindow::getScene(void)
+{
+    return &theScene;
+}//getScene
+
 string MainWindow::getCTRL(char letter)
 {
     uint8_t intVal = static_cast<uint8_t>(letter);
@@ -0,0 +1,121 @@
+/*Copyright 2009-2013 David McCallum
+
+This file is part of EbonHack.
+
+    EbonHack is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    EbonHack is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with EbonHack.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "MessageLog.hpp"
+#include "NGTrace.hpp"
+
+using namespace std;
+
+MessageLog::MessageLog(void)
+{
+}//constructor
+
+MessageLog::~MessageLog(void)
+{
+}//destructor
+
+void MessageLog::append(const string &line)
+{
+    QByteArray newLine;//line without trailing spaces
+    QHash <QByteArray, quint32>::const_iterator lineIter;//the existing copy of newLine
+    quint32 lineID = 0;//the index of newLine in uniqueLines
+    int lineLength = line.size();//the length of line without trailing spaces
+
+    while ((lineLength > 0) && (line.at(lineLength - 1) == ' '))
+        lineLength--;
+
+    newLine = QByteArray(line.data(), lineLength);
+
+    //### Only store each distinct line once ###
+    lineIter = lineIDs.constFind(newLine);
+    if (lineIter != lineIDs.constEnd())
+        lineID = lineIter.value();
+    else
+    {
+        lineID = uniqueLines.size();
+        uniqueLines.append(newLine);
+        lineIDs.insert(newLine, lineID);
+    }//else lineIter
+
+    lines.push_back(lineID);
+}//append
+
+unsigned int MessageLog::getNumLines(void) const
+{
+    return lines.size();
+}//getNumLines
+
+unsigned int MessageLog::getNumUniqueLines(void) const
+{
+    return uniqueLines.size();
+}//getNumUniqueLines
+
+string MessageLog::getLine(unsigned int index) const
+{
+    string result;//the line at index
+
+    if (index < lines.size())
+    {
+        const QByteArray &oneLine = uniqueLines.at(lines.at(index));
+        result.assign(oneLine.constData(), oneLine.size());
+    }//if index
+
+    return result;
+}//getLine
+
+void MessageLog::search(const string &text,
+                        unsigned int firstLine,
+                        unsigned int lastLine,
+                        vector <unsigned int> &results) const
+{
+    QByteArray findText(text.data(), text.size());//the text to look for
+    vector <bool> uniqueMatches;//true if the line in uniqueLines contains text
+    NG_TRACE_SPAN("MessageLog::search");
+
+    if (lastLine > lines.size())
+        lastLine = lines.size();
+
+    //### Check each distinct line once ###
+    uniqueMatches.resize(uniqueLines.size(), false);
+    for (int i = 0; i < uniqueLines.size(); i++)
+        uniqueMatches.at(i) = uniqueLines.at(i).contains(findText);
+
+    //### Then find where they were logged ###
+    for (unsigned int i = firstLine; i < lastLine; i++)
+    {
+        if (uniqueMatches.at(lines.at(i)))
+            results.push_back(i);
+    }//for i
+}//search
+
+void MessageLog::exportLines(ostream &out,
+                             unsigned int firstLine,
+                             unsigned int lastLine) const
+{
+    NG_TRACE_SPAN("MessageLog::exportLines");
+
+    if (lastLine > lines.size())
+        lastLine = lines.size();
+
+    for (unsigned int i = firstLine; i < lastLine; i++)
+    {
+        const QByteArray &oneLine = uniqueLines.at(lines.at(i));
+        out.write(oneLine.constData(), oneLine.size());
+        out << '\n';
+    }//for i
+}//exportLines
@@ -0,0 +1,150 @@
+/*Copyright 2009-2013 David McCallum
+
+This file is part of EbonHack.
+
+    EbonHack is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    EbonHack is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with EbonHack.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "NGTrace.hpp"
+
+#ifdef NG_TRACE
+
+#include <iostream>
+#include <fstream>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QThread>
+
+using namespace std;
+
+const char *NGTrace::DEFAULT_FILE = "trace.json";
+
+//The ring buffer of completed spans, nextEvent is the slot the next span is written to
+static NGTraceEvent traceRing[NGTrace::RING_SIZE];
+static int nextEvent = 0;
+
+//True once the ring buffer has been filled and we've started overwriting old spans
+static bool ringWrapped = false;
+
+//Guards the ring buffer, spans may be recorded from worker threads
+static QMutex ringLock;
+
+//Every span is timed relative to this clock
+static QElapsedTimer traceClock;
+
+//Starts traceClock during static initialization, before any thread can record a span
+class NGTraceClockStarter
+{
+    public:
+        NGTraceClockStarter(void)
+        {
+            traceClock.start();
+        }//constructor
+};//NGTraceClockStarter
+
+static NGTraceClockStarter clockStarter;
+
+qint64 NGTrace::getTime(void)
+{
+    return traceClock.nsecsElapsed() / 1000;
+}//getTime
+
+void NGTrace::recordSpan(const char *name,
+                         qint64 startTime,
+                         qint64 duration)
+{
+    NGTraceEvent *oneEvent = NULL;//the slot to write the span to
+
+    ringLock.lock();
+
+    oneEvent = &traceRing[nextEvent];
+    oneEvent->name = name;
+    oneEvent->startTime = startTime;
+    oneEvent->duration = duration;
+    oneEvent->threadID = reinterpret_cast<quintptr>(QThread::currentThreadId());
+
+    nextEvent++;
+    if (nextEvent >= RING_SIZE)
+    {
+        nextEvent = 0;
+        ringWrapped = true;
+    }//if nextEvent
+
+    ringLock.unlock();
+}//recordSpan
+
+bool NGTrace::dumpChromeTrace(const string &fileName)
+{
+    ofstream outFile;//the trace file
+    int firstEvent = 0;//index of the oldest span in the ring
+    int numEvents = 0;//number of spans in the ring
+    int index = 0;//index of the span to write
+    bool result = true;//false if we couldn't write the file
+
+    outFile.open(fileName.c_str());
+    if (!outFile.is_open())
+    {
+        cout << "NGTrace::dumpChromeTrace(): couldn't open " << fileName << endl;
+        result = false;
+    }//if !is_open()
+
+    if (result)
+    {
+        ringLock.lock();
+
+        //Read nextEvent under the lock, spans may be recorded while we write
+        numEvents = nextEvent;
+        if (ringWrapped)
+        {
+            firstEvent = nextEvent;
+            numEvents = RING_SIZE;
+        }//if ringWrapped
+
+        outFile << "{\"traceEvents\":[" << endl;
+        for (int i = 0; i < numEvents; i++)
+        {
+            index = (firstEvent + i) % RING_SIZE;
+
+            outFile << "{\"name\":\"" << traceRing[index].name
+                    << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << traceRing[index].threadID
+                    << ",\"ts\":" << traceRing[index].startTime
+                    << ",\"dur\":" << traceRing[index].duration << "}";
+
+            if (i + 1 < numEvents)
+                outFile << ",";
+            outFile << endl;
+        }//for i
+        outFile << "],\"displayTimeUnit\":\"ms\"}" << endl;
+
+        ringLock.unlock();
+        outFile.close();
+
+        cout << "NGTrace::dumpChromeTrace(): wrote " << numEvents << " spans to " << fileName << endl;
+    }//if result
+
+    return result;
+}//dumpChromeTrace
+
+NGTraceSpan::NGTraceSpan(const char *newName)
+{
+    name = newName;
+    startTime = NGTrace::getTime();
+}//constructor
+
+NGTraceSpan::~NGTraceSpan(void)
+{
+    NGTrace::recordSpan(name, startTime, NGTrace::getTime() - startTime);
+}//destructor
+
+#endif
@@ -20,12 +20,16 @@ This file is part of EbonHack.
 #include <QPainter>
 #include <QGraphicsScene>
 #include <QGraphicsSceneMouseEvent>
+#include <QTransform>
 #include "SGRAttribute.hpp"
 #include "WhiteBoard.hpp"
 #include "NethackFX.hpp"
 #include "TelnetWindow.hpp"
 #include "TelnetProtocol.hpp"
-#include "XtermEscape.hpp"
+#include "NGTrace.hpp"
+#include "TileCache.hpp"
+#include "MainWindow.hpp"
+#include "FrameRenderer.hpp"
 
 using namespace std;
 
@@ -44,10 +48,11 @@ NetSprite::NetSprite(QGraphicsItem* parent,
 
     theAttributes = new SGRAttribute;
     telnetChar = ' ';
-    isChanged = true;
+    serverTile = NO_TILE;
     thePixmap = NULL;
     haveGraphic = false;
     useGraphic = false;
+    offscreen = false;
     telnetWindow = telnetPro->getTelnetWindow();
 
     spriteWidth = NGSettings::getSpriteWidth();
@@ -69,6 +74,11 @@ void NetSprite::paint(QPainter *painter,
                       const QStyleOptionGraphicsItem *option,
                       QWidget *widget)
 {
+    NG_TRACE_SPAN("NetSprite::paint");
+    TileCache *tileCache = whiteBoard->getNetFX()->getTileCache();
+    QPixmap *displayPixmap = NULL;//the tile or character to draw
+    QTransform deviceTransform;//maps the sprite to viewport pixels
+
     //### Get rid of compiler warnings about unused parameters ###
     if (option)
     {
@@ -77,11 +87,28 @@ void NetSprite::paint(QPainter *painter,
     {
     }
 
-    //### Draw the sprite ###
+    //### The FrameRenderer draws offscreen sprites ###
+    if (offscreen)
+        return;
+
+    //### Find the tile or character, scaled for the current zoom ###
     if ((useGraphic) && (haveGraphic))
-        painter->drawPixmap(0, 0, *thePixmap);
+        displayPixmap = tileCache->getTile(thePixmap);
     else
-        painter->drawPixmap(0, 0, displayText);
+        displayPixmap = tileCache->getGlyph(telnetChar, theAttributes->getForeground());
+
+    //### Draw pre-scaled pixmaps 1:1, snapped to the device pixel grid ###
+    if (tileCache->getScaled())
+    {
+        deviceTransform = painter->transform();
+        painter->save();
+        painter->setTransform(QTransform::fromTranslate(qRound(deviceTransform.dx()),
+                                                        qRound(deviceTransform.dy())));
+        painter->drawPixmap(0, 0, *displayPixmap);
+        painter->restore();
+    }//if getScaled()
+    else
+        painter->drawPixmap(0, 0, *displayPixmap);
 }//paint
 
 QRectF NetSprite::boundingRect(void)
@@ -94,9 +121,44 @@ QRectF NetSprite::boundingRect(void)
 
 void NetSprite::requestRedraw(void)
 {
-    update(NetSprite::boundingRect());
+    FrameRenderer *frameRenderer = NULL;//draws offscreen sprites
+
+    if (offscreen)
+    {
+        frameRenderer = whiteBoard->getMainWindow()->getFrameRenderer();
+        if (frameRenderer != NULL)
+            frameRenderer->markRow(yPos);
+    }//if offscreen
+    else
+        update(NetSprite::boundingRect());
 }//requestRedraw
 
+QVariant NetSprite::itemChange(GraphicsItemChange change,
+                               const QVariant &value)
+{
+    if ((offscreen) && ((change == ItemPositionHasChanged) || (change == ItemVisibleHasChanged)))
+        requestRedraw();
+
+    return QGraphicsRectItem::itemChange(change, value);
+}//itemChange
+
+void NetSprite::setOffscreen(bool newOffscreen)
+{
+    offscreen = newOffscreen;
+    setFlag(ItemSendsGeometryChanges, offscreen);
+    requestRedraw();
+}//setOffscreen
+
+QPixmap* NetSprite::getDisplayedTile(void)
+{
+    QPixmap *result = NULL;//the tile being shown
+
+    if ((useGraphic) && (haveGraphic))
+        result = thePixmap;
+
+    return result;
+}//getDisplayedTile
+
 void NetSprite::mousePressEvent(QGraphicsSceneMouseEvent *event)
 {
     event->accept();
@@ -134,36 +196,52 @@ void NetSprite::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
 }//mouseReleaseEvent()
 
 void NetSprite::setChar(uint8_t newValue,
-                        SGRAttribute *writeAttributes)
+                        SGRAttribute *writeAttributes,
+                        int newTile)
 {
     telnetChar = newValue;
+    serverTile = newTile;
     theAttributes->setValues(writeAttributes);
 
     changeDisplayGraphic();//must be before changeDisplayChar()
     changeDisplayChar();
-
-    isChanged = true;
 }//setChar
 
+void NetSprite::setRow(int newYPos)
+{
+    yPos = newYPos;
+    setPos(xPos * NGSettings::getSpriteWidth(), yPos * NGSettings::getSpriteHeight());
+}//setRow
+
+void NetSprite::updateGeometry(int newYPos)
+{
+    unsigned int spriteWidth = NGSettings::getSpriteWidth();
+    unsigned int spriteHeight = NGSettings::getSpriteHeight();
+
+    yPos = newYPos;
+
+    prepareGeometryChange();
+    setRect(0, 0, spriteWidth, spriteHeight);
+    setPos(xPos * spriteWidth, yPos * spriteHeight);
+    requestRedraw();
+}//updateGeometry
+
 void NetSprite::changeDisplayGraphic(void)
 {
     NethackFX *netFX = whiteBoard->getNetFX();
-    TelnetProtocol *telnetPro = whiteBoard->getTelnetPro();
-    XtermEscape *escHandler = telnetPro->getEscHandler();
-    int tileNumber = escHandler->getTileNumber();
 
     //### Use the graphic indicated by the server ###
-    if (escHandler->getUseTileNumber())
+    if (serverTile != NO_TILE)
     {
-        thePixmap = netFX->getImage(tileNumber);
+        thePixmap = netFX->getImage(serverTile);
         if (thePixmap == NULL)
         {
-            cout << "NetSprite::changeDisplayGraphic(): the server gave us an invalid glyph: " << tileNumber << endl;
+            cout << "NetSprite::changeDisplayGraphic(): the server gave us an invalid glyph: " << serverTile << endl;
             haveGraphic = false;
         }//if thePixmap
         else
             haveGraphic = true;
-    }//if getUseTileNumber()
+    }//if serverTile
 
     //### Find the graphic for this character ###
     else
@@ -173,7 +251,7 @@ void NetSprite::changeDisplayGraphic(void)
             haveGraphic = false;
         else
             haveGraphic = true;
-    }//else getUseTileNumber()
+    }//else serverTile
 
     //### Schedule a redraw ###
     if ((useGraphic) && (haveGraphic))
@@ -182,67 +260,7 @@ void NetSprite::changeDisplayGraphic(void)
 
 void NetSprite::changeDisplayChar(void)
 {
-    QFont *telnetFont = NGSettings::getTelnetFont();
-    unsigned int spriteWidth = NGSettings::getSpriteWidth();
-    unsigned int spriteHeight = NGSettings::getSpriteHeight();
-
-    QString convertedChar;//the QString version of telnetChar
-    QImage charBuffer(spriteWidth, spriteHeight, QImage::Format_ARGB32);
-    QPainter painter(&charBuffer);//performs the drawing
-    QRectF charRect;//the bounding rectangle for the character
-    string converter;//converts newValue to a QString
-    int fontOffset = NGSettings::getFontOffset();
-
-    //### Color the char buffer black ###
-    charBuffer.fill(qRgb(0, 0, 0));
-
-    //### Extract the telnet character ###
-    converter.push_back(telnetChar);
-    convertedChar = QString(converter.c_str());
-
-    //### Set the font color ###
-    switch (theAttributes->getForeground())
-    {
-        case NGSA_BLACK: painter.setPen(Qt::black);
-            break;
-
-        case NGSA_RED: painter.setPen(Qt::red);
-            break;
-
-        case NGSA_GREEN: painter.setPen(Qt::green);
-            break;
-
-        case NGSA_YELLOW: painter.setPen(Qt::yellow);
-            break;
-
-        case NGSA_BLUE: painter.setPen(Qt::blue);
-            break;
-
-        case NGSA_MAGENTA: painter.setPen(Qt::magenta);
-            break;
-
-        case NGSA_CYAN: painter.setPen(Qt::cyan);
-            break;
-
-        case NGSA_WHITE: painter.setPen(Qt::white);
-            break;
-
-        default:
-            cout << "NetSprite::getHTML(): unknown charColor" << endl;
-            throw 1;
-    }//switch getForeground()
-
-    //### Set the character's bounding box ###
-    charRect = boundingRect();
-    charRect.setY(charRect.y() + fontOffset);
-
-    //### Draw the character ###
-    painter.setFont(*telnetFont);
-    painter.drawText(charRect, Qt::AlignCenter, convertedChar);
-    painter.end();
-
-    //### Set the display text ###
-    displayText = QPixmap::fromImage(charBuffer, Qt::ColorOnly);
+    //### The character itself is drawn from the tile cache ###
     if ((!useGraphic) || (!haveGraphic))
         requestRedraw();
 }//changeDisplayChar
@@ -266,12 +284,8 @@ SGRAttribute* NetSprite::getAttributes(void)
     return theAttributes;
 }//getAttributes
 
-bool NetSprite::getIsChanged(void)
+int NetSprite::getServerTile(void)
 {
-    bool result = false;//true if this char was changed since the previous call
-
-    result = isChanged;
-    isChanged = false;
+    return serverTile;
+}//getServerTile
 
-    return result;
-}//getIsChanged
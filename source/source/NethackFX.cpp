@@ -22,7 +22,12 @@ This file is part of EbonHack.
 #include "MainWindow.hpp"
 #include "NetSprite.hpp"
 #include "HistoryLog.hpp"
+#include "MessageLog.hpp"
 #include "ConfigWriter.hpp"
+#include "NGTrace.hpp"
+#include "TileCache.hpp"
+#include "farmdockwidget.h"
+#include <QtConcurrent/QtConcurrentRun>
 
 using namespace std;
 
@@ -37,7 +42,9 @@ NethackFX::NethackFX(WhiteBoard *newWhiteBoard)
     charHandler = new CharSaver;
     ruleHandler = new RuleLoader;
     spriteHandler = new ImageLoader(whiteBoard);
-    userHistory = new HistoryLog(whiteBoard);
+    tileCache = new TileCache;
+    messageLog = new MessageLog;
+    userHistory = new HistoryLog(whiteBoard, messageLog);
     graveBottom = ConfigWriter::loadString("game_config.txt", "Gravestone Bottom");
 
     userFX = false;
@@ -45,10 +52,26 @@ NethackFX::NethackFX(WhiteBoard *newWhiteBoard)
     showGraphics = false;
     mappingChar = false;
     secondLineFX = true;
+    firstLineWatch = -1;
+    moreWatch = -1;
+    graveWatch = -1;
+    assetsReady = false;
+    autoMap = ConfigWriter::loadBool("game_config.txt", "Auto Map");
+    autoMapping = false;
+    autoMapTimer.start();
 }//constructor
 
 NethackFX::~NethackFX(void)
 {
+    TelnetProtocol *telnetPro = whiteBoard->getTelnetPro();
+
+    //### The telnet window may already be gone ###
+    if (telnetPro != NULL)
+        telnetPro->getTelnetWindow()->removeRowWatches(this);
+
+    //### Don't pull the loaders out from under the worker threads ###
+    waitForLoading();
+
     delete charHandler;
     charHandler = NULL;
 
@@ -58,6 +81,12 @@ NethackFX::~NethackFX(void)
     delete userHistory;
     userHistory = NULL;
 
+    delete messageLog;
+    messageLog = NULL;
+
+    delete tileCache;
+    tileCache = NULL;
+
     delete spriteHandler;
     spriteHandler = NULL;
 }//destructor
@@ -67,6 +96,7 @@ bool NethackFX::initialize(TelnetWindow *newWindow)
     string pathAndName;//the path and filename of the current data file to load
     uint8_t width = 0;//window dimensions in characters
     uint8_t height = 0;
+    bool useTileset = ConfigWriter::loadBool("game_config.txt", "Use Tileset");
     bool result = true;//false on errors
 
     theWindow = newWindow;
@@ -80,11 +110,17 @@ bool NethackFX::initialize(TelnetWindow *newWindow)
         result = false;
     }//if newWidth || newHeight
 
-    //### Load sprites from files ###
+    //### Find out if a custom tileset will replace the default sprites ###
+    if (useTileset)
+        customTileset = QString::fromStdString(ConfigWriter::loadString("game_config.txt", "Tileset"));
+    else
+        customTileset.clear();
+
+    //### Load sprites from files, only their names if we have a custom tileset ###
     if (result)
     {
-        if (!spriteHandler->loadImages())
-            result = false;
+        assetsReady = false;
+        imagesLoaded = QtConcurrent::run(spriteHandler, &ImageLoader::loadImages, useTileset);
     }//if result
 
     //### Load known char-to-sprite mappings from file ###
@@ -92,8 +128,7 @@ bool NethackFX::initialize(TelnetWindow *newWindow)
     {
         pathAndName = NGSettings::DATA_PATH;
         pathAndName.append("knownchars.txt");
-        if (!charHandler->load(pathAndName, knownChars))
-            result = false;
+        charsLoaded = QtConcurrent::run(&NethackFX::loadKnownChars, charHandler, pathAndName, &knownChars);
     }//if result
 
     //### Load rules for enabling and disabling graphics mode ###
@@ -101,107 +136,191 @@ bool NethackFX::initialize(TelnetWindow *newWindow)
     {
         pathAndName = NGSettings::DATA_PATH;
         pathAndName.append("gfxrules.txt");
+        rulesLoaded = QtConcurrent::run(ruleHandler, &RuleLoader::load, pathAndName);
+    }//if result
 
-        if (!ruleHandler->load(pathAndName))
-            result = false;
+    //### Only look at the rows we care about when they change ###
+    if (result)
+    {
+        theWindow->removeRowWatches(this);
+        firstLineWatch = theWindow->addRowWatch(this, 0, FIRST_FX_ROW, "");
+        moreWatch = theWindow->addRowWatch(this, FIRST_FX_ROW, 1, "--More--");
+        graveWatch = theWindow->addRowWatch(this, GRAVE_BOTTOM_ROW, 1, graveBottom);
     }//if result
 
     return result;
 }//initialize
 
+bool NethackFX::finishLoading(bool wait)
+{
+    MainWindow *mainWindow = whiteBoard->getMainWindow();
+    bool finished = true;//false if the background loads are still running
+    bool result = true;//false if the graphics files couldn't be loaded
+
+    if (!assetsReady)
+    {
+        if (wait)
+            waitForLoading();
+        else if ((!imagesLoaded.isFinished()) || (!charsLoaded.isFinished()) || (!rulesLoaded.isFinished()))
+            finished = false;
+
+        //### Check that everything loaded ###
+        if (finished)
+        {
+            if ((!imagesLoaded.result()) || (!charsLoaded.result()) || (!rulesLoaded.result()))
+                result = false;
+        }//if finished
+
+        //### Swap the tiles in ###
+        if ((finished) && (result))
+        {
+            spriteHandler->createPixmaps();
+            assetsReady = true;
+
+            if (customTileset.isEmpty())
+                mainWindow->resetGraphics();
+            else if (!spriteHandler->loadCustom(customTileset))
+            {
+                //We only read the default tile names, so read them again with their pixels
+                if (!loadDefaultTiles())
+                    result = false;
+            }//else if !loadCustom()
+
+            mainWindow->fitWindow();
+
+            cout << "Tiles ready after " << whiteBoard->getUptime() << " ms" << endl;
+        }//if finished && result
+    }//if !assetsReady
+
+    return result;
+}//finishLoading
+
+bool NethackFX::loadKnownChars(CharSaver *theSaver,
+                               string pathAndName,
+                               map <string, int> *theChars)
+{
+    return theSaver->load(pathAndName, *theChars);
+}//loadKnownChars
+
+void NethackFX::waitForLoading(void)
+{
+    imagesLoaded.waitForFinished();
+    charsLoaded.waitForFinished();
+    rulesLoaded.waitForFinished();
+}//waitForLoading
+
+bool NethackFX::getAssetsReady(void)
+{
+    return assetsReady;
+}//getAssetsReady
+
 void NethackFX::setGraphicsScene(QGraphicsScene *newScene)
 {
     theScene = newScene;
 
     userHistory->setGraphicsScene(theScene);
+    tileCache->setGraphicsScene(theScene);
 }//setGraphicsScene
 
-void NethackFX::resetHistoryLog(QGraphicsScene *newScene)
+void NethackFX::setZoom(double newZoom)
 {
-    if (theScene != NULL)
-        userHistory->removeFromScene(theScene);
+    //### The tiles belong to the background loads until they're ready ###
+    if (assetsReady)
+        tileCache->setZoom(newZoom, spriteHandler);
+    else
+        tileCache->setZoom(newZoom, NULL);
+}//setZoom
 
-    delete userHistory;
-    userHistory = new HistoryLog(whiteBoard);
+void NethackFX::resetTileCache(void)
+{
+    if (assetsReady)
+        tileCache->reset(spriteHandler);
+    else
+        tileCache->reset(NULL);
+}//resetTileCache
 
-    setGraphicsScene(newScene);
-}//resetHistoryLog
+TileCache* NethackFX::getTileCache(void)
+{
+    return tileCache;
+}//getTileCache
 
-void NethackFX::updateLogic(TelnetWindow *theWindow)
+void NethackFX::resizeHistoryLog(void)
 {
-    MainWindow *mainWindow = whiteBoard->getMainWindow();
-    string oldFirstLine;//checks if the contents of the first line changed
+    userHistory->resize(theScene);
+}//resizeHistoryLog
 
-    if (theWindow->getDisplayChanged())
+void NethackFX::rowChanged(int watchID,
+                           uint8_t row,
+                           const string &rowText,
+                           bool matched)
+{
+    //### Get rid of compiler warnings about unused parameters ###
+    if (row)
     {
-        oldFirstLine.append(firstLine);
+    }
+    if (rowText.empty())
+    {
+    }
 
-        //### Read the top line(s) of the telnet window ###
-        firstLine.clear();
-        for (int yPos = 0; yPos < FIRST_FX_ROW; yPos++)
-        {
-            for (unsigned int xPos = 0; xPos < theWindow->getWidth(); xPos++)
-                firstLine.push_back(theWindow->getByte(xPos, yPos));
-        }//for yPos
+    if (watchID == firstLineWatch)
+        handleFirstLine();
 
-        //### Check the graphics rules for the first line of text ###
-        if (oldFirstLine != firstLine)
-        {
-            if (ruleHandler->checkActions(firstLine, lineRuleFX))
-            {
-                //We found a rule to enable graphics, this should only happen at the welcome
-                //message. Switch userFX to true. We've previously been blocking FX for the
-                //login screen, now we'll enable them for the game.
-                if (lineRuleFX)
-                    mainWindow->setGraphicsMode(true);//sets userFX and toggles the checkbox
-            }//if ruleHandler
-
-            //If no rule is found, we default to true
-            else
-                lineRuleFX = true;
+    else if (watchID == moreWatch)
+        handleExtendedMore(matched);
 
-            setGraphicsMode();
-        }//if oldFirstLine
+    else if (watchID == graveWatch)
+        handleGravestone(matched);
+}//rowChanged
 
-        handleExtendedMore(theWindow);
-        handleGravestone(theWindow);
+void NethackFX::handleFirstLine(void)
+{
+    MainWindow *mainWindow = whiteBoard->getMainWindow();
+    string oldFirstLine;//checks if the contents of the first line changed
+    NG_TRACE_SPAN("NethackFX::handleFirstLine");
 
-        //### Add the first line to the user's history ###
-        userHistory->updateLogic(firstLine, showGraphics);
-        if (showGraphics)
-            userHistory->show();
+    oldFirstLine.swap(firstLine);
+
+    //### The rules may still be loading, don't wait for the sprites as well ###
+    rulesLoaded.waitForFinished();
+
+    //### Read the top line(s) of the telnet window ###
+    for (int yPos = 0; yPos < FIRST_FX_ROW; yPos++)
+        firstLine.append(theWindow->getRowText(yPos));
+
+    //### Check the graphics rules for the first line of text ###
+    if (oldFirstLine != firstLine)
+    {
+        if ((rulesLoaded.result()) && (ruleHandler->checkActions(firstLine, lineRuleFX)))
+        {
+            //We found a rule to enable graphics, this should only happen at the welcome
+            //message. Switch userFX to true. We've previously been blocking FX for the
+            //login screen, now we'll enable them for the game.
+            if (lineRuleFX)
+                mainWindow->setGraphicsMode(true);//sets userFX and toggles the checkbox
+        }//if ruleHandler
+
+        //If no rule is found, or the rules didn't load, we default to true
         else
-            userHistory->hide();
-    }//if getDisplayChanged
-}//updateLogic
+            lineRuleFX = true;
 
-void NethackFX::handleGravestone(TelnetWindow *theWindow)
+        setGraphicsMode();
+    }//if oldFirstLine
+}//handleFirstLine
+
+void NethackFX::handleGravestone(bool foundGrave)
 {
     MainWindow *mainWindow = whiteBoard->getMainWindow();
-    string graveRow;//the bottom line of the gravestone from the telnet window
-
-    for (unsigned int xPos = 0; xPos < theWindow->getWidth(); xPos++)
-        graveRow.push_back(theWindow->getByte(xPos, GRAVE_BOTTOM_ROW));
 
-    if (graveRow.find(graveBottom) != string::npos)
+    if (foundGrave)
         mainWindow->setGraphicsMode(false);
 }//handleGravestone
 
-void NethackFX::handleExtendedMore(TelnetWindow *theWindow)
+void NethackFX::handleExtendedMore(bool foundMore)
 {
-    string secondLine;//the second line from the telnet window
     bool showSecondFX = true;//true if showGraphics and secondLineFX are true
     bool oldSecondLine = secondLineFX;//see if secondLineFX changed
 
-    //### Extract the second line ###
-    for (unsigned int xPos = 0; xPos < theWindow->getWidth(); xPos++)
-        secondLine.push_back(theWindow->getByte(xPos, FIRST_FX_ROW));
-
-    //### Detect --More-- ###
-    if (secondLine.find("--More--") == string::npos)
-        secondLineFX = true;
-    else
-        secondLineFX = false;
+    secondLineFX = !foundMore;
 
     //### Toggle graphics if necessary ###
     if (oldSecondLine != secondLineFX)
@@ -220,9 +339,23 @@ void NethackFX::updateQuery(void)
     TelnetProtocol *telnetPro = whiteBoard->getTelnetPro();
 
     queryServer();
-    for (int i = 0; i < query.size(); i++)
-        telnetPro->sendKeystroke(query.at(i));
+    if (query.size() > 0)
+        telnetPro->sendBytes(query);
     query.clear();
+
+    //### Swap the tiles in once they've loaded ###
+    if (!finishLoading(false))
+    {
+        cout << "NethackFX: couldn't load the graphics files" << endl;
+        whiteBoard->getQTApp()->exit(1);
+    }//if !finishLoading()
+
+    //### Map unknown characters while the player isn't doing anything ###
+    updateAutoMap();
+
+    //### Sync learned mappings in batches ###
+    if (assetsReady)
+        charHandler->syncJournal(false);
 }//updateQuery
 
 void NethackFX::setGraphicsMode(void)
@@ -265,6 +398,16 @@ void NethackFX::setGraphicsMode(void)
     }//if showGraphics
 }//setGraphicsMode
 
+bool NethackFX::getShowGraphics(void)
+{
+    return showGraphics;
+}//getShowGraphics
+
+MessageLog* NethackFX::getMessageLog(void)
+{
+    return messageLog;
+}//getMessageLog
+
 void NethackFX::setUserFX(bool newUserFX)
 {
     userFX = newUserFX;
@@ -295,9 +438,10 @@ QPixmap* NethackFX::findImage(uint8_t telnetChar,
     charColor = theAttributes->getForeground();
     theKey.push_back(static_cast<char>(charColor));
 
-    //### Search for the graphic in knownChars ###
-    knownIter = knownChars.find(theKey);
-    if (knownIter != knownChars.end())
+    //### Search for the graphic in knownChars, once it's loaded ###
+    if (assetsReady)
+        knownIter = knownChars.find(theKey);
+    if ((assetsReady) && (knownIter != knownChars.end()))
     {
         imageIndex = knownIter->second;
 
@@ -328,6 +472,13 @@ void NethackFX::sendWhatIs(int charX,
     if ((charY < FIRST_FX_ROW) || (charY >= FIRST_STATS_ROW))
         allOK = false;
 
+    //### Verify that the tiles have loaded ###
+    if ((allOK) && (!assetsReady))
+    {
+        whiteBoard->showMessage(QString("The tiles are still loading."));
+        allOK = false;
+    }//if allOK && !assetsReady
+
     //### Verify that the user hasn't started a query manually ###
     if (allOK)
     {
@@ -360,9 +511,87 @@ void NethackFX::sendWhatIs(int charX,
         unknownY = charY;
         myState = NGF_SEND_QUERY;
         mappingChar = mapUnknownChar;
+        autoMapping = false;
     }//if allOK
 }//sendWhatIs
 
+void NethackFX::updateAutoMap(void)
+{
+    TelnetProtocol *telnetPro = whiteBoard->getTelnetPro();
+    FarmDockWidget *farmingWidget = whiteBoard->getMainWindow()->getFarmingWidget();
+    string theKey;//contains a character and color combination
+    uint8_t telnetChar = ' ';//a character on the map
+    uint8_t width = 0;//window width in characters
+    bool allOK = autoMap;//false if we shouldn't send a query
+    bool found = false;//true once we've found an unknown character
+
+    //### Only query while graphics are on and nothing else is talking to the server ###
+    if ((allOK) && ((!assetsReady) || (!showGraphics) || (myState != NGF_START)))
+        allOK = false;
+
+    if ((allOK) && (farmingWidget->isRunning()))
+        allOK = false;
+
+    if ((allOK) && ((!telnetPro->getConnected()) || (telnetPro->getIdleTime() < AUTO_MAP_IDLE_TIME)))
+        allOK = false;
+
+    if ((allOK) && (autoMapTimer.elapsed() < AUTO_MAP_INTERVAL))
+        allOK = false;
+
+    //### Verify that there's no message waiting, and the cursor is on the map ###
+    if (allOK)
+    {
+        if (firstLine.find_first_not_of(' ') != string::npos)
+            allOK = false;
+        else if ((theWindow->getCursorY() < FIRST_FX_ROW) || (theWindow->getCursorY() >= FIRST_STATS_ROW))
+            allOK = false;
+    }//if allOK
+
+    //### Find the first character we don't know and haven't asked about ###
+    if (allOK)
+    {
+        width = theWindow->getWidth();
+
+        for (int yPos = FIRST_FX_ROW; (yPos < FIRST_STATS_ROW) && (!found); yPos++)
+        {
+            for (int xPos = 0; (xPos < width) && (!found); xPos++)
+            {
+                telnetChar = theWindow->getByte(xPos, yPos);
+                if (telnetChar != ' ')
+                {
+                    theKey.clear();
+                    theKey.push_back(telnetChar);
+                    theKey.push_back(static_cast<char>(theWindow->getAttributes(xPos, yPos)->getForeground()));
+
+                    if ((knownChars.find(theKey) == knownChars.end())
+                        && (autoMapTried.find(theKey) == autoMapTried.end()))
+                    {
+                        unknownX = xPos;
+                        unknownY = yPos;
+                        found = true;
+                    }//if find() && find()
+                }//if telnetChar
+            }//for xPos
+        }//for yPos
+    }//if allOK
+
+    //### Start the query, the results are journaled by addMapping() ###
+    if (found)
+    {
+        autoMapTried.insert(theKey);
+        autoMapTimer.start();
+
+        myState = NGF_SEND_QUERY;
+        mappingChar = true;
+        autoMapping = true;
+    }//if found
+}//updateAutoMap
+
+void NethackFX::setAutoMap(bool newAutoMap)
+{
+    autoMap = newAutoMap;
+}//setAutoMap
+
 void NethackFX::queryServer(void)
 {
     string theName;//the name for this tile, received from the server
@@ -509,7 +738,8 @@ bool NethackFX::addDescription(const string &theName)
     else
     {
         cout << "Unknown sprite: " << theName << endl;
-        whiteBoard->showMessage(QString("Couldn't find an image for that character."));
+        if (!autoMapping)
+            whiteBoard->showMessage(QString("Couldn't find an image for that character."));
     }//if !result
 
     return result;
@@ -533,9 +763,12 @@ bool NethackFX::addMapping(string theKey,
             result = false;
     }//if result
 
-    //### Add this entry to the appropriate map ###
+    //### Add this entry to the appropriate map, and journal it if it's new ###
     if (result)
-        knownChars.insert(pair <string, int>(theKey, spriteIndex));
+    {
+        if (knownChars.insert(pair <string, int>(theKey, spriteIndex)).second)
+            charHandler->append(theKey, spriteIndex, knownChars);
+    }//if result
 
     return result;
 }//addMapping
@@ -716,11 +949,14 @@ void NethackFX::save(void)
 
     pathAndName.append("knownchars.txt");
 
+    waitForLoading();
     charHandler->save(pathAndName, knownChars);
 }//save
 
 bool NethackFX::loadCustomTiles(QString filename)
 {
+    finishLoading(true);
+
     return spriteHandler->loadCustom(filename);
 }//loadCustomTiles
 
@@ -729,11 +965,14 @@ bool NethackFX::loadDefaultTiles(void)
     MainWindow *mainWindow = whiteBoard->getMainWindow();
     bool result = true;//false on file access error
 
+    finishLoading(true);
+
     delete spriteHandler;
     spriteHandler = new ImageLoader(whiteBoard);
 
-    if (spriteHandler->loadImages())
+    if (spriteHandler->loadImages(false))
     {
+        spriteHandler->createPixmaps();
         NGSettings::setSpriteSize(ImageLoader::DEFAULT_SPRITE_SIZE, ImageLoader::DEFAULT_SPRITE_SIZE);
         mainWindow->resetGraphics();
     }
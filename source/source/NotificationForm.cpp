@@ -0,0 +1,70 @@
+/*Copyright 2009-2013 David McCallum
+
+This file is part of EbonHack.
+
+    EbonHack is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    EbonHack is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with EbonHack.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "NotificationForm.hpp"
+#include "NotificationQueue.hpp"
+#include "WhiteBoard.hpp"
+#include <QScrollBar>
+
+using namespace std;
+
+NotificationForm::NotificationForm(QWidget* parent,
+                                   Qt::WindowFlags flags,
+                                   WhiteBoard *newWhiteBoard) : QDialog(parent, flags)
+{
+    whiteBoard = newWhiteBoard;
+
+    gui.setupUi(this);
+
+    connect(whiteBoard->getNotifications(), SIGNAL(logChanged()),
+            this, SLOT(refreshLog()));
+    connect(gui.clearButton, SIGNAL(clicked(bool)),
+            this, SLOT(clearClicked()));
+    connect(gui.closeButton, SIGNAL(clicked(bool)),
+            this, SLOT(closeClicked()));
+}//constructor
+
+NotificationForm::~NotificationForm(void)
+{
+}//destructor
+
+void NotificationForm::showLog(void)
+{
+    show();
+    refreshLog();
+}//showLog
+
+void NotificationForm::refreshLog(void)
+{
+    //### Only follow the log while it's on screen ###
+    if (isVisible())
+    {
+        gui.logText->setPlainText(whiteBoard->getNotifications()->getLog().join("\n"));
+        gui.logText->verticalScrollBar()->setValue(gui.logText->verticalScrollBar()->maximum());
+    }//if isVisible()
+}//refreshLog
+
+void NotificationForm::clearClicked(void)
+{
+    whiteBoard->getNotifications()->clearLog();
+}//clearClicked
+
+void NotificationForm::closeClicked(void)
+{
+    hide();
+}//closeClicked
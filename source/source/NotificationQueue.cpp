@@ -0,0 +1,130 @@
+/*Copyright 2009-2013 David McCallum
+
+This file is part of EbonHack.
+
+    EbonHack is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    EbonHack is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with EbonHack.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "NotificationQueue.hpp"
+#include "WhiteBoard.hpp"
+#include <QTime>
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+NotificationQueue::NotificationQueue(WhiteBoard *newWhiteBoard)
+{
+    whiteBoard = newWhiteBoard;
+
+    flushTimer.setSingleShot(true);
+    connect(&flushTimer, SIGNAL(timeout()),
+            this, SLOT(flush()));
+}//constructor
+
+NotificationQueue::~NotificationQueue(void)
+{
+}//destructor
+
+void NotificationQueue::post(const QString &theKey,
+                             const QString &theMessage,
+                             bool popup)
+{
+    NGNotification newCondition;//used the first time theKey is posted
+    NGNotification *condition = NULL;//the condition being posted
+
+    if (!conditions.contains(theKey))
+    {
+        newCondition.popup = popup;
+        newCondition.shown = false;
+        newCondition.pending = 0;
+        newCondition.total = 0;
+        conditions.insert(theKey, newCondition);
+    }//if !contains()
+
+    condition = &conditions[theKey];
+    condition->message = theMessage;
+    condition->pending++;
+    condition->total++;
+
+    if (!flushTimer.isActive())
+        flushTimer.start(FLUSH_DELAY);
+}//post
+
+void NotificationQueue::flush(void)
+{
+    QHash<QString, NGNotification>::iterator i;//iterates through the conditions
+    NGNotification *condition = NULL;//the condition being checked
+    QString logEntry;//one line of the log
+    qint64 waitTime = RATE_LIMIT_TIME;//milliseconds until the next condition is due
+    bool changed = false;//true if we logged anything
+
+    for (i = conditions.begin(); i != conditions.end(); ++i)
+    {
+        condition = &i.value();
+
+        if (condition->pending > 0)
+        {
+            //### Log the condition if it wasn't logged recently ###
+            if ((!condition->lastLogged.isValid()) || (condition->lastLogged.elapsed() >= RATE_LIMIT_TIME))
+            {
+                logEntry = QTime::currentTime().toString("hh:mm:ss") + "  " + condition->message;
+                if (condition->pending > 1)
+                    logEntry += QString(" (repeated %1 times)").arg(condition->pending);
+
+                cout << logEntry.toStdString() << endl;
+                logLines.append(logEntry);
+                changed = true;
+
+                condition->pending = 0;
+                condition->lastLogged.start();
+
+                //### Pop it up the first time only ###
+                if ((condition->popup) && (!condition->shown))
+                {
+                    whiteBoard->showMessage(condition->message);
+                    condition->shown = true;
+                }//if popup
+            }//if lastLogged
+
+            //### Otherwise keep counting, and come back when it's due ###
+            else
+                waitTime = min(waitTime, RATE_LIMIT_TIME - condition->lastLogged.elapsed());
+        }//if pending
+    }//for i
+
+    while (logLines.size() > MAX_LOG_LINES)
+        logLines.removeFirst();
+
+    //### Check again for the conditions still waiting ###
+    for (i = conditions.begin(); i != conditions.end(); ++i)
+    {
+        if ((i.value().pending > 0) && (!flushTimer.isActive()))
+            flushTimer.start(static_cast<int>(max(waitTime, static_cast<qint64>(FLUSH_DELAY))));
+    }//for i
+
+    if (changed)
+        emit logChanged();
+}//flush
+
+const QStringList& NotificationQueue::getLog(void)
+{
+    return logLines;
+}//getLog
+
+void NotificationQueue::clearLog(void)
+{
+    logLines.clear();
+    emit logChanged();
+}//clearLog
@@ -0,0 +1,138 @@
+/*Copyright 2009-2013 David McCallum
+
+This file is part of EbonHack.
+
+    EbonHack is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    EbonHack is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with EbonHack.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "RenderBenchmark.hpp"
+#include "WhiteBoard.hpp"
+#include "MainWindow.hpp"
+#include "NethackFX.hpp"
+#include "TelnetProtocol.hpp"
+#include "TileCache.hpp"
+#include "NGSettings.hpp"
+#include <QApplication>
+#include <QGraphicsScene>
+#include <QImage>
+#include <QElapsedTimer>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+const int RenderBenchmark::ZOOM_LEVELS[NUM_ZOOMS] = {100, 150, 200, 300};
+const string RenderBenchmark::CUSTOM_TILESET = "tilesets/chozob-32x32.png";
+
+bool RenderBenchmark::run(WhiteBoard *whiteBoard,
+                          const string &sessionFile)
+{
+    NethackFX *netFX = whiteBoard->getNetFX();
+    vector <QByteArray> theSession;//every batch of data in the session
+    QString customTileset;//full path to CUSTOM_TILESET
+    bool result = true;//false on errors
+
+    //### Load the session and wait for the default tiles ###
+    result = TelnetProtocol::loadSession(sessionFile, theSession);
+
+    if (result)
+    {
+        if (!netFX->finishLoading(true))
+            result = false;
+    }//if result
+
+    //### Time the default tiles ###
+    if (result)
+    {
+        if (netFX->loadDefaultTiles())
+        {
+            for (int i = 0; i < NUM_ZOOMS; i++)
+                timeSession(whiteBoard, theSession, "default", ZOOM_LEVELS[i]);
+        }//if loadDefaultTiles()
+        else
+            result = false;
+    }//if result
+
+    //### Time the custom tile sheet ###
+    if (result)
+    {
+        customTileset = QString::fromStdString(NGSettings::DATA_PATH + CUSTOM_TILESET);
+
+        if (netFX->loadCustomTiles(customTileset))
+        {
+            for (int i = 0; i < NUM_ZOOMS; i++)
+                timeSession(whiteBoard, theSession, CUSTOM_TILESET, ZOOM_LEVELS[i]);
+        }//if loadCustomTiles()
+        else
+        {
+            cout << "RenderBenchmark::run(): couldn't load " << CUSTOM_TILESET << endl;
+            result = false;
+        }//else loadCustomTiles()
+    }//if result
+
+    return result;
+}//run
+
+void RenderBenchmark::timeSession(WhiteBoard *whiteBoard,
+                                  const vector <QByteArray> &theSession,
+                                  const string &tilesetName,
+                                  int zoomPercent)
+{
+    MainWindow *mainWindow = whiteBoard->getMainWindow();
+    TelnetProtocol *telnetPro = whiteBoard->getTelnetPro();
+    TileCache *tileCache = whiteBoard->getNetFX()->getTileCache();
+    QGraphicsScene *theScene = mainWindow->getScene();
+    double zoom = static_cast<double>(zoomPercent) / static_cast<double>(100);
+    QRectF sceneRect = theScene->sceneRect();//the area to render
+    QImage frame(static_cast<int>(ceil(sceneRect.width() * zoom)),
+                 static_cast<int>(ceil(sceneRect.height() * zoom)),
+                 QImage::Format_ARGB32_Premultiplied);//the offscreen "display"
+    QElapsedTimer timer;//times each frame
+    vector <qint64> frameTimes;//nanoseconds taken by each frame
+    qint64 totalTime = 0;//nanoseconds taken by every frame
+    unsigned int firstPixmaps = 0;//pixmaps created before the first frame
+    unsigned int numPixmaps = 0;//pixmaps created during the session
+
+    //### Scale the tiles before the clock starts ###
+    mainWindow->setZoom(zoom);
+    tileCache->waitForScaling();
+    telnetPro->startReplay();
+    firstPixmaps = tileCache->getPixmapsCreated();
+
+    for (unsigned int i = 0; i < theSession.size(); i++)
+    {
+        //### Parse a batch and show it ###
+        timer.start();
+
+        telnetPro->parseData(theSession.at(i));
+        mainWindow->renderScene(frame);
+
+        frameTimes.push_back(timer.nsecsElapsed());
+        totalTime += frameTimes.back();
+
+        //### Keep the event queue from piling up, outside the timing ###
+        whiteBoard->getQTApp()->processEvents();
+    }//for i
+
+    numPixmaps = tileCache->getPixmapsCreated() - firstPixmaps;
+    sort(frameTimes.begin(), frameTimes.end());
+
+    cout << tilesetName << " at " << zoomPercent << "%: " << frameTimes.size() << " frames, "
+         << static_cast<double>(frameTimes.size()) * 1000000000 / max(totalTime, static_cast<qint64>(1))
+         << " frames/sec" << endl;
+    cout << "    average " << totalTime / (frameTimes.size() * 1000) << " us, p99 "
+         << frameTimes.at((frameTimes.size() - 1) * 99 / 100) / 1000 << " us, "
+         << static_cast<double>(numPixmaps) / frameTimes.size() << " pixmaps per frame" << endl;
+}//timeSession
@@ -17,12 +17,14 @@ This file is part of EbonHack.
 */
 
 #include "RuleLoader.hpp"
+#include <QElapsedTimer>
 
 using namespace std;
 
 RuleLoader::RuleLoader(void)
 {
     currentRule = NULL;
+    useCombined = false;
     resetFSM();
 }//constructor
 
@@ -84,6 +86,9 @@ bool RuleLoader::load(const string &fileName)
     if (infile.is_open())
         infile.close();
 
+    if (result)
+        compileRules();
+
     return result;
 }//load
 
@@ -236,15 +241,189 @@ bool RuleLoader::getCommand(string &oneLine,
 bool RuleLoader::checkActions(const std::string &firstLine,
                               bool &useGraphics)
 {
-    unsigned int rulePos = 0;//index of a rule within theRules
+    int rulePos = findRule(firstLine);//index of the matching rule within theRules
     bool result = false;//true if we found a matching rule
 
-    //### Find a matching rule ###
-    while ((rulePos < theRules.size()) && (!result))
+    if (rulePos >= 0)
     {
-        result = theRules.at(rulePos)->checkRule(firstLine, useGraphics);
-        rulePos++;
-    }//while rulePos && !result
+        theRules.at(rulePos)->applyAction(useGraphics);
+        result = true;
+    }//if rulePos
 
     return result;
 }//checkActions
+
+void RuleLoader::compileRules(void)
+{
+    QString combinedPattern;//every rule, as alternatives
+    QString rulePattern;//the pattern for a single rule
+    QRegularExpression oneRule;//used to validate rulePattern and count its capture groups
+    int groupNumber = 1;//the capture group that wraps the current rule
+
+    useCombined = true;
+    ruleGroups.clear();
+
+    for (unsigned int i = 0; (i < theRules.size()) && (useCombined); i++)
+    {
+        rulePattern = QString::fromStdString(theRules.at(i)->getPattern());
+        oneRule.setPattern(rulePattern);
+
+        //### Back references would point to the wrong group once combined ###
+        if ((!oneRule.isValid())
+            || (rulePattern.contains(QRegularExpression("\\\\[1-9]"))))
+        {
+            cout << "RuleLoader::compileRules(): can't combine " << rulePattern.toStdString()
+                 << ", checking rules one at a time" << endl;
+            useCombined = false;
+        }//if !isValid()
+
+        if (useCombined)
+        {
+            if (i > 0)
+                combinedPattern += "|";
+
+            //### A rule starting with ^ can only match at the start of the line ###
+            if ((rulePattern.startsWith("^")) && (!rulePattern.contains("|")))
+                combinedPattern += "(?=(" + rulePattern + "))";
+            else
+                combinedPattern += "(?=[\\s\\S]*?(" + rulePattern + "))";
+
+            ruleGroups.push_back(groupNumber);
+            groupNumber += oneRule.captureCount() + 1;
+        }//if useCombined
+    }//for i
+
+    //### Anchor at the start, so alternatives are tried in file order ###
+    if (useCombined)
+    {
+        combinedRules.setPattern("^(?:" + combinedPattern + ")");
+        if (!combinedRules.isValid())
+        {
+            cout << "RuleLoader::compileRules(): " << combinedRules.errorString().toStdString()
+                 << ", checking rules one at a time" << endl;
+            useCombined = false;
+        }//if !isValid()
+    }//if useCombined
+}//compileRules
+
+int RuleLoader::findRule(const std::string &firstLine)
+{
+    QRegularExpressionMatch ruleMatch;//the result of running combinedRules
+    int result = -1;//index of the first matching rule
+
+    if (useCombined)
+    {
+        ruleMatch = combinedRules.match(QString::fromStdString(firstLine));
+        if (ruleMatch.hasMatch())
+        {
+            for (unsigned int i = 0; (i < ruleGroups.size()) && (result < 0); i++)
+            {
+                if (ruleMatch.capturedStart(ruleGroups.at(i)) >= 0)
+                    result = i;
+            }//for i
+        }//if hasMatch()
+    }//if useCombined
+    else
+        result = findRuleSequential(firstLine);
+
+    return result;
+}//findRule
+
+int RuleLoader::findRuleSequential(const std::string &firstLine)
+{
+    unsigned int rulePos = 0;//index of a rule within theRules
+    bool useGraphics = false;//not used, checkRule() needs somewhere to put the action
+    int result = -1;//index of the first matching rule
+
+    while ((rulePos < theRules.size()) && (result < 0))
+    {
+        if (theRules.at(rulePos)->checkRule(firstLine, useGraphics))
+            result = rulePos;
+        rulePos++;
+    }//while rulePos && result
+
+    return result;
+}//findRuleSequential
+
+bool RuleLoader::benchmark(const string &rulesFile,
+                           const string &corpusFile)
+{
+    RuleLoader ruleLoader;//the rules to benchmark
+    ifstream infile;//the corpus of first lines
+    vector <string> corpus;//every line in corpusFile, padded to the telnet window width
+    string oneLine;//a single line from corpusFile
+    QElapsedTimer timer;//times each method
+    qint64 combinedTime = 0;//nanoseconds spent in the combined matcher
+    qint64 sequentialTime = 0;//nanoseconds spent checking rules one at a time
+    int numMatched = 0;//number of corpus lines that matched a rule
+    bool result = true;//false on errors, or if the methods disagree
+
+    //### Load the rules and the corpus ###
+    if (!ruleLoader.load(rulesFile))
+        result = false;
+
+    if (result)
+    {
+        infile.open(corpusFile.c_str());
+        if (!infile.good())
+        {
+            cout << "RuleLoader::benchmark(): couldn't open " << corpusFile << endl;
+            result = false;
+        }//if !good()
+    }//if result
+
+    if (result)
+    {
+        while (getline(infile, oneLine))
+        {
+            oneLine.resize(FIRST_LINE_WIDTH, ' ');
+            corpus.push_back(oneLine);
+        }//while getline()
+        infile.close();
+    }//if result
+
+    //### Verify that both methods find the same rule ###
+    for (unsigned int i = 0; (i < corpus.size()) && (result); i++)
+    {
+        if (ruleLoader.findRule(corpus.at(i)) != ruleLoader.findRuleSequential(corpus.at(i)))
+        {
+            cout << "RuleLoader::benchmark(): methods disagree on \"" << corpus.at(i) << "\"" << endl;
+            result = false;
+        }//if findRule()
+
+        if (ruleLoader.findRule(corpus.at(i)) >= 0)
+            numMatched++;
+    }//for i
+
+    //### Time each method ###
+    if ((result) && (corpus.size() > 0))
+    {
+        timer.start();
+        for (int pass = 0; pass < BENCHMARK_PASSES; pass++)
+        {
+            for (unsigned int i = 0; i < corpus.size(); i++)
+                ruleLoader.findRuleSequential(corpus.at(i));
+        }//for pass
+        sequentialTime = timer.nsecsElapsed();
+
+        timer.restart();
+        for (int pass = 0; pass < BENCHMARK_PASSES; pass++)
+        {
+            for (unsigned int i = 0; i < corpus.size(); i++)
+                ruleLoader.findRule(corpus.at(i));
+        }//for pass
+        combinedTime = timer.nsecsElapsed();
+
+        cout << ruleLoader.theRules.size() << " rules, " << corpus.size() << " lines, "
+             << numMatched << " matched" << endl;
+        cout << "one at a time: " << sequentialTime / (BENCHMARK_PASSES * corpus.size())
+             << " ns per line" << endl;
+        cout << "combined:      " << combinedTime / (BENCHMARK_PASSES * corpus.size())
+             << " ns per line";
+        if (!ruleLoader.useCombined)
+            cout << " (rules couldn't be combined)";
+        cout << endl;
+    }//if result
+
+    return result;
+}//benchmark
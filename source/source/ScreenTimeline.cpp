@@ -0,0 +1,288 @@
+/*Copyright 2009-2013 David McCallum
+
+This file is part of EbonHack.
+
+    EbonHack is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    EbonHack is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with EbonHack.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ScreenTimeline.hpp"
+#include "TelnetWindow.hpp"
+#include "ChangeJournal.hpp"
+#include "NetSprite.hpp"
+#include "ConfigWriter.hpp"
+#include "NGTrace.hpp"
+
+using namespace std;
+
+ScreenTimeline::ScreenTimeline(void)
+{
+    firstFrame = 0;
+    sinceKeyframe = 0;
+    lastBatch = 0;
+    windowWidth = 0;
+    windowHeight = 0;
+    bytesUsed = 0;
+    maxBytes = static_cast<qint64>(ConfigWriter::loadInt("game_config.txt", "Timeline Size")) * 1024 * 1024;
+
+    clock.start();
+}//constructor
+
+ScreenTimeline::~ScreenTimeline(void)
+{
+}//destructor
+
+void ScreenTimeline::record(TelnetWindow *theWindow,
+                            const ChangeJournal &theJournal)
+{
+    NGTimelineFrame *newFrame = NULL;//the frame being recorded
+    NGTimelineChange oneChange;//a changed cell
+    const NGCellRange *oneRange = NULL;//cells changed by the batch
+    unsigned int numChanged = 0;//cells the batch changed, counting repeats
+    bool keyframe = false;//true if we should record the whole screen
+    NG_TRACE_SPAN("ScreenTimeline::record");
+
+    if (maxBytes > 0)
+    {
+        for (unsigned int i = 0; i < theJournal.getNumRanges(); i++)
+            numChanged += theJournal.getRange(i).lastColumn - theJournal.getRange(i).firstColumn + 1;
+
+        //### Start over from a keyframe if the deltas wouldn't be much smaller ###
+        if ((frames.empty()) || (sinceKeyframe >= KEYFRAME_INTERVAL) ||
+            (theJournal.getBatchNumber() != lastBatch + 1) ||
+            (theWindow->getWidth() != windowWidth) || (theWindow->getHeight() != windowHeight) ||
+            (numChanged * 2 >= static_cast<unsigned int>(theWindow->getWidth()) * theWindow->getHeight()))
+            keyframe = true;
+
+        frames.push_back(NGTimelineFrame());
+        newFrame = &frames.back();
+        newFrame->time = clock.elapsed();
+        newFrame->keyframe = keyframe;
+        newFrame->width = theWindow->getWidth();
+        newFrame->height = theWindow->getHeight();
+        newFrame->cursorX = theJournal.getCursorX();
+        newFrame->cursorY = theJournal.getCursorY();
+
+        windowWidth = theWindow->getWidth();
+        windowHeight = theWindow->getHeight();
+        lastBatch = theJournal.getBatchNumber();
+
+        //### Copy the whole screen ###
+        if (keyframe)
+        {
+            newFrame->cells.reserve(windowWidth * windowHeight);
+            for (uint8_t y = 0; y < windowHeight; y++)
+            {
+                for (uint8_t x = 0; x < windowWidth; x++)
+                    newFrame->cells.push_back(readCell(theWindow, x, y));
+            }//for y
+
+            sinceKeyframe = 0;
+        }//if keyframe
+
+        //### Or just the cells this batch changed ###
+        else
+        {
+            newFrame->changes.reserve(numChanged);
+            for (unsigned int i = 0; i < theJournal.getNumRanges(); i++)
+            {
+                oneRange = &theJournal.getRange(i);
+                for (unsigned int x = oneRange->firstColumn; (x <= oneRange->lastColumn) && (x < windowWidth); x++)
+                {
+                    oneChange.index = static_cast<uint16_t>(oneRange->row * windowWidth + x);
+                    oneChange.cell = readCell(theWindow, x, oneRange->row);
+                    newFrame->changes.push_back(oneChange);
+                }//for x
+            }//for i
+
+            sinceKeyframe++;
+        }//else keyframe
+
+        bytesUsed += frameBytes(*newFrame);
+        trimFrames();
+    }//if maxBytes
+}//record
+
+NGTimelineCell ScreenTimeline::readCell(TelnetWindow *theWindow,
+                                        uint8_t x,
+                                        uint8_t y)
+{
+    SGRAttribute *theAttributes = theWindow->getAttributes(x, y);
+    NGTimelineCell result;//the copied cell
+
+    result.telnetChar = theWindow->getByte(x, y);
+    result.foreground = static_cast<uint8_t>(theAttributes->getForeground());
+    result.background = static_cast<uint8_t>(theAttributes->getBackground());
+    result.serverTile = theWindow->getNetSprite(x, y)->getServerTile();
+
+    result.style = 0;
+    if (theAttributes->getBold())
+        result.style |= BOLD_FLAG;
+    if (theAttributes->getUnderlined())
+        result.style |= UNDERLINED_FLAG;
+    if (theAttributes->getInverse())
+        result.style |= INVERSE_FLAG;
+    if (theAttributes->getInvisible())
+        result.style |= INVISIBLE_FLAG;
+
+    return result;
+}//readCell
+
+qint64 ScreenTimeline::frameBytes(const NGTimelineFrame &theFrame)
+{
+    return sizeof(NGTimelineFrame) + theFrame.cells.capacity() * sizeof(NGTimelineCell) +
+           theFrame.changes.capacity() * sizeof(NGTimelineChange);
+}//frameBytes
+
+void ScreenTimeline::trimFrames(void)
+{
+    bool haveNextKey = true;//true if there's a keyframe after the oldest one
+
+    while ((bytesUsed > maxBytes) && (haveNextKey))
+    {
+        //### Find the next keyframe, the oldest one can't be dropped without it ###
+        haveNextKey = false;
+        for (unsigned int i = 1; (i < frames.size()) && (!haveNextKey); i++)
+        {
+            if (frames.at(i).keyframe)
+                haveNextKey = true;
+        }//for i
+
+        //### Drop everything before it ###
+        if (haveNextKey)
+        {
+            do
+            {
+                bytesUsed -= frameBytes(frames.front());
+                frames.pop_front();
+                firstFrame++;
+            } while (!frames.front().keyframe);
+        }//if haveNextKey
+    }//while bytesUsed && haveNextKey
+}//trimFrames
+
+bool ScreenTimeline::getEnabled(void)
+{
+    return (maxBytes > 0);
+}//getEnabled
+
+unsigned int ScreenTimeline::getNumFrames(void)
+{
+    return frames.size();
+}//getNumFrames
+
+unsigned int ScreenTimeline::getFirstFrame(void)
+{
+    return firstFrame;
+}//getFirstFrame
+
+unsigned int ScreenTimeline::getLastFrame(void)
+{
+    return firstFrame + frames.size() - 1;
+}//getLastFrame
+
+qint64 ScreenTimeline::getFrameTime(unsigned int frameNumber)
+{
+    qint64 result = 0;//milliseconds since the timeline started
+
+    if ((frameNumber >= firstFrame) && (frameNumber - firstFrame < frames.size()))
+        result = frames.at(frameNumber - firstFrame).time;
+
+    return result;
+}//getFrameTime
+
+qint64 ScreenTimeline::getCurrentTime(void)
+{
+    return clock.elapsed();
+}//getCurrentTime
+
+unsigned int ScreenTimeline::findFrame(qint64 time)
+{
+    unsigned int low = 0;//the answer is at or after low...
+    unsigned int high = frames.size();//...and before high
+    unsigned int middle = 0;//the frame to check
+
+    //### Binary search, the frames are in time order ###
+    while (high - low > 1)
+    {
+        middle = (low + high) / 2;
+        if (frames.at(middle).time <= time)
+            low = middle;
+        else
+            high = middle;
+    }//while high
+
+    return firstFrame + low;
+}//findFrame
+
+bool ScreenTimeline::getScreen(unsigned int frameNumber,
+                               NGTimelineScreen &theScreen)
+{
+    unsigned int index = frameNumber - firstFrame;//the frame's position in frames
+    unsigned int keyIndex = 0;//the keyframe before it
+    NGTimelineChange *oneChange = NULL;//a change to apply
+    bool result = true;//false if the frame isn't kept
+    NG_TRACE_SPAN("ScreenTimeline::getScreen");
+
+    if ((frameNumber < firstFrame) || (index >= frames.size()))
+        result = false;
+
+    if (result)
+    {
+        //### Start from the keyframe ###
+        keyIndex = index;
+        while (!frames.at(keyIndex).keyframe)
+            keyIndex--;
+
+        theScreen.cells = frames.at(keyIndex).cells;
+
+        //### Apply the changes after it, in order ###
+        for (unsigned int i = keyIndex + 1; i <= index; i++)
+        {
+            for (unsigned int j = 0; j < frames.at(i).changes.size(); j++)
+            {
+                oneChange = &frames.at(i).changes.at(j);
+                if (oneChange->index < theScreen.cells.size())
+                    theScreen.cells.at(oneChange->index) = oneChange->cell;
+            }//for j
+        }//for i
+
+        theScreen.frameNumber = frameNumber;
+        theScreen.time = frames.at(index).time;
+        theScreen.width = frames.at(index).width;
+        theScreen.height = frames.at(index).height;
+        theScreen.cursorX = frames.at(index).cursorX;
+        theScreen.cursorY = frames.at(index).cursorY;
+    }//if result
+
+    return result;
+}//getScreen
+
+string ScreenTimeline::getRowText(const NGTimelineScreen &theScreen,
+                                  uint8_t row)
+{
+    string result;//the characters in the row
+
+    if (row < theScreen.height)
+    {
+        for (unsigned int x = 0; x < theScreen.width; x++)
+            result += static_cast<char>(theScreen.cells.at(row * theScreen.width + x).telnetChar);
+    }//if row
+
+    return result;
+}//getRowText
+
+qint64 ScreenTimeline::getMemoryUsed(void)
+{
+    return bytesUsed;
+}//getMemoryUsed
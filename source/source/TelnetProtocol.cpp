@@ -22,9 +22,15 @@ This file is part of EbonHack.
 #include "NetSprite.hpp"
 #include "MainWindow.hpp"
 #include "LatencyWidget.hpp"
+#include "NGTrace.hpp"
+#include "ConfigWriter.hpp"
+#include "NGSettings.hpp"
+#include "NotificationQueue.hpp"
 
 using namespace std;
 
+const string TelnetProtocol::SESSION_FILE = "session.rec";
+
 TelnetProtocol::TelnetProtocol(WhiteBoard *newWhiteBoard,
                                bool newDebug)
 {
@@ -43,12 +49,25 @@ TelnetProtocol::TelnetProtocol(WhiteBoard *newWhiteBoard,
     willEcho = false;
     willToggleFlowControl = false;
     subState = 0;
-    showError = true;
     connecting = false;
+    flushPending = false;
 
     escHandler = new XtermEscape(theWindow, whiteBoard, debugMessages);
     netCursor = NULL;
 
+    //### Record everything the server sends, for the render benchmark ###
+    if (ConfigWriter::loadBool("game_config.txt", "Record Session"))
+    {
+        sessionFile.setFileName(QString::fromStdString(NGSettings::DATA_PATH + SESSION_FILE));
+        if (sessionFile.open(QIODevice::WriteOnly))
+        {
+            sessionStream.setDevice(&sessionFile);
+            sessionStream.setVersion(QDataStream::Qt_5_0);
+        }//if open()
+        else
+            cout << "TelnetProtocol::TelnetProtocol(): couldn't open " << SESSION_FILE << endl;
+    }//if Record Session
+
     //### Connect the socket event handlers ###
     connect(tcpSocket, SIGNAL(readyRead()),
             this, SLOT(runFSM()));
@@ -119,8 +138,9 @@ bool TelnetProtocol::connectToServer(const string &serverAddr)
     if (tcpSocket->state() == QAbstractSocket::UnconnectedState)
         tcpSocket->disconnectFromHost();
 
-    //### Reset the FSM ###
+    //### Reset the FSM and the scrolling region ###
     escHandler->resetFSM();
+    theWindow->setScrollRegion(0, 0);
 
     //### Connect to the new server ###
     tcpSocket->connectToHost(QString::fromStdString(serverAddr), 23, QIODevice::ReadWrite);
@@ -160,11 +180,10 @@ void TelnetProtocol::socketDisconnected(void)
 
 void TelnetProtocol::runFSM(void)
 {
-    NethackFX *netFX = whiteBoard->getNetFX();
     MainWindow *mainWindow = whiteBoard->getMainWindow();
     LatencyWidget *latencyWidget = mainWindow->getLatencyWidget();
     QByteArray serverData;//data sent by the server
-    int byteIndex = 0;//index of the current byte to parse
+    NG_TRACE_SPAN("TelnetProtocol::runFSM");
 
     //### Receive data from server ###
     serverData = tcpSocket->readAll();
@@ -178,7 +197,21 @@ void TelnetProtocol::runFSM(void)
 
     //### Calculate server latency ###
     if (serverData.size() > 0)
+    {
         latencyWidget->reportReply();
+        activityTimer.start();
+    }//if size()
+
+    //### Save the batch for the render benchmark ###
+    if ((sessionFile.isOpen()) && (serverData.size() > 0))
+        sessionStream << serverData;
+
+    parseData(serverData);
+}//runFSM
+
+void TelnetProtocol::parseData(const QByteArray &serverData)
+{
+    int byteIndex = 0;//index of the current byte to parse
 
     while (byteIndex < serverData.size())
     {
@@ -213,7 +246,7 @@ void TelnetProtocol::runFSM(void)
                 break;
 
             case NGTS_ERROR:
-                showErrorDialog(serverData);
+                reportUnknownMessage(serverData);
                 myState = NGTS_START;
                 runStart();
                 break;
@@ -221,9 +254,6 @@ void TelnetProtocol::runFSM(void)
             case NGTS_IAC: runIAC();
                 break;
 
-            case NGTS_ESC: runESC();
-                break;
-
             case NGTS_IAC_DO: runIACDo();
                 break;
 
@@ -258,77 +288,64 @@ void TelnetProtocol::runFSM(void)
         }//switch myState
     }//while byteIndex
 
-    netFX->updateLogic(theWindow);
+    theWindow->finishBatch();
     netCursor->setCursorPos(theWindow->getCursorX(), theWindow->getCursorY());
-}//runFSM
+}//parseData
 
-void TelnetProtocol::runStart(void)
+bool TelnetProtocol::loadSession(const string &sessionFile,
+                                  vector <QByteArray> &theSession)
 {
-    switch (currentByte)
-    {
-        case NGTP_IAC: myState = NGTS_IAC;
-            break;
-
-        //carriage return
-        case NGTC_CR:
-            theWindow->setCursorX(1);
-            myState = NGTS_START;
-            break;
-
-        //line feed
-        case NGTC_LF:
-            theWindow->moveCursorY(1);
-            myState = NGTS_START;
-            break;
+    QFile infile(QString::fromStdString(sessionFile));//the recorded session
+    QDataStream inStream;//reads one batch at a time
+    QByteArray oneBatch;//a single batch of server data
+    bool result = true;//false on errors
 
-        //no operation
-        case NGTC_NOP:
-            myState = NGTS_START;
-            break;
+    if (!infile.open(QIODevice::ReadOnly))
+    {
+        cout << "TelnetProtocol::loadSession(): couldn't open " << sessionFile << endl;
+        result = false;
+    }//if !open()
 
-        //backspace
-        case NGTC_BS:
-            theWindow->moveCursorX(-1);
-            myState = NGTS_START;
-            break;
+    if (result)
+    {
+        inStream.setDevice(&infile);
+        inStream.setVersion(QDataStream::Qt_5_0);
 
-        //escape
-        case NGTC_ESC:
-            myState = NGTS_ESC;
-            break;
+        while ((!inStream.atEnd()) && (inStream.status() == QDataStream::Ok))
+        {
+            inStream >> oneBatch;
+            if (inStream.status() == QDataStream::Ok)
+                theSession.push_back(oneBatch);
+        }//while atEnd()
 
-        //shift in
-        case NGTC_SHIFT_IN:
-            myState = NGTS_START;
-            break;
+        if (theSession.empty())
+        {
+            cout << "TelnetProtocol::loadSession(): " << sessionFile << " is empty" << endl;
+            result = false;
+        }//if empty()
+    }//if result
 
-        //shift out
-        case NGTC_SHIFT_OUT:
-            myState = NGTS_START;
-            break;
+    return result;
+}//loadSession
 
-        //beep
-        case NGTC_BELL:
-            QApplication::beep();
-            myState = NGTS_START;
-            break;
+void TelnetProtocol::startReplay(void)
+{
+    theWindow->enableEraseAll(false);
+    escHandler->resetFSM();
+    theWindow->setScrollRegion(0, 0);
 
-        default:
-            theWindow->writeByte(currentByte);
-            myState = NGTS_START;
-            break;
-    }//switch currentByte
-}//runStart
+    myState = NGTS_START;
+}//startReplay
 
-void TelnetProtocol::runESC(void)
+void TelnetProtocol::runStart(void)
 {
-    NGX_State escState = escHandler->run(currentByte);//the current state of the xterm FSM
+    //### Everything but telnet commands goes to the terminal parser ###
+    if (currentByte == NGTP_IAC)
+        myState = NGTS_IAC;
 
-    if (escState == NGXS_START)
-        myState = NGTS_START;
-    else if (escState == NGXS_ERROR)
+    else if (!escHandler->run(currentByte))
         myState = NGTS_ERROR;
-}//runESC
+}//runStart
 
 void TelnetProtocol::runIAC(void)
 {
@@ -349,6 +366,14 @@ void TelnetProtocol::runIAC(void)
         case NGTP_DATA_MARK: myState = NGTS_START;
             break;
 
+        //An escaped 255 data byte
+        case NGTP_IAC:
+            if (escHandler->run(currentByte))
+                myState = NGTS_START;
+            else
+                myState = NGTS_ERROR;
+            break;
+
         default:
             cout << "TelnetProtocol::runIAC(): got an unknown byte: "
                  << static_cast<int>(currentByte) << endl;
@@ -1020,11 +1045,6 @@ void TelnetProtocol::runIACSBToggleFlow()
     }//switch subState
 }//runIACSBToggleFlow
 
-bool TelnetProtocol::getDisplayChanged(void)
-{
-    return theWindow->getDisplayChanged();
-}//getDisplayChanged
-
 uint8_t TelnetProtocol::getWidth(void)
 {
     return theWindow->getWidth();
@@ -1052,38 +1072,54 @@ uint8_t TelnetProtocol::getByte(uint8_t xPos,
     return theWindow->getByte(xPos, yPos);
 }//getByte
 
-void TelnetProtocol::sendKeystroke(uint8_t keyType)
+void TelnetProtocol::sendBytes(const QByteArray &keystrokes)
 {
     MainWindow *mainWindow = whiteBoard->getMainWindow();
     LatencyWidget *latencyWidget = mainWindow->getLatencyWidget();
-    QByteArray theMessage;//the message to send
+    QByteArray theMessage;//the message to send, with IAC bytes escaped
+    uint8_t oneByte = 0;//the current keystroke
 
-    theWindow->enableEraseAll(true);
-
-    theMessage.append(keyType);
-    latencyWidget->reportCommand();
-    repeatSend(theMessage);
-}//sendKeystroke
-
-void TelnetProtocol::sendCommand(const QString &command)
-{
-    MainWindow *mainWindow = whiteBoard->getMainWindow();
-    LatencyWidget *latencyWidget = mainWindow->getLatencyWidget();
-    QByteArray theMessage;//the message to send
+    if (keystrokes.size() > 0)
+    {
+        theWindow->enableEraseAll(true);
 
-    theWindow->enableEraseAll(true);
+        //### Double any IAC bytes so the server doesn't treat them as telnet commands ###
+        theMessage.reserve(keystrokes.size());
+        for (int i = 0; i < keystrokes.size(); i++)
+        {
+            oneByte = keystrokes.at(i);
+            theMessage.append(oneByte);
+            if (oneByte == NGTP_IAC)
+                theMessage.append(oneByte);
+        }//for i
 
-    theMessage.append(command);
-    latencyWidget->reportCommand();
-    repeatSend(theMessage);
-}//sendKeystroke
+        latencyWidget->reportCommand();
+        activityTimer.start();
+        repeatSend(theMessage);
+    }//if size()
+}//sendBytes
 
 void TelnetProtocol::repeatSend(const QByteArray &theData)
 {
     sendQueue.append(theData);
-    sendData();
+    scheduleFlush();
 }//repeatSend
 
+void TelnetProtocol::scheduleFlush(void)
+{
+    if (!flushPending)
+    {
+        flushPending = true;
+        QTimer::singleShot(0, this, SLOT(flushSendQueue()));
+    }//if !flushPending
+}//scheduleFlush
+
+void TelnetProtocol::flushSendQueue(void)
+{
+    flushPending = false;
+    sendData();
+}//flushSendQueue
+
 void TelnetProtocol::sendData(void)
 {
     int bytesWritten = 0;//the number of bytes sent
@@ -1119,34 +1155,39 @@ void TelnetProtocol::sendData(void)
     }//if size()
 }//sendData
 
-void TelnetProtocol::showBoundsDialog(void)
+void TelnetProtocol::reportOutOfBounds(void)
 {
-    QString errMsg;//the error to display
-
-    if (showError)
-    {
-        errMsg = QString("WARNING: EbonHack received data outside of the display window. ");
-        errMsg += QString("The display may no longer accurately reflect the game contents. ");
-        errMsg += QString("\n\n");
-        errMsg += QString("This message will only appear once.");
-
-        whiteBoard->showMessage(errMsg);
-
-        showError = false;
-    }//if showError
-}//showBoundsDialog
+    whiteBoard->getNotifications()->post("out of bounds",
+        "WARNING: EbonHack received data outside of the display window. "
+        "The display may no longer accurately reflect the game contents.", true);
+}//reportOutOfBounds
 
 XtermEscape* TelnetProtocol::getEscHandler(void)
 {
     return escHandler;
 }//getEscHandler
 
-void TelnetProtocol::showErrorDialog(const QByteArray &serverData)
+bool TelnetProtocol::getConnected(void)
+{
+    return (myState != NGTS_DISCONNECTED);
+}//getConnected
+
+qint64 TelnetProtocol::getIdleTime(void)
+{
+    qint64 result = 0;//milliseconds since data was last sent or received
+
+    if (activityTimer.isValid())
+        result = activityTimer.elapsed();
+
+    return result;
+}//getIdleTime
+
+void TelnetProtocol::reportUnknownMessage(const QByteArray &serverData)
 {
-    QString errMsg;//the error to display
     uint8_t oneByte = 0;//the current byte to output
 
-    if (serverData.size() > 0)
+    //### Dump the batch when debugging, the notification says the rest ###
+    if ((debugMessages) && (serverData.size() > 0))
     {
         cout << "Remaining data: " << endl;
         for (int i = 0; i < serverData.size(); i++)
@@ -1155,18 +1196,9 @@ void TelnetProtocol::showErrorDialog(const QByteArray &serverData)
             cout << static_cast<int>(oneByte) << " ";
         }//for i
         cout << endl;
-    }//if size()
-
-    if (showError)
-    {
-        cout << "TelnetProtocol got an unknown message." << endl;
-
-        errMsg = QString("WARNING: EbonHack received an unknown message from the server. ");
-        errMsg += QString("The display may no longer accurately reflect the game contents. ");
-        errMsg += QString("\n\n");
-        errMsg += QString("This message will only appear once.");
+    }//if debugMessages
 
-        whiteBoard->showMessage(errMsg);
-        showError = false;
-    }//if showError
-}//showErrorDialog
+    whiteBoard->getNotifications()->post("unknown message",
+        "WARNING: EbonHack received an unknown message from the server. "
+        "The display may no longer accurately reflect the game contents.", true);
+}//reportUnknownMessage
@@ -21,7 +21,10 @@ This file is part of EbonHack.
 #include "NGSettings.hpp"
 #include "NetSprite.hpp"
 #include "TelnetProtocol.hpp"
+#include "XtermEscape.hpp"
 #include "ImageLoader.hpp"
+#include "NGTrace.hpp"
+#include <algorithm>
 
 using namespace std;
 
@@ -33,18 +36,24 @@ TelnetWindow::TelnetWindow(WhiteBoard *newWhiteBoard)
     writeY = 0;
     windowWidth = 0;
     windowHeight = 0;
-    displayChanged = true;
     allowEraseAll = true;
     firstEraseAll = true;
     theScene = NULL;
+    nextWatchID = 0;
+    scrollTop = 0;
+    scrollBottom = 0;
+    usingAlternate = false;
+    offscreen = false;
+    screenHash = 0;
 }//constructor
 
 TelnetWindow::~TelnetWindow(void)
 {
     clearWindow(theWindow);
+    clearWindow(otherWindow);
 }//destructor
 
-void TelnetWindow::clearWindow(vector <DisplayRow*> aWindow)
+void TelnetWindow::clearWindow(vector <DisplayRow*> &aWindow)
 {
     //### Remove the sprites from the scene ###
     if (theScene != NULL)
@@ -57,9 +66,6 @@ void TelnetWindow::clearWindow(vector <DisplayRow*> aWindow)
     for (unsigned int i = 0; i < aWindow.size(); i++)
         delete aWindow.at(i);
     aWindow.clear();
-
-    //### Remember that any new sprites don't belong to a scene ###
-    theScene = NULL;
 }//clearWindow
 
 bool TelnetWindow::initialize(uint8_t newWidth,
@@ -93,62 +99,60 @@ bool TelnetWindow::initialize(uint8_t newWidth,
         writeY = 0;
         windowWidth = newWidth;
         windowHeight = newHeight;
-        displayChanged = true;
+        scrollTop = 0;
+        scrollBottom = windowHeight - 1;
+        usingAlternate = false;
 
+        //### Remember that the new sprites don't belong to a scene ###
         clearWindow(theWindow);
+        clearWindow(otherWindow);
+        theScene = NULL;
 
+        //### Create the normal and alternate screen buffers ###
         for (unsigned y = 0; y < windowHeight; y++)
         {
             oneRow = new DisplayRow(whiteBoard, windowWidth, y + historyLines);
             theWindow.push_back(oneRow);
+
+            oneRow = new DisplayRow(whiteBoard, windowWidth, y + historyLines);
+            otherWindow.push_back(oneRow);
         }//for y
+
+        staleText.assign(windowHeight, true);
+        rowText.assign(windowHeight, string());
+        graphicsRows.assign(windowHeight, false);
+        seenScreens.clear();
+
+        //### Every row needs to be reported to the row watches ###
+        currentJournal.reset(currentJournal.getBatchNumber() + 1, windowWidth, windowHeight, writeX, writeY);
+        markRowsDirty(0, windowHeight);
     }//if result
 
     return result;
 }//initialize
 
-void TelnetWindow::resetWindow(QGraphicsScene *newScene)
+void TelnetWindow::updateGeometry(void)
 {
-    std::vector <DisplayRow*> oldWindow;
-    NetSprite *destSprite = NULL;//a single sprite from destRow
-    NetSprite *sourceSprite = NULL;//a single sprite from sourceRow
-    DisplayRow *destRow = NULL;//a row from the display window we're creating
-    DisplayRow *sourceRow = NULL;//a row from the old display window
     int historyLines = NGSettings::getHistoryLines();
+    NG_TRACE_SPAN("TelnetWindow::updateGeometry");
 
-    //### Save the window contents ###
-    oldWindow = theWindow;
-    theWindow.clear();
-
-    //### Create the new window ###
-    for (unsigned y = 0; y < windowHeight; y++)
-    {
-        sourceRow = oldWindow.at(y);
-        destRow = new DisplayRow(whiteBoard, windowWidth, y + historyLines);
-        theWindow.push_back(destRow);
-
-        for (unsigned int x = 0; x < destRow->size(); x++)
-        {
-            sourceSprite = sourceRow->getNetSprite(x);
-            destSprite = destRow->getNetSprite(x);
-
-            destSprite->setChar(sourceSprite->getChar(), sourceSprite->getAttributes());
-        }//for x
-    }//for y
-
-    //### Delete the old window ###
-    clearWindow(oldWindow);
+    //### Move and resize the sprites in place ###
+    for (unsigned int y = 0; y < theWindow.size(); y++)
+        theWindow.at(y)->updateGeometry(y + historyLines);
 
-    //### Add the window to the graphics scene ###
-    setGraphicsScene(newScene);
+    for (unsigned int y = 0; y < otherWindow.size(); y++)
+        otherWindow.at(y)->updateGeometry(y + historyLines);
 
-    //### Redraw the sprites ###
+    //### The old tiles may be gone, find the new ones ###
     for (unsigned int y = 0; y < theWindow.size(); y++)
     {
         for (unsigned int x = 0; x < windowWidth; x++)
-            notifyFxChange(x, y);
+        {
+            theWindow.at(y)->getNetSprite(x)->changeDisplayGraphic();
+            otherWindow.at(y)->getNetSprite(x)->changeDisplayGraphic();
+        }//for x
     }//for y
-}//resetWindow
+}//updateGeometry
 
 uint8_t TelnetWindow::getByte(uint8_t xPos,
                               uint8_t yPos)
@@ -158,13 +162,13 @@ uint8_t TelnetWindow::getByte(uint8_t xPos,
     if (xPos >= windowWidth)
     {
         xPos = windowWidth - 1;
-        whiteBoard->getTelnetPro()->showBoundsDialog();
+        whiteBoard->getTelnetPro()->reportOutOfBounds();
     }//if xPos
 
     if (yPos >= windowHeight)
     {
         yPos = windowHeight - 1;
-        whiteBoard->getTelnetPro()->showBoundsDialog();
+        whiteBoard->getTelnetPro()->reportOutOfBounds();
     }//if yPos
 
     oneRow = theWindow.at(yPos);
@@ -180,13 +184,13 @@ SGRAttribute* TelnetWindow::getAttributes(uint8_t xPos,
     if (xPos >= windowWidth)
     {
         xPos = windowWidth - 1;
-        whiteBoard->getTelnetPro()->showBoundsDialog();
+        whiteBoard->getTelnetPro()->reportOutOfBounds();
     }//if xPos
 
     if (yPos >= windowHeight)
     {
         yPos = windowHeight - 1;
-        whiteBoard->getTelnetPro()->showBoundsDialog();
+        whiteBoard->getTelnetPro()->reportOutOfBounds();
     }//if yPos
 
     oneRow = theWindow.at(yPos);
@@ -214,7 +218,7 @@ void TelnetWindow::setCursorX(uint8_t newValue)
     if (writeX >= windowWidth)
     {
         writeX = windowWidth - 1;
-        whiteBoard->getTelnetPro()->showBoundsDialog();
+        whiteBoard->getTelnetPro()->reportOutOfBounds();
     }//if writeX
 }//setCursorX
 
@@ -228,7 +232,7 @@ void TelnetWindow::setCursorY(uint8_t newValue)
     if (writeY >= windowHeight)
     {
         writeY = windowHeight -1;
-        whiteBoard->getTelnetPro()->showBoundsDialog();
+        whiteBoard->getTelnetPro()->reportOutOfBounds();
     }//if writeY
 }//setCursorY
 
@@ -256,7 +260,7 @@ void TelnetWindow::moveCursorY(int amount)
     if (testPos >= windowHeight)
     {
         writeY = windowHeight - 1;
-        whiteBoard->getTelnetPro()->showBoundsDialog();
+        whiteBoard->getTelnetPro()->reportOutOfBounds();
     }//if testPos
 
     else
@@ -265,10 +269,17 @@ void TelnetWindow::moveCursorY(int amount)
 
 void TelnetWindow::writeByte(uint8_t oneByte)
 {
+    XtermEscape *escHandler = whiteBoard->getTelnetPro()->getEscHandler();
     DisplayRow *oneRow = NULL;//the window row to write to
+    int serverTile = NetSprite::NO_TILE;//the tile the server sent with oneByte
+
+    //### Remember the server's tile with the character, while it's still current ###
+    if (escHandler->getUseTileNumber())
+        serverTile = escHandler->getTileNumber();
 
     oneRow = theWindow.at(writeY);
-    oneRow->setChar(writeX, oneByte, &writeAttribute);
+    oneRow->setChar(writeX, oneByte, &writeAttribute, serverTile);
+    markCellsDirty(writeY, writeX, writeX);
 
     writeX++;
     if (writeX >= windowWidth)
@@ -279,31 +290,11 @@ void TelnetWindow::writeByte(uint8_t oneByte)
         if (writeY >= windowHeight)
         {
             writeY = windowHeight - 1;
-            whiteBoard->getTelnetPro()->showBoundsDialog();
+            whiteBoard->getTelnetPro()->reportOutOfBounds();
         }//if writeY
     }//if writeX
-
-    displayChanged = true;
 }//writeByte
 
-bool TelnetWindow::getDisplayChanged(void)
-{
-    bool result = displayChanged;
-
-    displayChanged = false;
-
-    return result;
-}//getDisplayChanged
-
-bool TelnetWindow::charChanged(uint8_t x,
-                               uint8_t y)
-{
-    DisplayRow *oneRow = theWindow.at(y);
-    NetSprite *oneSprite = oneRow->getNetSprite(x);
-
-    return oneSprite->getIsChanged();
-}//charChanged
-
 void TelnetWindow::setGraphicsScene(QGraphicsScene *newScene)
 {
     DisplayRow *oneRow = NULL;//the current window row
@@ -322,6 +313,21 @@ void TelnetWindow::setGraphicsScene(QGraphicsScene *newScene)
     for (uint8_t y = 0; y < theWindow.size(); y++)
     {
         oneRow = theWindow.at(y);
+        oneRow->setOffscreen(offscreen);
+
+        for (uint8_t x = 0; x < windowWidth; x++)
+        {
+            currentSprite = oneRow->getNetSprite(x);
+            theScene->addItem(currentSprite);
+        }//for x
+    }//for y
+
+    //### The other screen buffer is in the scene too, but hidden ###
+    for (uint8_t y = 0; y < otherWindow.size(); y++)
+    {
+        oneRow = otherWindow.at(y);
+        oneRow->setVisible(false);
+        oneRow->setOffscreen(offscreen);
 
         for (uint8_t x = 0; x < windowWidth; x++)
         {
@@ -341,6 +347,7 @@ void TelnetWindow::setGraphicsMode(bool useGraphics,
     for (unsigned int y = topRow; y < topRow + numRows; y++)
     {
         currentRow = theWindow.at(y);
+        graphicsRows.at(y) = useGraphics;
 
         for (unsigned int x = 0; x < windowWidth; x++)
         {
@@ -359,6 +366,191 @@ void TelnetWindow::notifyFxChange(int x,
     oneSprite->changeDisplayGraphic();
 }//notifyFxChange
 
+int TelnetWindow::addRowWatch(RowWatcher *watcher,
+                              uint8_t topRow,
+                              uint8_t numRows,
+                              const string &pattern)
+{
+    NGRowWatch newWatch;//the watch to add
+
+    newWatch.watcher = watcher;
+    newWatch.watchID = nextWatchID;
+    newWatch.topRow = topRow;
+    newWatch.numRows = numRows;
+    newWatch.pattern = pattern;
+    rowWatches.push_back(newWatch);
+
+    nextWatchID++;
+
+    return newWatch.watchID;
+}//addRowWatch
+
+void TelnetWindow::removeRowWatches(RowWatcher *watcher)
+{
+    vector <NGRowWatch>::iterator watchIter = rowWatches.begin();//the watch to examine
+
+    while (watchIter != rowWatches.end())
+    {
+        if (watchIter->watcher == watcher)
+            watchIter = rowWatches.erase(watchIter);
+        else
+            watchIter++;
+    }//while watchIter
+}//removeRowWatches
+
+void TelnetWindow::finishBatch(void)
+{
+    //### Publish the journal, anything watchers change goes in the next batch ###
+    currentJournal.setCursor(writeX, writeY);
+    lastJournal.swap(currentJournal);
+    currentJournal.reset(lastJournal.getBatchNumber() + 1, windowWidth, windowHeight, writeX, writeY);
+
+    //### Count how often we've ended on this screen ###
+    screenHash = getRegionHash(0, windowHeight);
+    if ((seenScreens.size() >= MAX_SEEN_SCREENS) && !seenScreens.contains(screenHash))
+        seenScreens.clear();
+    seenScreens[screenHash]++;
+
+    timeline.record(this, lastJournal);
+    dispatchRowWatches();
+}//finishBatch
+
+const ChangeJournal& TelnetWindow::getChangeJournal(void)
+{
+    return lastJournal;
+}//getChangeJournal
+
+ScreenTimeline& TelnetWindow::getTimeline(void)
+{
+    return timeline;
+}//getTimeline
+
+void TelnetWindow::dispatchRowWatches(void)
+{
+    vector <NGRowWatch> currentWatches;//the watches to notify
+    NGRowWatch *oneWatch = NULL;//the watch we're notifying
+    const string *text = NULL;//the contents of a changed row
+    bool matched = true;//true if the row contains the watch's pattern
+    NG_TRACE_SPAN("TelnetWindow::dispatchRowWatches");
+
+    //### Watchers can add and remove watches, so notify a copy of the list ###
+    currentWatches = rowWatches;
+
+    for (unsigned int i = 0; i < currentWatches.size(); i++)
+    {
+        oneWatch = &currentWatches.at(i);
+
+        for (unsigned int y = oneWatch->topRow; (y < oneWatch->topRow + oneWatch->numRows) && (y < windowHeight); y++)
+        {
+            if (lastJournal.getRowChanged(y))
+            {
+                text = &getRowText(y);
+
+                if (oneWatch->pattern.empty())
+                    matched = true;
+                else
+                    matched = (text->find(oneWatch->pattern) != string::npos);
+
+                oneWatch->watcher->rowChanged(oneWatch->watchID, y, *text, matched);
+            }//if getRowChanged()
+        }//for y
+    }//for i
+}//dispatchRowWatches
+
+quint64 TelnetWindow::getRowHash(uint8_t yPos)
+{
+    if (yPos >= windowHeight)
+    {
+        yPos = windowHeight - 1;
+        whiteBoard->getTelnetPro()->reportOutOfBounds();
+    }//if yPos
+
+    return theWindow.at(yPos)->getHash();
+}//getRowHash
+
+quint64 TelnetWindow::getRegionHash(uint8_t topRow,
+                                    uint8_t numRows)
+{
+    quint64 result = 0;//the row hashes, each mixed with its row number
+
+    //### Mix in the row number, so swapping two rows changes the hash ###
+    for (unsigned int y = topRow; (y < topRow + numRows) && (y < windowHeight); y++)
+        result ^= DisplayRow::mixHash(theWindow.at(y)->getHash() + y);
+
+    return result;
+}//getRegionHash
+
+quint64 TelnetWindow::getScreenHash(void)
+{
+    return screenHash;
+}//getScreenHash
+
+unsigned int TelnetWindow::getTimesSeen(quint64 theHash)
+{
+    return seenScreens.value(theHash, 0);
+}//getTimesSeen
+
+const string& TelnetWindow::getRowText(uint8_t yPos)
+{
+    DisplayRow *oneRow = NULL;//the row to copy
+
+    if (yPos >= windowHeight)
+    {
+        yPos = windowHeight - 1;
+        whiteBoard->getTelnetPro()->reportOutOfBounds();
+    }//if yPos
+
+    //### Only rebuild the text when the row was written to ###
+    if (staleText.at(yPos))
+    {
+        oneRow = theWindow.at(yPos);
+        rowText.at(yPos).resize(windowWidth);
+
+        for (unsigned int xPos = 0; xPos < windowWidth; xPos++)
+            rowText.at(yPos)[xPos] = oneRow->getChar(xPos);
+
+        staleText.at(yPos) = false;
+    }//if staleText
+
+    return rowText.at(yPos);
+}//getRowText
+
+NetSprite* TelnetWindow::getNetSprite(uint8_t xPos,
+                                      uint8_t yPos)
+{
+    return theWindow.at(yPos)->getNetSprite(xPos);
+}//getNetSprite
+
+void TelnetWindow::setOffscreen(bool newOffscreen)
+{
+    offscreen = newOffscreen;
+
+    for (unsigned int y = 0; y < theWindow.size(); y++)
+        theWindow.at(y)->setOffscreen(offscreen);
+
+    for (unsigned int y = 0; y < otherWindow.size(); y++)
+        otherWindow.at(y)->setOffscreen(offscreen);
+}//setOffscreen
+
+void TelnetWindow::markRowsDirty(uint8_t topRow,
+                                 uint8_t numRows)
+{
+    for (unsigned int y = topRow; (y < topRow + numRows) && (y < staleText.size()); y++)
+        staleText.at(y) = true;
+
+    currentJournal.markRows(topRow, numRows);
+}//markRowsDirty
+
+void TelnetWindow::markCellsDirty(uint8_t row,
+                                  uint8_t firstColumn,
+                                  uint8_t lastColumn)
+{
+    if (row < staleText.size())
+        staleText.at(row) = true;
+
+    currentJournal.markCells(row, firstColumn, lastColumn);
+}//markCellsDirty
+
 uint8_t TelnetWindow::getWidth(void)
 {
     return windowWidth;
@@ -388,10 +580,10 @@ void TelnetWindow::eraseAll(void)
         {
             oneRow = theWindow.at(yPos);
             for (unsigned int xPos = 0; xPos < windowWidth; xPos++)
-                oneRow->setChar(xPos, ' ', &writeAttribute);
+                oneRow->setChar(xPos, ' ', &writeAttribute, NetSprite::NO_TILE);
         }//for yPos
 
-        displayChanged = true;
+        markRowsDirty(0, windowHeight);
     }//if allowEraseAll || firstEraseAll
 }//eraseAll
 
@@ -402,10 +594,10 @@ void TelnetWindow::eraseBelow(void)
     for (unsigned int yPos = writeY; yPos < windowHeight; yPos++)
     {
         oneRow = theWindow.at(yPos);
-        oneRow->setChar(writeX, ' ', &writeAttribute);
+        oneRow->setChar(writeX, ' ', &writeAttribute, NetSprite::NO_TILE);
     }//for yPos
 
-    displayChanged = true;
+    markRowsDirty(writeY, windowHeight - writeY);
 }//eraseBelow
 
 void TelnetWindow::eraseToRight(void)
@@ -414,46 +606,175 @@ void TelnetWindow::eraseToRight(void)
 
     oneRow = theWindow.at(writeY);
     for (unsigned int xPos = writeX; xPos < windowWidth; xPos++)
-        oneRow->setChar(xPos, ' ', &writeAttribute);
+        oneRow->setChar(xPos, ' ', &writeAttribute, NetSprite::NO_TILE);
 
-    displayChanged = true;
+    markCellsDirty(writeY, writeX, windowWidth - 1);
 }//eraseToRight()
 
 void TelnetWindow::deleteLines(int numDelete)
 {
-    DisplayRow *oneRow = NULL;//the current row to alter
-    DisplayRow *nextRow = NULL;//we'll set oneRow to nextRow
-    SGRAttribute *newAttributes = NULL;//the new attributes to copy to oneRow
-    int delCount = 0;//the number of characters deleted so far
-    uint8_t newChar = 0;//a character to copy to oneRow
+    //### Lines are only deleted inside the scrolling region ###
+    if ((writeY >= scrollTop) && (writeY <= scrollBottom))
+        rotateRows(writeY, scrollBottom, numDelete);
+}//deleteLines
 
-    //### Shuffle the lines up ###
-    while (delCount < numDelete)
+void TelnetWindow::insertLines(int numInsert)
+{
+    //### Lines are only inserted inside the scrolling region ###
+    if ((writeY >= scrollTop) && (writeY <= scrollBottom))
+        rotateRows(writeY, scrollBottom, numInsert * -1);
+}//insertLines
+
+void TelnetWindow::scrollUp(int numLines)
+{
+    rotateRows(scrollTop, scrollBottom, numLines);
+}//scrollUp
+
+void TelnetWindow::scrollDown(int numLines)
+{
+    rotateRows(scrollTop, scrollBottom, numLines * -1);
+}//scrollDown
+
+void TelnetWindow::index(void)
+{
+    if (writeY == scrollBottom)
+        scrollUp(1);
+    else if (writeY < windowHeight - 1)
+        writeY++;
+}//index
+
+void TelnetWindow::reverseIndex(void)
+{
+    if (writeY == scrollTop)
+        scrollDown(1);
+    else if (writeY > 0)
+        writeY--;
+}//reverseIndex
+
+void TelnetWindow::useAlternateBuffer(bool useAlternate,
+                                      bool clearAlternate)
+{
+    vector <DisplayRow*> *alternateWindow = &otherWindow;//the alternate screen buffer
+    NG_TRACE_SPAN("TelnetWindow::useAlternateBuffer");
+
+    if (usingAlternate)
+        alternateWindow = &theWindow;
+
+    //### Blank the alternate buffer while it's still hidden ###
+    if (clearAlternate)
+    {
+        for (unsigned int y = 0; y < alternateWindow->size(); y++)
+            clearRow(alternateWindow->at(y));
+
+        if (usingAlternate)
+            markRowsDirty(0, windowHeight);
+    }//if clearAlternate
+
+    //### Swap the buffers ###
+    if (useAlternate != usingAlternate)
     {
-        for (int i = writeY + 1; i < windowHeight; i++)
+        for (unsigned int y = 0; y < theWindow.size(); y++)
+            theWindow.at(y)->setVisible(false);
+
+        theWindow.swap(otherWindow);
+        usingAlternate = useAlternate;
+
+        for (unsigned int y = 0; y < theWindow.size(); y++)
         {
-            oneRow = theWindow.at(i - 1);
-            nextRow = theWindow.at(i);
+            theWindow.at(y)->setVisible(true);
+            setGraphicsMode(graphicsRows.at(y), y, 1);
+        }//for y
 
-            for (unsigned int j = 0; j < oneRow->size(); j++)
-            {
-                newChar = nextRow->getChar(j);
-                newAttributes = nextRow->getAttributes(j);
+        markRowsDirty(0, windowHeight);
+    }//if useAlternate
+}//useAlternateBuffer
 
-                oneRow->setChar(j, newChar, newAttributes);
-            }//for j
-        }//for i
+bool TelnetWindow::getUsingAlternateBuffer(void)
+{
+    return usingAlternate;
+}//getUsingAlternateBuffer
 
-        delCount++;
-    }//while delCount
+void TelnetWindow::setScrollRegion(uint8_t newTop,
+                                   uint8_t newBottom)
+{
+    uint8_t topRow = 0;//the new top of the scrolling region
+    uint8_t bottomRow = windowHeight - 1;//the new bottom of the scrolling region
 
-    //### Clear the last line ###
-    oneRow = theWindow.at(windowHeight - 1);
-    for (unsigned int i = 0; i < oneRow->size(); i++)
-        oneRow->setChar(i, ' ', &writeAttribute);
+    if (newTop > 0)
+        topRow = newTop - 1;
 
-    displayChanged = true;
-}//deleteLines
+    if ((newBottom > 0) && (newBottom <= windowHeight))
+        bottomRow = newBottom - 1;
+
+    //### The region must be at least two rows high, otherwise it's ignored ###
+    if (topRow < bottomRow)
+    {
+        scrollTop = topRow;
+        scrollBottom = bottomRow;
+
+        writeX = 0;
+        writeY = 0;
+    }//if topRow
+    else
+        cout << "TelnetWindow::setScrollRegion(): invalid region " << static_cast<int>(newTop)
+             << " to " << static_cast<int>(newBottom) << endl;
+}//setScrollRegion
+
+void TelnetWindow::rotateRows(uint8_t topRow,
+                              uint8_t bottomRow,
+                              int numLines)
+{
+    vector <DisplayRow*>::iterator firstRow;//the top of the rows to rotate
+    vector <DisplayRow*>::iterator lastRow;//one past the bottom of the rows to rotate
+    int regionHeight = bottomRow - topRow + 1;//the number of rows to rotate
+    int historyLines = NGSettings::getHistoryLines();
+    NG_TRACE_SPAN("TelnetWindow::rotateRows");
+
+    if ((numLines != 0) && (topRow <= bottomRow) && (bottomRow < windowHeight))
+    {
+        //### Moving by the whole region just blanks it ###
+        if (numLines > regionHeight)
+            numLines = regionHeight;
+        else if (numLines < regionHeight * -1)
+            numLines = regionHeight * -1;
+
+        //### Rotate the row pointers, rows moved off one end are exposed at the other ###
+        firstRow = theWindow.begin() + topRow;
+        lastRow = theWindow.begin() + bottomRow + 1;
+
+        if ((numLines > 0) && (numLines < regionHeight))
+            rotate(firstRow, firstRow + numLines, lastRow);
+        else if ((numLines < 0) && (numLines * -1 < regionHeight))
+            rotate(firstRow, lastRow + numLines, lastRow);
+
+        //### Move the rows to their new place in the scene ###
+        for (unsigned int y = topRow; y <= bottomRow; y++)
+        {
+            theWindow.at(y)->setRow(y + historyLines);
+            setGraphicsMode(graphicsRows.at(y), y, 1);
+        }//for y
+
+        //### Blank the exposed rows ###
+        if (numLines > 0)
+        {
+            for (unsigned int y = bottomRow - numLines + 1; y <= bottomRow; y++)
+                clearRow(theWindow.at(y));
+        }//if numLines
+        else
+        {
+            for (unsigned int y = topRow; y < static_cast<unsigned int>(topRow - numLines); y++)
+                clearRow(theWindow.at(y));
+        }//else numLines
+
+        markRowsDirty(topRow, regionHeight);
+    }//if numLines && topRow && bottomRow
+}//rotateRows
+
+void TelnetWindow::clearRow(DisplayRow *oneRow)
+{
+    for (unsigned int xPos = 0; xPos < windowWidth; xPos++)
+        oneRow->setChar(xPos, ' ', &writeAttribute, NetSprite::NO_TILE);
+}//clearRow
 
 void TelnetWindow::deleteCharacters(int numDelete)
 {
@@ -467,18 +788,18 @@ void TelnetWindow::deleteCharacters(int numDelete)
         for (int i = writeX + 1; i < windowWidth; i++)
         {
             if (i < windowWidth - 1)
-                oneRow->setChar(i, oneRow->getChar(i + 1), &writeAttribute);
+                oneRow->setChar(i, oneRow->getChar(i + 1), &writeAttribute, oneRow->getServerTile(i + 1));
             else
-                oneRow->setChar(i, ' ', &writeAttribute);
+                oneRow->setChar(i, ' ', &writeAttribute, NetSprite::NO_TILE);
         }//for i
 
         if (writeX < windowWidth - 1)
-            oneRow->setChar(writeX + 1, ' ', &writeAttribute);
+            oneRow->setChar(writeX + 1, ' ', &writeAttribute, NetSprite::NO_TILE);
 
         delCount++;
     }//while index && delCount
 
-    displayChanged = true;
+    markCellsDirty(writeY, writeX, windowWidth - 1);
 }//deleteCharacters
 
 void TelnetWindow::setDefaultAttribute(void)
@@ -0,0 +1,474 @@
+/*Copyright 2009-2013 David McCallum
+
+This file is part of EbonHack.
+
+    EbonHack is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    EbonHack is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with EbonHack.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TileCache.hpp"
+#include "ImageLoader.hpp"
+#include "NGSettings.hpp"
+#include "ConfigWriter.hpp"
+#include "NGTrace.hpp"
+#include <QPainter>
+#include <QFontDatabase>
+#include <QGraphicsScene>
+#include <QtConcurrent/QtConcurrentMap>
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+const double TileCache::ZOOM_TOLERANCE = 0.001;
+
+QImage NGTileScaler::operator()(const QImage &tile) const
+{
+    return tile.scaled(tileSize, Qt::IgnoreAspectRatio, filter);
+}//operator()
+
+QImage NGGlyphRenderer::operator()(int glyphKey) const
+{
+    uint8_t telnetChar = static_cast<uint8_t>(glyphKey & 0xFF);
+    NGS_Attribute color = static_cast<NGS_Attribute>(glyphKey >> 8);
+
+    return TileCache::renderGlyph(telnetChar, color, font, fontOffset, baseSize, zoom);
+}//operator()
+
+TileCache::TileCache(void)
+{
+    baseLevel.zoom = 1;
+    baseLevel.bytes = 0;
+    currentLevel = &baseLevel;
+    pendingLevel = NULL;
+    theScene = NULL;
+    imageLoader = NULL;
+    currentZoom = 1;
+    pixmapsCreated = 0;
+    threadedFonts = QFontDatabase::supportsThreadedFontRendering();
+
+    loadConfig();
+
+    connect(&tileWatcher, SIGNAL(finished()),
+            this, SLOT(scalingFinished()));
+    connect(&glyphWatcher, SIGNAL(finished()),
+            this, SLOT(scalingFinished()));
+
+    ConfigWriter::addWatcher(this);
+}//constructor
+
+TileCache::~TileCache(void)
+{
+    ConfigWriter::removeWatcher(this);
+    cancelScaling();
+
+    for (unsigned int i = 0; i < levels.size(); i++)
+        delete levels[i];
+    levels.clear();
+
+    currentLevel = NULL;
+    theScene = NULL;
+}//destructor
+
+void TileCache::loadConfig(void)
+{
+    string filterName = ConfigWriter::loadString("game_config.txt", "Zoom Filter");
+    int cacheSize = ConfigWriter::loadInt("game_config.txt", "Zoom Cache Size");
+
+    if (filterName == "NEAREST")
+        filter = Qt::FastTransformation;
+    else
+        filter = Qt::SmoothTransformation;
+
+    maxBytes = static_cast<qint64>(cacheSize) * 1024 * 1024;
+}//loadConfig
+
+void TileCache::setZoom(double newZoom,
+                        ImageLoader *theLoader)
+{
+    NG_TRACE_SPAN("TileCache::setZoom");
+    NGCacheLevel *oldLevel = currentLevel;//the level we were drawing with
+    NGCacheLevel *reusedLevel = NULL;//a level already scaled for newZoom
+    QPixmap *baseTile = NULL;//an unscaled tile from theLoader
+    QList <QImage> baseTiles;//copies of the unscaled tiles for the thread pool
+    NGTileScaler tileScaler;//scales the tiles on the thread pool
+    NGGlyphRenderer glyphRenderer;//draws the characters on the thread pool
+    unsigned int numTiles = 0;//number of tiles to scale
+    unsigned int numGlyphs = 0;//number of characters to draw
+    qint64 levelBytes = 0;//estimated memory for the new level
+    unsigned int levelIndex = 0;//index of reusedLevel in levels
+    QSize baseSize(NGSettings::getSpriteWidth(), NGSettings::getSpriteHeight());//unscaled tile size
+    QSize tileSize;//size of a tile at the new zoom
+
+    currentZoom = newZoom;
+    imageLoader = theLoader;
+    cancelScaling();
+
+    //### At normal size the unscaled tiles are drawn as they are ###
+    if (fabs(newZoom - 1) < ZOOM_TOLERANCE)
+        currentLevel = &baseLevel;
+    else
+    {
+        //### Look for a level we've already scaled ###
+        for (unsigned int i = 0; (i < levels.size()) && (reusedLevel == NULL); i++)
+        {
+            if (fabs(levels[i]->zoom - newZoom) < ZOOM_TOLERANCE)
+            {
+                reusedLevel = levels[i];
+                levelIndex = i;
+            }//if zoom
+        }//for i
+
+        //### Move it to the front of the list ###
+        if (reusedLevel != NULL)
+        {
+            levels.erase(levels.begin() + levelIndex);
+            levels.insert(levels.begin(), reusedLevel);
+            currentLevel = reusedLevel;
+        }//if reusedLevel
+
+        else
+        {
+            tileSize.setWidth(static_cast<int>(ceil(baseSize.width() * newZoom)));
+            tileSize.setHeight(static_cast<int>(ceil(baseSize.height() * newZoom)));
+
+            if (theLoader != NULL)
+                numTiles = theLoader->numImages();
+            numGlyphs = (LAST_PRINTABLE - FIRST_PRINTABLE + 1) * (NGSA_WHITE + 1);
+            levelBytes = (numTiles + numGlyphs) * pixmapBytes(tileSize);
+
+            //### Draw unscaled until the new level is ready ###
+            currentLevel = &baseLevel;
+
+            //### Too big for the cache, let the view scale while it draws ###
+            if (levelBytes > maxBytes)
+                cout << "TileCache::setZoom(): the zoom cache is too small for " << newZoom
+                     << "x zoom, tiles will be scaled as they're drawn" << endl;
+
+            //### Scale the tiles and characters in the background ###
+            else
+            {
+                pendingLevel = new NGCacheLevel;
+                pendingLevel->zoom = newZoom;
+                pendingLevel->tileSize = tileSize;
+                pendingLevel->bytes = 0;
+
+                for (unsigned int i = 0; i < numTiles; i++)
+                {
+                    baseTile = theLoader->getImage(i);
+                    if (baseTile != NULL)
+                    {
+                        baseTiles.push_back(baseTile->toImage());
+                        tileKeys.push_back(baseTile->cacheKey());
+                    }//if baseTile
+                }//for i
+
+                for (int color = NGSA_BLACK; color <= NGSA_WHITE; color++)
+                {
+                    for (int telnetChar = FIRST_PRINTABLE; telnetChar <= LAST_PRINTABLE; telnetChar++)
+                        glyphKeys.push_back(getGlyphKey(telnetChar, static_cast<NGS_Attribute>(color)));
+                }//for color
+
+                tileScaler.tileSize = tileSize;
+                tileScaler.filter = filter;
+
+                glyphRenderer.font = *NGSettings::getTelnetFont();
+                glyphRenderer.fontOffset = NGSettings::getFontOffset();
+                glyphRenderer.baseSize = baseSize;
+                glyphRenderer.zoom = newZoom;
+
+                tileWatcher.setFuture(QtConcurrent::mapped(baseTiles, tileScaler));
+
+                //### Text can only be drawn on the GUI thread on some platforms ###
+                if (threadedFonts)
+                    glyphWatcher.setFuture(QtConcurrent::mapped(glyphKeys, glyphRenderer));
+                else
+                {
+                    for (int i = 0; i < glyphKeys.size(); i++)
+                        drawnGlyphs.push_back(glyphRenderer(glyphKeys[i]));
+                }//else threadedFonts
+            }//else levelBytes
+        }//else reusedLevel
+    }//else newZoom
+
+    //### Repaint with the new tiles ###
+    if ((currentLevel != oldLevel) && (theScene != NULL))
+        theScene->update();
+}//setZoom
+
+void TileCache::reset(ImageLoader *theLoader)
+{
+    cancelScaling();
+
+    for (unsigned int i = 0; i < levels.size(); i++)
+        delete levels[i];
+    levels.clear();
+
+    baseLevel.tiles.clear();
+    baseLevel.glyphs.clear();
+    baseLevel.bytes = 0;
+    currentLevel = &baseLevel;
+
+    loadConfig();
+    setZoom(currentZoom, theLoader);
+}//reset
+
+void TileCache::setGraphicsScene(QGraphicsScene *newScene)
+{
+    theScene = newScene;
+}//setGraphicsScene
+
+bool TileCache::getScaled(void)
+{
+    return (currentLevel != &baseLevel);
+}//getScaled
+
+QPixmap* TileCache::getTile(QPixmap *baseTile)
+{
+    QPixmap *result = baseTile;//the tile to draw
+    QHash <qint64, QPixmap>::iterator found;//the scaled tile
+    NGTileScaler tileScaler;//scales tiles that weren't in the batch
+
+    if ((currentLevel != &baseLevel) && (baseTile != NULL))
+    {
+        found = currentLevel->tiles.find(baseTile->cacheKey());
+
+        //### Scale tiles loaded after the batch was started ###
+        if (found == currentLevel->tiles.end())
+        {
+            tileScaler.tileSize = currentLevel->tileSize;
+            tileScaler.filter = filter;
+
+            found = currentLevel->tiles.insert(baseTile->cacheKey(),
+                                               QPixmap::fromImage(tileScaler(baseTile->toImage())));
+            currentLevel->bytes += pixmapBytes(currentLevel->tileSize);
+            pixmapsCreated++;
+        }//if found
+
+        result = &found.value();
+    }//if currentLevel && baseTile
+
+    return result;
+}//getTile
+
+QPixmap* TileCache::getGlyph(uint8_t telnetChar,
+                             NGS_Attribute color)
+{
+    int glyphKey = getGlyphKey(telnetChar, color);
+    QHash <int, QPixmap>::iterator found = currentLevel->glyphs.find(glyphKey);
+    QSize baseSize(NGSettings::getSpriteWidth(), NGSettings::getSpriteHeight());//unscaled character size
+    QImage oneGlyph;//a character drawn on the GUI thread
+
+    //### Draw characters that weren't in the batch ###
+    if (found == currentLevel->glyphs.end())
+    {
+        oneGlyph = renderGlyph(telnetChar, color, *NGSettings::getTelnetFont(),
+                               NGSettings::getFontOffset(), baseSize, currentLevel->zoom);
+
+        found = currentLevel->glyphs.insert(glyphKey, QPixmap::fromImage(oneGlyph, Qt::ColorOnly));
+        currentLevel->bytes += pixmapBytes(oneGlyph.size());
+        pixmapsCreated++;
+    }//if found
+
+    return &found.value();
+}//getGlyph
+
+void TileCache::waitForScaling(void)
+{
+    tileWatcher.waitForFinished();
+    glyphWatcher.waitForFinished();
+
+    scalingFinished();
+}//waitForScaling
+
+unsigned int TileCache::getPixmapsCreated(void)
+{
+    return pixmapsCreated;
+}//getPixmapsCreated
+
+void TileCache::configChanged(const string &fileName,
+                              const string &configID)
+{
+    if (fileName == "game_config.txt")
+    {
+        //### Drop levels until we fit in the new size ###
+        if (configID == "Zoom Cache Size")
+        {
+            loadConfig();
+            trimLevels();
+        }//if configID
+
+        //### The scaled levels used the old filter ###
+        else if (configID == "Zoom Filter")
+            reset(imageLoader);
+    }//if fileName
+}//configChanged
+
+int TileCache::getGlyphKey(uint8_t telnetChar,
+                           NGS_Attribute color)
+{
+    return (static_cast<int>(color) << 8) | telnetChar;
+}//getGlyphKey
+
+QImage TileCache::renderGlyph(uint8_t telnetChar,
+                              NGS_Attribute color,
+                              const QFont &theFont,
+                              int fontOffset,
+                              QSize baseSize,
+                              double zoom)
+{
+    QSize glyphSize(static_cast<int>(ceil(baseSize.width() * zoom)),
+                    static_cast<int>(ceil(baseSize.height() * zoom)));
+    QImage charBuffer(glyphSize, QImage::Format_ARGB32);
+    QPainter painter;//performs the drawing
+    QRectF charRect(0, 0, baseSize.width(), baseSize.height());//the bounding rectangle for the character
+    QString convertedChar;//the QString version of telnetChar
+    string converter;//converts telnetChar to a QString
+
+    //### Color the char buffer black ###
+    charBuffer.fill(qRgb(0, 0, 0));
+
+    //### Extract the telnet character ###
+    converter.push_back(telnetChar);
+    convertedChar = QString(converter.c_str());
+
+    //### Draw at the zoomed size, so the font is scaled instead of the pixels ###
+    painter.begin(&charBuffer);
+    painter.scale(zoom, zoom);
+
+    //### Set the font color ###
+    switch (color)
+    {
+        case NGSA_BLACK: painter.setPen(Qt::black);
+            break;
+
+        case NGSA_RED: painter.setPen(Qt::red);
+            break;
+
+        case NGSA_GREEN: painter.setPen(Qt::green);
+            break;
+
+        case NGSA_YELLOW: painter.setPen(Qt::yellow);
+            break;
+
+        case NGSA_BLUE: painter.setPen(Qt::blue);
+            break;
+
+        case NGSA_MAGENTA: painter.setPen(Qt::magenta);
+            break;
+
+        case NGSA_CYAN: painter.setPen(Qt::cyan);
+            break;
+
+        case NGSA_WHITE: painter.setPen(Qt::white);
+            break;
+
+        default:
+            cout << "TileCache::renderGlyph(): unknown charColor" << endl;
+            throw 1;
+    }//switch color
+
+    //### Set the character's bounding box ###
+    charRect.setY(charRect.y() + fontOffset);
+
+    //### Draw the character ###
+    painter.setFont(theFont);
+    painter.drawText(charRect, Qt::AlignCenter, convertedChar);
+    painter.end();
+
+    return charBuffer;
+}//renderGlyph
+
+void TileCache::scalingFinished(void)
+{
+    bool glyphsReady = true;//true if the characters are finished, or were drawn on the GUI thread
+    NG_TRACE_SPAN("TileCache::scalingFinished");
+
+    if (threadedFonts)
+        glyphsReady = ((glyphWatcher.isFinished()) && (!glyphWatcher.isCanceled()));
+
+    //### Wait for both halves, and ignore batches that were cancelled ###
+    if ((pendingLevel != NULL) && (tileWatcher.isFinished()) && (!tileWatcher.isCanceled())
+        && (glyphsReady))
+    {
+        //### Convert the results to pixmaps, which must be done on the GUI thread ###
+        for (unsigned int i = 0; i < tileKeys.size(); i++)
+        {
+            pendingLevel->tiles.insert(tileKeys[i], QPixmap::fromImage(tileWatcher.resultAt(i)));
+            pendingLevel->bytes += pixmapBytes(pendingLevel->tileSize);
+            pixmapsCreated++;
+        }//for i
+
+        for (int i = 0; i < glyphKeys.size(); i++)
+        {
+            if (threadedFonts)
+                pendingLevel->glyphs.insert(glyphKeys[i], QPixmap::fromImage(glyphWatcher.resultAt(i), Qt::ColorOnly));
+            else
+                pendingLevel->glyphs.insert(glyphKeys[i], QPixmap::fromImage(drawnGlyphs[i], Qt::ColorOnly));
+            pendingLevel->bytes += pixmapBytes(pendingLevel->tileSize);
+            pixmapsCreated++;
+        }//for i
+
+        tileWatcher.setFuture(QFuture<QImage>());
+        glyphWatcher.setFuture(QFuture<QImage>());
+        tileKeys.clear();
+        glyphKeys.clear();
+        drawnGlyphs.clear();
+
+        //### Start drawing with the new level ###
+        levels.insert(levels.begin(), pendingLevel);
+        currentLevel = pendingLevel;
+        pendingLevel = NULL;
+
+        trimLevels();
+
+        if (theScene != NULL)
+            theScene->update();
+    }//if pendingLevel && isFinished()
+}//scalingFinished
+
+void TileCache::cancelScaling(void)
+{
+    tileWatcher.cancel();
+    glyphWatcher.cancel();
+    tileWatcher.waitForFinished();
+    glyphWatcher.waitForFinished();
+
+    tileKeys.clear();
+    glyphKeys.clear();
+    drawnGlyphs.clear();
+
+    delete pendingLevel;
+    pendingLevel = NULL;
+}//cancelScaling
+
+void TileCache::trimLevels(void)
+{
+    qint64 totalBytes = 0;//memory used by every level
+
+    for (unsigned int i = 0; i < levels.size(); i++)
+        totalBytes += levels[i]->bytes;
+
+    //### Never drop the level we're drawing with ###
+    while ((totalBytes > maxBytes) && (!levels.empty()) && (levels.back() != currentLevel))
+    {
+        totalBytes -= levels.back()->bytes;
+        delete levels.back();
+        levels.pop_back();
+    }//while totalBytes
+}//trimLevels
+
+qint64 TileCache::pixmapBytes(QSize theSize)
+{
+    return static_cast<qint64>(theSize.width()) * theSize.height() * 4;
+}//pixmapBytes
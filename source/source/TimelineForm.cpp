@@ -0,0 +1,109 @@
+/*Copyright 2009-2013 David McCallum
+
+This file is part of EbonHack.
+
+    EbonHack is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    EbonHack is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with EbonHack.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TimelineForm.hpp"
+#include "WhiteBoard.hpp"
+#include "TelnetProtocol.hpp"
+
+using namespace std;
+
+TimelineForm::TimelineForm(QWidget* parent,
+                           Qt::WindowFlags flags,
+                           WhiteBoard *newWhiteBoard) : QDialog(parent, flags)
+{
+    QFont screenFont("Courier");//the screen is laid out in columns
+
+    whiteBoard = newWhiteBoard;
+
+    gui.setupUi(this);
+
+    screenFont.setStyleHint(QFont::TypeWriter);
+    gui.screenText->setFont(screenFont);
+
+    connect(gui.frameSlider, SIGNAL(valueChanged(int)),
+            this, SLOT(frameChosen(int)));
+    connect(gui.latestButton, SIGNAL(clicked(bool)),
+            this, SLOT(latestClicked()));
+    connect(gui.closeButton, SIGNAL(clicked(bool)),
+            this, SLOT(closeClicked()));
+}//constructor
+
+TimelineForm::~TimelineForm(void)
+{
+}//destructor
+
+void TimelineForm::showTimeline(void)
+{
+    latestClicked();
+    show();
+}//showTimeline
+
+void TimelineForm::latestClicked(void)
+{
+    ScreenTimeline &timeline = whiteBoard->getTelnetPro()->getTelnetWindow()->getTimeline();
+
+    //### Cover the frames kept now, and jump to the newest ###
+    if (timeline.getNumFrames() > 0)
+    {
+        gui.frameSlider->setEnabled(true);
+        gui.frameSlider->setRange(timeline.getFirstFrame(), timeline.getLastFrame());
+        gui.frameSlider->setValue(timeline.getLastFrame());
+        frameChosen(timeline.getLastFrame());
+    }//if getNumFrames()
+    else
+    {
+        gui.frameSlider->setEnabled(false);
+        gui.screenText->clear();
+
+        if (timeline.getEnabled())
+            gui.frameLabel->setText("No frames recorded");
+        else
+            gui.frameLabel->setText("The timeline is turned off, see \"Timeline Size\" in game_config.txt");
+    }//else getNumFrames()
+}//latestClicked
+
+void TimelineForm::frameChosen(int frameNumber)
+{
+    ScreenTimeline &timeline = whiteBoard->getTelnetPro()->getTelnetWindow()->getTimeline();
+    QString screenText;//every row of the screen
+    double secondsAgo = 0;//how long before now the frame was recorded
+
+    if (timeline.getScreen(frameNumber, theScreen))
+    {
+        for (uint8_t y = 0; y < theScreen.height; y++)
+        {
+            screenText += QString::fromLatin1(ScreenTimeline::getRowText(theScreen, y).c_str());
+            screenText += "\n";
+        }//for y
+
+        secondsAgo = static_cast<double>(timeline.getCurrentTime() - theScreen.time) / 1000;
+        gui.screenText->setPlainText(screenText);
+        gui.frameLabel->setText(QString("Frame %1, %2 seconds ago, cursor at %3,%4")
+                                .arg(frameNumber).arg(secondsAgo, 0, 'f', 1)
+                                .arg(theScreen.cursorX + 1).arg(theScreen.cursorY + 1));
+    }//if getScreen()
+
+    //### The frame was dropped since the form was shown ###
+    else
+        gui.frameLabel->setText(QString("Frame %1 is no longer kept, click Latest").arg(frameNumber));
+}//frameChosen
+
+void TimelineForm::closeClicked(void)
+{
+    hide();
+}//closeClicked
@@ -25,6 +25,10 @@ This file is part of EbonHack.
 #include "TelnetProtocol.hpp"
 #include "NetSprite.hpp"
 #include "MessageForm.hpp"
+#include "NotificationQueue.hpp"
+#include "NGTrace.hpp"
+#include "RenderBenchmark.hpp"
+#include "FrameExporter.hpp"
 
 using namespace std;
 
@@ -33,6 +37,7 @@ QRegExp WhiteBoard::regExpRule;
 WhiteBoard::WhiteBoard(QApplication *newQtApp,
                        bool debugMode)
 {
+    uptimeTimer.start();
     qtApp = newQtApp;
 
     //Null the objects in case the constructor from one relies on another,
@@ -41,9 +46,12 @@ WhiteBoard::WhiteBoard(QApplication *newQtApp,
     mainWindow = NULL;
     messageForm = NULL;
     netFX = NULL;
+    notifications = NULL;
 
     ConfigWriter::setPath(NGSettings::DATA_PATH);
 
+    notifications = new NotificationQueue(this);
+
     telnetPro = new TelnetProtocol(this, debugMode);
     mainWindow = new MainWindow(NULL, NULL, this);
     messageForm = new MessageForm(NULL, Qt::WindowStaysOnTopHint);
@@ -64,6 +72,13 @@ WhiteBoard::~WhiteBoard(void)
     netFX->save();
     delete netFX;//must come after mainWindow is deleted
     netFX = NULL;
+
+    delete notifications;//must come after anything that posts to it
+    notifications = NULL;
+
+    #ifdef NG_TRACE
+        NGTrace::dumpChromeTrace(NGTrace::DEFAULT_FILE);
+    #endif
 }//destructor
 
 int WhiteBoard::run(void)
@@ -79,6 +94,39 @@ int WhiteBoard::run(void)
     return result;
 }//run
 
+bool WhiteBoard::benchmarkRender(void)
+{
+    bool result = true;//false on errors
+
+    if (!mainWindow->start())
+        result = false;
+
+    if (result)
+        result = RenderBenchmark::run(this, NGSettings::DATA_PATH + TelnetProtocol::SESSION_FILE);
+
+    return result;
+}//benchmarkRender
+
+bool WhiteBoard::exportFrames(const QString &target,
+                              bool toPipe)
+{
+    string sessionFile = NGSettings::DATA_PATH + TelnetProtocol::SESSION_FILE;//the recorded session
+    bool result = true;//false on errors
+
+    if (!mainWindow->start())
+        result = false;
+
+    if (result)
+    {
+        if (toPipe)
+            result = FrameExporter::exportPipe(this, sessionFile, target);
+        else
+            result = FrameExporter::exportPNG(this, sessionFile, target);
+    }//if result
+
+    return result;
+}//exportFrames
+
 NethackFX* WhiteBoard::getNetFX(void)
 {
     return netFX;
@@ -104,6 +152,16 @@ MessageForm* WhiteBoard::getMessageForm(void)
     return messageForm;
 }//getMessageForm
 
+NotificationQueue* WhiteBoard::getNotifications(void)
+{
+    return notifications;
+}//getNotifications
+
+qint64 WhiteBoard::getUptime(void)
+{
+    return uptimeTimer.elapsed();
+}//getUptime
+
 void WhiteBoard::showMessage(const QString &theMessage)
 {
     messageForm->showMessage(theMessage);
@@ -20,9 +20,16 @@ This file is part of EbonHack.
 #include "WhiteBoard.hpp"
 #include "GraphicsSettings.hpp"
 #include "MainWindow.hpp"
+#include "TelnetProtocol.hpp"
+#include <QApplication>
 
 using namespace std;
 
+uint8_t XtermEscape::transitions[NGXS_NUM_STATES][256];
+uint8_t XtermEscape::entryActions[NGXS_NUM_STATES];
+uint8_t XtermEscape::exitActions[NGXS_NUM_STATES];
+bool XtermEscape::tablesBuilt = false;
+
 XtermEscape::XtermEscape(TelnetWindow *newWindow,
                          WhiteBoard *newWhiteBoard,
                          bool newDebug)
@@ -31,22 +38,26 @@ XtermEscape::XtermEscape(TelnetWindow *newWindow,
     whiteBoard = newWhiteBoard;
     debugMessages = newDebug;
 
+    //### The tables are shared by every parser ###
+    if (!tablesBuilt)
+        buildTables();
+
+    //### Allocate the OSC buffer once, it's reused for every OSC command ###
+    oscString.reserve(MAX_OSC_LENGTH);
+
     resetFSM();
 }//constructor
 
 XtermEscape::~XtermEscape(void)
 {
-    resetParameters();
 }//destructor
 
 void XtermEscape::resetFSM(void)
 {
     resetParameters();
 
-    myState = NGXS_START;
-    topScrolling = 0;
-    bottomScrolling = 0;
-    alternateBuffer = false;
+    myState = NGXS_GROUND;
+    parseError = false;
     savedCursorX = 1;
     savedCursorY = 1;
     useTileNumber = false;
@@ -54,277 +65,370 @@ void XtermEscape::resetFSM(void)
     showedWindowMsg = false;
 }//resetFSM
 
-NGX_State XtermEscape::run(uint8_t currentByte)
+void XtermEscape::buildTables(void)
 {
-    switch (myState)
+    NGX_State state = NGXS_GROUND;//the state we're filling in
+
+    for (int i = 0; i < NGXS_NUM_STATES; i++)
     {
-        case NGXS_START:
-            resetParameters();
-            runStart(currentByte);
-            break;
+        state = static_cast<NGX_State>(i);
 
-        case NGXS_ERROR:
-            myState = NGXS_START;
-            resetParameters();
-            runStart(currentByte);
-            break;
+        //### By default, bytes are ignored without leaving the state ###
+        setTransitions(state, 0x00, 0xFF, NGXA_IGNORE, NGXS_NUM_STATES);
+        entryActions[state] = NGXA_NONE;
+        exitActions[state] = NGXA_NONE;
 
-        case NGXS_G0_CHAR_SET: runG0CharSet(currentByte);
-            break;
+        //### C0 controls are executed, even in the middle of a sequence ###
+        if ((state <= NGXS_CSI_IGNORE) || (state == NGXS_DCS_PASSTHROUGH))
+        {
+            if (state == NGXS_DCS_PASSTHROUGH)
+            {
+                setTransitions(state, 0x00, 0x17, NGXA_PUT, NGXS_NUM_STATES);
+                setTransitions(state, 0x19, 0x19, NGXA_PUT, NGXS_NUM_STATES);
+                setTransitions(state, 0x1C, 0x1F, NGXA_PUT, NGXS_NUM_STATES);
+            }//if state
 
-        case NGXS_G1_CHAR_SET: runG1CharSet(currentByte);
-            break;
+            else
+            {
+                setTransitions(state, 0x00, 0x17, NGXA_EXECUTE, NGXS_NUM_STATES);
+                setTransitions(state, 0x19, 0x19, NGXA_EXECUTE, NGXS_NUM_STATES);
+                setTransitions(state, 0x1C, 0x1F, NGXA_EXECUTE, NGXS_NUM_STATES);
+            }//else state
+        }//if state
+    }//for i
 
-        case NGXS_CSI: runCSI(currentByte);
-            break;
+    //### Ground, bytes from 0x80 up are nethack's IBM graphics, not C1 controls ###
+    setTransitions(NGXS_GROUND, 0x20, 0xFF, NGXA_PRINT, NGXS_NUM_STATES);
+
+    //### ESC ###
+    setTransitions(NGXS_ESCAPE, 0x20, 0x2F, NGXA_COLLECT, NGXS_ESCAPE_INTERMEDIATE);
+    setTransitions(NGXS_ESCAPE, 0x30, 0x7E, NGXA_ESC_DISPATCH, NGXS_GROUND);
+    setTransitions(NGXS_ESCAPE, 'P', 'P', NGXA_NONE, NGXS_DCS_ENTRY);
+    setTransitions(NGXS_ESCAPE, 'X', 'X', NGXA_NONE, NGXS_SOS_PM_APC_STRING);
+    setTransitions(NGXS_ESCAPE, '[', '[', NGXA_NONE, NGXS_CSI_ENTRY);
+    setTransitions(NGXS_ESCAPE, ']', ']', NGXA_NONE, NGXS_OSC_STRING);
+    setTransitions(NGXS_ESCAPE, '^', '_', NGXA_NONE, NGXS_SOS_PM_APC_STRING);
+    entryActions[NGXS_ESCAPE] = NGXA_CLEAR;
+
+    setTransitions(NGXS_ESCAPE_INTERMEDIATE, 0x20, 0x2F, NGXA_COLLECT, NGXS_NUM_STATES);
+    setTransitions(NGXS_ESCAPE_INTERMEDIATE, 0x30, 0x7E, NGXA_ESC_DISPATCH, NGXS_GROUND);
+
+    //### ESC [ ###
+    setTransitions(NGXS_CSI_ENTRY, 0x20, 0x2F, NGXA_COLLECT, NGXS_CSI_INTERMEDIATE);
+    setTransitions(NGXS_CSI_ENTRY, 0x30, 0x39, NGXA_PARAM, NGXS_CSI_PARAM);
+    setTransitions(NGXS_CSI_ENTRY, ':', ':', NGXA_NONE, NGXS_CSI_IGNORE);
+    setTransitions(NGXS_CSI_ENTRY, ';', ';', NGXA_PARAM, NGXS_CSI_PARAM);
+    setTransitions(NGXS_CSI_ENTRY, 0x3C, 0x3F, NGXA_COLLECT, NGXS_CSI_PARAM);
+    setTransitions(NGXS_CSI_ENTRY, 0x40, 0x7E, NGXA_CSI_DISPATCH, NGXS_GROUND);
+    entryActions[NGXS_CSI_ENTRY] = NGXA_CLEAR;
+
+    setTransitions(NGXS_CSI_PARAM, 0x20, 0x2F, NGXA_COLLECT, NGXS_CSI_INTERMEDIATE);
+    setTransitions(NGXS_CSI_PARAM, 0x30, 0x39, NGXA_PARAM, NGXS_NUM_STATES);
+    setTransitions(NGXS_CSI_PARAM, ':', ':', NGXA_NONE, NGXS_CSI_IGNORE);
+    setTransitions(NGXS_CSI_PARAM, ';', ';', NGXA_PARAM, NGXS_NUM_STATES);
+    setTransitions(NGXS_CSI_PARAM, 0x3C, 0x3F, NGXA_NONE, NGXS_CSI_IGNORE);
+    setTransitions(NGXS_CSI_PARAM, 0x40, 0x7E, NGXA_CSI_DISPATCH, NGXS_GROUND);
+
+    setTransitions(NGXS_CSI_INTERMEDIATE, 0x20, 0x2F, NGXA_COLLECT, NGXS_NUM_STATES);
+    setTransitions(NGXS_CSI_INTERMEDIATE, 0x30, 0x3F, NGXA_NONE, NGXS_CSI_IGNORE);
+    setTransitions(NGXS_CSI_INTERMEDIATE, 0x40, 0x7E, NGXA_CSI_DISPATCH, NGXS_GROUND);
+
+    setTransitions(NGXS_CSI_IGNORE, 0x40, 0x7E, NGXA_NONE, NGXS_GROUND);
+
+    //### ESC P, device control strings are parsed but not used ###
+    setTransitions(NGXS_DCS_ENTRY, 0x20, 0x2F, NGXA_COLLECT, NGXS_DCS_INTERMEDIATE);
+    setTransitions(NGXS_DCS_ENTRY, 0x30, 0x39, NGXA_PARAM, NGXS_DCS_PARAM);
+    setTransitions(NGXS_DCS_ENTRY, ':', ':', NGXA_NONE, NGXS_DCS_IGNORE);
+    setTransitions(NGXS_DCS_ENTRY, ';', ';', NGXA_PARAM, NGXS_DCS_PARAM);
+    setTransitions(NGXS_DCS_ENTRY, 0x3C, 0x3F, NGXA_COLLECT, NGXS_DCS_PARAM);
+    setTransitions(NGXS_DCS_ENTRY, 0x40, 0x7E, NGXA_NONE, NGXS_DCS_PASSTHROUGH);
+    entryActions[NGXS_DCS_ENTRY] = NGXA_CLEAR;
+
+    setTransitions(NGXS_DCS_PARAM, 0x20, 0x2F, NGXA_COLLECT, NGXS_DCS_INTERMEDIATE);
+    setTransitions(NGXS_DCS_PARAM, 0x30, 0x39, NGXA_PARAM, NGXS_NUM_STATES);
+    setTransitions(NGXS_DCS_PARAM, ':', ':', NGXA_NONE, NGXS_DCS_IGNORE);
+    setTransitions(NGXS_DCS_PARAM, ';', ';', NGXA_PARAM, NGXS_NUM_STATES);
+    setTransitions(NGXS_DCS_PARAM, 0x3C, 0x3F, NGXA_NONE, NGXS_DCS_IGNORE);
+    setTransitions(NGXS_DCS_PARAM, 0x40, 0x7E, NGXA_NONE, NGXS_DCS_PASSTHROUGH);
+
+    setTransitions(NGXS_DCS_INTERMEDIATE, 0x20, 0x2F, NGXA_COLLECT, NGXS_NUM_STATES);
+    setTransitions(NGXS_DCS_INTERMEDIATE, 0x30, 0x3F, NGXA_NONE, NGXS_DCS_IGNORE);
+    setTransitions(NGXS_DCS_INTERMEDIATE, 0x40, 0x7E, NGXA_NONE, NGXS_DCS_PASSTHROUGH);
+
+    setTransitions(NGXS_DCS_PASSTHROUGH, 0x20, 0x7E, NGXA_PUT, NGXS_NUM_STATES);
+    entryActions[NGXS_DCS_PASSTHROUGH] = NGXA_HOOK;
+    exitActions[NGXS_DCS_PASSTHROUGH] = NGXA_UNHOOK;
+
+    //### ESC ], xterm ends these with BEL as well as ESC \ ###
+    setTransitions(NGXS_OSC_STRING, 0x20, 0xFF, NGXA_OSC_PUT, NGXS_NUM_STATES);
+    setTransitions(NGXS_OSC_STRING, NGTC_BELL, NGTC_BELL, NGXA_NONE, NGXS_GROUND);
+    entryActions[NGXS_OSC_STRING] = NGXA_OSC_START;
+    exitActions[NGXS_OSC_STRING] = NGXA_OSC_END;
+
+    //### CAN and SUB cancel a sequence, ESC starts a new one, from any state ###
+    for (int i = 0; i < NGXS_NUM_STATES; i++)
+    {
+        state = static_cast<NGX_State>(i);
+
+        setTransitions(state, 0x18, 0x18, NGXA_EXECUTE, NGXS_GROUND);
+        setTransitions(state, 0x1A, 0x1A, NGXA_EXECUTE, NGXS_GROUND);
+        setTransitions(state, NGTC_ESC, NGTC_ESC, NGXA_NONE, NGXS_ESCAPE);
+    }//for i
 
-        case NGXS_CSI_DEC: runCSIDEC(currentByte);
-            break;
+    tablesBuilt = true;
+}//buildTables
 
-        case NGXS_CSI_PARAM: runCSIParam(currentByte);
-            break;
+void XtermEscape::setTransitions(NGX_State state,
+                                 uint8_t firstByte,
+                                 uint8_t lastByte,
+                                 NGX_Action action,
+                                 NGX_State nextState)
+{
+    for (int i = firstByte; i <= lastByte; i++)
+        transitions[state][i] = (action << 4) | nextState;
+}//setTransitions
 
-        case NGXS_OSC: runOSC(currentByte);
-            break;
+bool XtermEscape::run(uint8_t currentByte)
+{
+    uint8_t transition = transitions[myState][currentByte];//the packed action and next state
+    NGX_Action action = static_cast<NGX_Action>(transition >> 4);//what to do with currentByte
+    NGX_State nextState = static_cast<NGX_State>(transition & 0x0F);//where to go next
 
-        case NGXS_OSC_PARAM: runOSCParam(currentByte);
-            break;
+    parseError = false;
 
-        default:
-            cout << " XtermEscape::run(): encountered an unknown state!" << endl;
-            myState = NGXS_ERROR;
-            break;
-    }//switch myState
+    //### NGXS_NUM_STATES means stay in the current state ###
+    if (nextState == NGXS_NUM_STATES)
+        doAction(action, currentByte);
+
+    //### Otherwise leave the current state, then enter the next one ###
+    else
+    {
+        doAction(static_cast<NGX_Action>(exitActions[myState]), currentByte);
+        doAction(action, currentByte);
+
+        myState = nextState;
+        doAction(static_cast<NGX_Action>(entryActions[myState]), currentByte);
+    }//else nextState
 
-    return myState;
+    return !parseError;
 }//run
 
-//<ESC>
-void XtermEscape::runStart(uint8_t currentByte)
+void XtermEscape::doAction(NGX_Action action,
+                           uint8_t currentByte)
 {
-    switch (currentByte)
+    switch (action)
     {
-        //G0 Character Set
-        case '(': myState = NGXS_G0_CHAR_SET;
+        case NGXA_NONE:
+        case NGXA_IGNORE:
             break;
 
-        //G1 Character Set
-        case ')': myState = NGXS_G1_CHAR_SET;
+        case NGXA_PRINT: theWindow->writeByte(currentByte);
             break;
 
-        //Control Sequence Introducer
-        case '[': myState = NGXS_CSI;
+        case NGXA_EXECUTE: execute(currentByte);
             break;
 
-        //Operating system command
-        case ']':
-            parameters.push_back(new QByteArray);
-            myState = NGXS_OSC;
+        case NGXA_CLEAR:
+        case NGXA_OSC_START:
+            resetParameters();
             break;
 
-        //Save Cursor
-        case '7':
-            if (debugMessages)
-                cout << " Xterm Save Cursor" << endl;
-            savedCursorX = theWindow->getCursorX();
-            savedCursorY = theWindow->getCursorY();
-            myState = NGXS_START;
+        case NGXA_COLLECT:
+            if (numIntermediates < MAX_INTERMEDIATES)
+            {
+                intermediates[numIntermediates] = currentByte;
+                numIntermediates++;
+            }//if numIntermediates
+            else
+                ignoreSequence = true;
             break;
 
-        //Restore Cursor
-        case '8':
-            if (debugMessages)
-                cout << " Xterm Restore Cursor" << endl;
-            theWindow->setCursorX(savedCursorX);
-            theWindow->setCursorY(savedCursorY);
-            myState = NGXS_START;
+        case NGXA_PARAM:
+            if (currentByte == ';')
+                separateParameter();
+            else
+                addParameterDigit(currentByte);
             break;
 
-        //Application Keypad
-        case '=':
-            cout << " XtermEscape::runStart(): Xterm Application Keypad unhandled." << endl;
-            myState = NGXS_START;
+        case NGXA_ESC_DISPATCH:
+            if (!ignoreSequence)
+                escDispatch(currentByte);
             break;
 
-        //Normal Keypad
-        case '>':
-            cout << " XtermEscape::runStart(): Xterm Normal Keypad unhandled." << endl;
-            myState = NGXS_START;
+        case NGXA_CSI_DISPATCH:
+            if (!ignoreSequence)
+                csiDispatch(currentByte);
             break;
 
-        //Reverse Index
-        //case 'M':
-            //cout << "XtermEscape::runStart(): Xterm Reverse Index unhandled." << endl;
-            //myState = NGXS_START;
-            //break;
+        case NGXA_HOOK:
+            cout << " XtermEscape::doAction(): Device Control String unhandled." << endl;
+            break;
 
-        default:
-            cout << " XtermEscape::runStart(): unknown byte: "
-                 << static_cast<int>(currentByte) << endl;
-            myState = NGXS_ERROR;
+        case NGXA_PUT:
+        case NGXA_UNHOOK:
             break;
-    }//switch currentByte
-}//runStart
 
-//ESC ]
-void XtermEscape::runOSC(uint8_t currentByte)
-{
-    //### Find the type of OSC command ###
-    if (isASCIIDigit(currentByte))
-        parameters.at(parameters.size() - 1)->push_back(currentByte);
+        case NGXA_OSC_PUT: oscPut(currentByte);
+            break;
 
-    //### Parameters are seperated by ; ###
-    else if (currentByte == ';')
-    {
-        parameters.push_back(new QByteArray);
-        myState = NGXS_OSC_PARAM;
-    }//else if currentByte
+        case NGXA_OSC_END: handleOSC();
+            break;
 
-    else
-    {
-        cout << " XtermEscape::runOSC(): unknown byte: "
-                << static_cast<int>(currentByte) << endl;
-        myState = NGXS_ERROR;
-    }//else currentByte
-}//runOSC
+        default:
+            cout << " XtermEscape::doAction(): encountered an unknown action!" << endl;
+            parseError = true;
+            break;
+    }//switch action
+}//doAction
 
-void XtermEscape::runOSCParam(uint8_t currentByte)
+void XtermEscape::execute(uint8_t currentByte)
 {
-    if (currentByte == 7)//BEL
-        handleOSC();
-
-    else if (currentByte == 27)//ESC
+    switch (currentByte)
     {
-        cout << " XtermEscape::runOSCParam(): unhandled string terminator ESC" << endl;
-        myState = NGXS_ERROR;
-    }//else if currentByte
-
-    else if (currentByte == ';')
-        parameters.push_back(new QByteArray);
+        //carriage return
+        case NGTC_CR:
+            theWindow->setCursorX(1);
+            break;
 
-    else
-        parameters.at(parameters.size() - 1)->push_back(currentByte);
-}//runOSCParam
+        //line feed, vertical tab and form feed
+        case NGTC_LF:
+        case NGTC_VT:
+        case NGTC_FF:
+            theWindow->index();
+            break;
 
-void XtermEscape::handleOSC(void)
-{
-    QByteArray *firstParam = NULL;//the first OSC parameter
-    int oscType = 0;//the type of OSC command to run
+        //backspace
+        case NGTC_BS:
+            theWindow->moveCursorX(-1);
+            break;
 
-    //### Verify that we received at least two parameters ###
-    if (parameters.size() < 2)
-    {
-        cout << " XtermEscape::handleOSC(): expected two or more parameters" << endl;
-        myState = NGXS_ERROR;
-    }//if size()
+        //horizontal tab
+        case NGTC_TAB:
+            theWindow->moveCursorX(TAB_WIDTH - theWindow->getCursorX() % TAB_WIDTH);
+            break;
 
-    //### Extract the OSC command type ###
-    if (myState != NGXS_ERROR)
-    {
-        firstParam = parameters.at(0);
-        if (!extractInt(firstParam, oscType))
-        {
-            cout << " XtermEscape::handleOSC(): expected integer as first parameter" << endl;
-            myState = NGXS_ERROR;
-        }//if !extractInt()
-    }//if myState
+        //beep
+        case NGTC_BELL:
+            QApplication::beep();
+            break;
 
-    if (myState != NGXS_ERROR)
-    {
-        switch (oscType)
-        {
-            //Change window title
-            case 2:
-                cout << " XtermEscape::handleOSC(): unhandled set window title to ";
-                for (int i = 0; i < parameters.at(1)->size(); i++)
-                    cout << parameters.at(1)->at(i);
-                cout << endl;
-                myState = NGXS_START;
+        //no operation, shift in, shift out
+        case NGTC_NOP:
+        case NGTC_SHIFT_IN:
+        case NGTC_SHIFT_OUT:
             break;
 
-            default:
-                cout << " XtermEscape::handleOSC(): unknown control " << oscType << endl;
-                myState = NGXS_ERROR;
+        default:
+            if (debugMessages)
+                cout << " XtermEscape::execute(): ignoring control "
+                     << static_cast<int>(currentByte) << endl;
             break;
-        }//switch oscType
-    }//if myState
-}//handleOSC
+    }//switch currentByte
+}//execute
 
-//<ESC> <[>   (Called CSI)
-void XtermEscape::runCSI(uint8_t currentByte)
+//<ESC> <intermediates> <finalByte>
+void XtermEscape::escDispatch(uint8_t finalByte)
 {
-    //DEC
-    if (currentByte == '?')
-        myState = NGXS_CSI_DEC;
+    //### Designate a character set ###
+    if ((numIntermediates == 1) && (intermediates[0] == '('))
+        runG0CharSet(finalByte);
 
-    //parameter
-    else if (isASCIIDigit(currentByte))
+    else if ((numIntermediates == 1) && (intermediates[0] == ')'))
+        runG1CharSet(finalByte);
+
+    else if (numIntermediates > 0)
     {
-        myState = NGXS_CSI_PARAM;
-        runCSIParam(currentByte);
-    }//else if isASCIIDigit()
+        cout << " XtermEscape::escDispatch(): unknown sequence with intermediate "
+             << intermediates[0] << " and final byte " << static_cast<int>(finalByte) << endl;
+        parseError = true;
+    }//else if numIntermediates
 
-    //Select Graphic Rendition (default)
-    else if (currentByte == 'm')
-        runSGRCharAttributes();
+    else
+    {
+        switch (finalByte)
+        {
+            //Save Cursor
+            case '7':
+                if (debugMessages)
+                    cout << " Xterm Save Cursor" << endl;
+                saveCursor();
+                break;
 
-    //Set cursor position (default is 1,1)
-    else if (currentByte == 'H')
-        setCursorPosition();
+            //Restore Cursor
+            case '8':
+                if (debugMessages)
+                    cout << " Xterm Restore Cursor" << endl;
+                restoreCursor();
+                break;
 
-    //Erase in Line
-    else if (currentByte == 'K')
-        eraseInLine();
+            //Application Keypad
+            case '=':
+                cout << " XtermEscape::escDispatch(): Xterm Application Keypad unhandled." << endl;
+                break;
 
-    //Cursor Forward
-    else if (currentByte == 'C')
-        cursorForward();
+            //Normal Keypad
+            case '>':
+                cout << " XtermEscape::escDispatch(): Xterm Normal Keypad unhandled." << endl;
+                break;
 
-    //Cursor Up
-    else if (currentByte == 'A')
-        cursorUp();
+            //Index
+            case 'D':
+                if (debugMessages)
+                    cout << " Xterm Index" << endl;
+                theWindow->index();
+                break;
 
-    //Erase in display
-    else if (currentByte == 'J')
-        eraseInDisplay();
+            //Next Line
+            case 'E':
+                if (debugMessages)
+                    cout << " Xterm Next Line" << endl;
+                theWindow->setCursorX(1);
+                theWindow->index();
+                break;
 
-    //Cursor Backward
-    else if (currentByte == 'D')
-        cursorBackward();
+            //Reverse Index
+            case 'M': reverseIndex();
+                break;
 
-    //Delete lines
-    else if (currentByte == 'M')
-        deleteLines();
+            //String Terminator, the string it ends was already handled
+            case '\\':
+                break;
 
-    //unknown
-    else
-    {
-        cout << " XtermEscape::runCSI(): unknown byte: "
-             << static_cast<int>(currentByte) << endl;
-        myState = NGXS_ERROR;
-    }//else currentByte
-}//runCSI
-
-////<ESC> <[>   (Called CSI, runCSIParam will be given an ASCII digit the first time it's called)
-void XtermEscape::runCSIParam(uint8_t currentByte)
-{
-    //### Add received digits to the current parameter ###
-    if (isASCIIDigit(currentByte))
-    {
-        if (parameters.size() == 0)
-            parameters.push_back(new QByteArray);
+            //Full Reset
+            case 'c':
+                if (debugMessages)
+                    cout << " Xterm Full Reset" << endl;
+                theWindow->setDefaultAttribute();
+                theWindow->eraseAll();
+                theWindow->setScrollRegion(0, 0);
+                break;
 
-        parameters.at(parameters.size() - 1)->push_back(currentByte);
-    }//if isASCIIDigit()
+            default:
+                cout << " XtermEscape::escDispatch(): unknown byte: "
+                     << static_cast<int>(finalByte) << endl;
+                parseError = true;
+                break;
+        }//switch finalByte
+    }//else numIntermediates
+}//escDispatch
 
-    //### Parameters are seperated by ; ###
-    else if (currentByte == ';')
-        parameters.push_back(new QByteArray);
+//<ESC> <[> <parameters> <finalByte>   (Called CSI)
+void XtermEscape::csiDispatch(uint8_t finalByte)
+{
+    //### DEC private modes ###
+    if ((numIntermediates == 1) && (intermediates[0] == '?'))
+        runCSIDEC(finalByte);
+
+    else if (numIntermediates > 0)
+    {
+        cout << " XtermEscape::csiDispatch(): unknown sequence with intermediate "
+             << intermediates[0] << " and final byte " << static_cast<int>(finalByte) << endl;
+        parseError = true;
+    }//else if numIntermediates
 
-    //### Other chars are control codes ###
     else
     {
-        switch (currentByte)
+        switch (finalByte)
         {
             //Cursor Up Ps Times (default = 1))
             case 'A': cursorUp();
@@ -334,6 +438,14 @@ void XtermEscape::runCSIParam(uint8_t currentByte)
             case 'B': cursorDown();
                 break;
 
+            //Cursor Forward Ps Times (default = 1)
+            case 'C': cursorForward();
+                break;
+
+            //Cursor Backward Ps Times (default = 1)
+            case 'D': cursorBackward();
+                break;
+
             //Line Position Absolute
             case 'd': linePosition();
                 break;
@@ -342,8 +454,10 @@ void XtermEscape::runCSIParam(uint8_t currentByte)
             case 'G': cursorCharAbsolute();
                 break;
 
-            //Cursor position
-            case 'H': cursorPosition();
+            //Cursor position, and Horizontal and Vertical Position
+            case 'H':
+            case 'f':
+                cursorPosition();
                 break;
 
             //Erase in Display
@@ -354,6 +468,10 @@ void XtermEscape::runCSIParam(uint8_t currentByte)
             case 'K': eraseInLine();
                 break;
 
+            //Insert Lines
+            case 'L': insertLines();
+                break;
+
             //Set Reset Mode
             case 'l': runCSIResetMode();
                 break;
@@ -362,6 +480,10 @@ void XtermEscape::runCSIParam(uint8_t currentByte)
             case 'm': runSGRCharAttributes();
                 break;
 
+            //Delete Lines
+            case 'M': deleteLines();
+                break;
+
             //Delete Ps Character(s)
             case 'P': deleteCharacters();
                 break;
@@ -370,6 +492,14 @@ void XtermEscape::runCSIParam(uint8_t currentByte)
             case 'r': runCSISetScrolling();
                 break;
 
+            //Scroll Up Ps Lines
+            case 'S': scrollUp();
+                break;
+
+            //Scroll Down Ps Lines
+            case 'T': scrollDown();
+                break;
+
             //Erase Ps Character(s)
             case 'X': deleteCharacters();
                 break;
@@ -379,98 +509,204 @@ void XtermEscape::runCSIParam(uint8_t currentByte)
                 break;
 
             default:
-                cout << " XtermEscape::runCSIParam(): unknown byte: "
-                     << static_cast<int>(currentByte) << endl;
-                myState = NGXS_ERROR;
+                cout << " XtermEscape::csiDispatch(): unknown byte: "
+                     << static_cast<int>(finalByte) << endl;
+                parseError = true;
                 break;
-        }//switch currentByte
-    }//else isASCIIDigit
-}//runCSIParam
+        }//switch finalByte
+    }//else numIntermediates
+}//csiDispatch
+
+//<ESC> <]>
+void XtermEscape::oscPut(uint8_t currentByte)
+{
+    //### The command type comes first, up to the ; ###
+    if (!oscGotType)
+    {
+        if ((currentByte >= '0') && (currentByte <= '9'))
+            addParameterDigit(currentByte);
+
+        else if (currentByte == ';')
+        {
+            if (numParameters == 0)
+                startParameter();
+            oscGotType = true;
+        }//else if currentByte
+
+        //handleOSC() will report the missing type
+        else
+        {
+            numParameters = 0;
+            oscGotType = true;
+        }//else currentByte
+    }//if !oscGotType
+
+    //### Anything past MAX_OSC_LENGTH is dropped, so the buffer never grows ###
+    else if (oscString.size() < static_cast<unsigned int>(MAX_OSC_LENGTH))
+        oscString.push_back(currentByte);
+}//oscPut
+
+void XtermEscape::handleOSC(void)
+{
+    int oscType = 0;//the type of OSC command to run
+
+    //### Verify that we received the command type ###
+    if (numParameters != 1)
+    {
+        cout << " XtermEscape::handleOSC(): expected an integer command type" << endl;
+        parseError = true;
+    }//if numParameters
+
+    if (!parseError)
+    {
+        oscType = parameters[0];
+
+        switch (oscType)
+        {
+            //Change window title
+            case 2:
+                cout << " XtermEscape::handleOSC(): unhandled set window title to "
+                     << oscString << endl;
+            break;
+
+            default:
+                cout << " XtermEscape::handleOSC(): unknown control " << oscType << endl;
+                parseError = true;
+            break;
+        }//switch oscType
+    }//if parseError
+}//handleOSC
 
 void XtermEscape::cursorUp(void)
 {
     int numPlaces = getCursorMoveDist();//the number of places to move the cursor
 
-    if (myState != NGXS_ERROR)
+    if (!parseError)
     {
         if (debugMessages)
             cout << " Xterm Cursor Up: " << numPlaces << endl;
 
         theWindow->moveCursorY(numPlaces * -1);
-        myState = NGXS_START;
-    }//if myState
+    }//if parseError
 }//cursorUp
 
 void XtermEscape::cursorDown(void)
 {
     int numPlaces = getCursorMoveDist();//the number of places to move the cursor
 
-    if (myState != NGXS_ERROR)
+    if (!parseError)
     {
         if (debugMessages)
             cout << " Xterm Cursor Down: " << numPlaces << endl;
 
         theWindow->moveCursorY(numPlaces);
-        myState = NGXS_START;
-    }//if myState
+    }//if parseError
 }//cursorDown
 
 void XtermEscape::cursorForward(void)
 {
     int numPlaces = getCursorMoveDist();//the number of places to move the cursor
 
-    if (myState != NGXS_ERROR)
+    if (!parseError)
     {
         if (debugMessages)
             cout << " Xterm Cursor Forward: " << numPlaces << endl;
 
         theWindow->moveCursorX(numPlaces);
-        myState = NGXS_START;
-    }//if myState
+    }//if parseError
 }//cursorForward
 
 void XtermEscape::cursorBackward(void)
 {
     int numPlaces = getCursorMoveDist();//the number of places to move the cursor
 
-    if (myState != NGXS_ERROR)
+    if (!parseError)
     {
         if (debugMessages)
             cout << " Xterm Cursor Backward: " << numPlaces << endl;
 
         theWindow->moveCursorX(numPlaces * -1);
-        myState = NGXS_START;
-    }//if myState
+    }//if parseError
 }//cursorBackward
 
+void XtermEscape::reverseIndex(void)
+{
+    if (debugMessages)
+        cout << " Xterm Reverse Index" << endl;
+
+    theWindow->reverseIndex();
+}//reverseIndex
+
+void XtermEscape::insertLines(void)
+{
+    int numInsert = getCursorMoveDist();//the number of lines to insert
+
+    if (!parseError)
+    {
+        if (debugMessages)
+            cout << " Xterm Insert Lines: " << numInsert << endl;
+
+        theWindow->insertLines(numInsert);
+    }//if parseError
+}//insertLines
+
+void XtermEscape::scrollUp(void)
+{
+    int numLines = getCursorMoveDist();//the number of lines to scroll
+
+    if (!parseError)
+    {
+        if (debugMessages)
+            cout << " Xterm Scroll Up: " << numLines << endl;
+
+        theWindow->scrollUp(numLines);
+    }//if parseError
+}//scrollUp
+
+void XtermEscape::scrollDown(void)
+{
+    int numLines = getCursorMoveDist();//the number of lines to scroll
+
+    if (!parseError)
+    {
+        if (debugMessages)
+            cout << " Xterm Scroll Down: " << numLines << endl;
+
+        theWindow->scrollDown(numLines);
+    }//if parseError
+}//scrollDown
+
+void XtermEscape::saveCursor(void)
+{
+    //### The window counts from 0, but setCursorX() and setCursorY() count from 1 ###
+    savedCursorX = theWindow->getCursorX() + 1;
+    savedCursorY = theWindow->getCursorY() + 1;
+}//saveCursor
+
+void XtermEscape::restoreCursor(void)
+{
+    theWindow->setCursorX(savedCursorX);
+    theWindow->setCursorY(savedCursorY);
+}//restoreCursor
+
 int XtermEscape::getCursorMoveDist(void)
 {
-    QByteArray *oneParameter = NULL;//a single parameter from the list
     int result = 0;//the number of spaces to move
 
     //### No parameters means move one position ###
-    if (parameters.size() == 0)
+    if (numParameters == 0)
         result = 1;
 
     //### The movement distance is given in a parameter ###
-    else if (parameters.size() == 1)
-    {
-        oneParameter = parameters.at(0);
-
-        if (!extractInt(oneParameter, result))
-        {
-            cout << " XtermEscape::getCursorMoveDist(): couldn't convert "
-                 << arrayToStr(oneParameter) << " to an integer" << endl;
-            myState = NGXS_ERROR;
-        }//if !extractInt
-    }//else if size()
+    else if (numParameters == 1)
+        result = parameters[0];
 
     //### Invalid number of parameters ###
     else
     {
         cout << "XtermEscape::getCursorMoveDist(): expected either 0 or 1 parameters" << endl;
-        myState = NGXS_ERROR;
-    }//else size()
+        parseError = true;
+    }//else numParameters
 
     return result;
 }//getCursorMoveDist
@@ -479,30 +715,20 @@ void XtermEscape::setNethackTile(void)
 {
     MainWindow *mainWindow = whiteBoard->getMainWindow();
     GraphicsSettings *graphicsSettings = mainWindow->getGraphicsSettings();
-    QByteArray *oneParameter = NULL;//a single parameter from the list
     int commandType = 0;//the type of Nethack tile command to execute
     bool serverTilesEnabled = graphicsSettings->serverTilesEnabled();
 
     //### We should have at least one parameter ###
-    if (parameters.size() == 0)
+    if (numParameters == 0)
     {
         cout << " XtermEscape::setNethackTile(): expected a parameter!" << endl;
-        myState = NGXS_ERROR;
-    }//if size()
+        parseError = true;
+    }//if numParameters
 
     else
     {
         //extract the type of command
-        oneParameter = parameters.at(0);
-        if (!extractInt(oneParameter, commandType))
-        {
-            cout << " XtermEscape::setNethackTile(): couldn't convert "
-                 << arrayToStr(oneParameter) << " to an integer" << endl;
-            myState = NGXS_ERROR;
-        }//if !extractInt()
-
-        //We'll return to the starting state if we don't encounter an error
-        myState = NGXS_START;
+        commandType = parameters[0];
 
         //Run the specified command type
         if (serverTilesEnabled)
@@ -532,640 +758,419 @@ void XtermEscape::setNethackTile(void)
             else
             {
                 cout << "XtermEscape::setNethackTile(): invalid command type " << commandType << endl;
-                myState = NGXS_ERROR;
+                parseError = true;
             }//else commandType
         }//if serverTilesEnabled
         else
             useTileNumber = false;
-    }//else size()
+    }//else numParameters
 }//setNethackTile
 
 void XtermEscape::startGlyph(void)
 {
-    QByteArray *oneParameter = NULL;//a single parameter from the list
-
     //### Verify that a tile number was given ###
-    if (parameters.size() != 2)
+    if (numParameters != 2)
     {
         cout << "XtermEscape::startGlyph(): expected a tile number" << endl;
-        myState = NGXS_ERROR;
-    }//if size()
-
-    //### Extract the tile number ###
-    if (myState != NGXS_ERROR)
-    {
-        oneParameter = parameters.at(1);
-        if (!extractInt(oneParameter, tileNumber))
-        {
-            cout << " XtermEscape::startGlyph(): couldn't convert "
-                 << arrayToStr(oneParameter) << " to an integer" << endl;
-            myState = NGXS_ERROR;
-        }//if !extractInt()
-    }//if myState
+        parseError = true;
+    }//if numParameters
 
     //### Use the glyph ###
-    if (myState != NGXS_ERROR)
+    if (!parseError)
     {
+        tileNumber = parameters[1];
+
         if (debugMessages)
             cout << " Xterm Start Glyph: " << tileNumber << endl;
 
         useTileNumber = true;
-    }//if myState
+    }//if parseError
 }//startGlyph
 
 void XtermEscape::endGlyph(void)
 {
     //### Verify that no parameter was given ###
-    if (parameters.size() != 1)
+    if (numParameters != 1)
     {
         cout << "XtermEscape::endGlyph(): got an unexpected parameter" << endl;
-        myState = NGXS_ERROR;
-    }//if size()
+        parseError = true;
+    }//if numParameters
 
     useTileNumber = false;
 }//endGlyph
 
 void XtermEscape::deleteLines(void)
 {
-    QByteArray *oneParameter = NULL;//a single parameter from the list
     int numDelete = 0;//the number of lines to delete
 
     //### No parameters means delete 1 line ###
-    if (parameters.size() == 0)
+    if (numParameters == 0)
     {
         if (debugMessages)
             cout << " Xterm Delete Lines: 1" << endl;
         theWindow->deleteLines(1);
-        myState = NGXS_START;
-    }//if size()
+    }//if numParameters
 
-    //### Delete the specified number of characters ###
-    else if (parameters.size() == 1)
+    //### Delete the specified number of lines ###
+    else if (numParameters == 1)
     {
-        //extract the number of chars to delete
-        oneParameter = parameters.at(0);
-        if (!extractInt(oneParameter, numDelete))
-        {
-            cout << " XtermEscape::deleteLines(): couldn't convert "
-                 << arrayToStr(oneParameter) << " to an integer" << endl;
-            myState = NGXS_ERROR;
-        }//if !extractInt()
+        numDelete = parameters[0];
 
-        //perform the deletion
-        if (myState != NGXS_ERROR)
-        {
-            if (debugMessages)
-                cout << " Xterm Delete Lines: " << numDelete << endl;
-            theWindow->deleteLines(numDelete);
-            myState = NGXS_START;
-        }//if myState
-    }//else if size()
+        if (debugMessages)
+            cout << " Xterm Delete Lines: " << numDelete << endl;
+        theWindow->deleteLines(numDelete);
+    }//else if numParameters
 
     //### Invalid number of parameters ###
     else
     {
         cout << " XtermEscape::deleteLines(): expected 0 or 1 parameters" << endl;
-        myState = NGXS_ERROR;
-    }//else size()
+        parseError = true;
+    }//else numParameters
 }//deleteLines
 
 void XtermEscape::deleteCharacters(void)
 {
-    QByteArray *oneParameter = NULL;//a single parameter from the list
     int numDelete = 0;//the number of characters to delete
 
     //### No parameters means delete 1 char ###
-    if (parameters.size() == 0)
+    if (numParameters == 0)
     {
         if (debugMessages)
             cout << " Xterm Delete Characters: 1" << endl;
         theWindow->deleteCharacters(1);
-        myState = NGXS_START;
-    }//if size()
+    }//if numParameters
 
     //### Delete the specified number of characters ###
-    else if (parameters.size() == 1)
+    else if (numParameters == 1)
     {
-        //extract the number of chars to delete
-        oneParameter = parameters.at(0);
-        if (!extractInt(oneParameter, numDelete))
-        {
-            cout << " XtermEscape::deleteCharacters(): couldn't convert "
-                 << arrayToStr(oneParameter) << " to an integer" << endl;
-            myState = NGXS_ERROR;
-        }//if !extractInt()
+        numDelete = parameters[0];
 
-        //perform the deletion
-        if (myState != NGXS_ERROR)
-        {
-            if (debugMessages)
-                cout << " Xterm Delete Characters: " << numDelete << endl;
-            theWindow->deleteCharacters(numDelete);
-            myState = NGXS_START;
-        }//if myState
-    }//else if size()
+        if (debugMessages)
+            cout << " Xterm Delete Characters: " << numDelete << endl;
+        theWindow->deleteCharacters(numDelete);
+    }//else if numParameters
 
     //### Invalid number of parameters ###
     else
     {
         cout << " XtermEscape::deleteCharacters(): expected 0 or 1 parameters" << endl;
-        myState = NGXS_ERROR;
-    }//else size()
+        parseError = true;
+    }//else numParameters
 }//deleteCharacters
 
 void XtermEscape::cursorCharAbsolute(void)
 {
-    QByteArray *oneParameter = NULL;//a single parameter from the list
     int column = 0;//the column to move to
 
     //### No parameters means move to column 1 ###
-    if (parameters.size() == 0)
+    if (numParameters == 0)
     {
         if (debugMessages)
             cout << " Xterm Cursor Character Absolute 1" << endl;
         theWindow->setCursorX(1);
-        myState = NGXS_START;
-    }//if size()
+    }//if numParameters
 
     //### Move the cursor to the specified column ###
-    else if (parameters.size() == 1)
+    else if (numParameters == 1)
     {
-        //extract the column number
-        oneParameter = parameters.at(0);
-        if (!extractInt(oneParameter, column))
-        {
-            cout << " XtermEscape::cursorCharAbsolute(): couldn't convert "
-                 << arrayToStr(oneParameter) << " to an integer" << endl;
-            myState = NGXS_ERROR;
-        }//if !intToStr()
+        column = parameters[0];
 
-        //move to that location
-        if (myState != NGXS_ERROR)
-        {
-            if (debugMessages)
-                cout << " Xterm Cursor Character Absolute " << column << endl;
-            theWindow->setCursorX(column);
-            myState = NGXS_START;
-        }//if myState
-    }//else if size()
+        if (debugMessages)
+            cout << " Xterm Cursor Character Absolute " << column << endl;
+        theWindow->setCursorX(column);
+    }//else if numParameters
 
     //### Invalid number of parameters ###
     else
     {
         cout << " XtermEscape::cursorCharAbsolute(): expected either 0 or 1 parameters" << endl;
-        myState = NGXS_ERROR;
-    }//else size()
+        parseError = true;
+    }//else numParameters
 }//cursorCharAbsolute
 
 void XtermEscape::cursorPosition(void)
 {
-    QByteArray *oneParameter = NULL;//a single parameter from the list
-    int row = 0;//the row position to move to
-    int column = 0;//the column position to move to
+    int row = 1;//the row position to move to
+    int column = 1;//the column position to move to
 
-    //### No parameters means move to 1,1 ###
-    if (parameters.size() == 0)
+    //### No parameters means move to 1,1, a missing column means column 1 ###
+    if (numParameters > 2)
     {
-        if (debugMessages)
-            cout << " Xterm Cursor Position 1,1" << endl;
+        cout << " XtermEscape::cursorPosition(): expected at most 2 parameters" << endl;
+        parseError = true;
+    }//if numParameters
 
-        theWindow->setCursorX(1);
-        theWindow->setCursorY(1);
-        myState = NGXS_START;
-    }//if size()
-
-    //### Move to the specified location ###
-    else if (parameters.size() == 2)
+    else
     {
-        //extract the row
-        oneParameter = parameters.at(0);
-        if (!extractInt(oneParameter, row))
-        {
-            cout << " XtermEscape::cursorPosition(): couldn't convert "
-                 << arrayToStr(oneParameter) << " to an integer" << endl;
-            myState = NGXS_ERROR;
-        }//if !intToStr()
-
-        //extract the column
-        oneParameter = parameters.at(1);
-        if (myState != NGXS_ERROR)
-        {
-            if (!extractInt(oneParameter, column))
-            {
-                cout << " XtermEscape::cursorPosition(): couldn't convert "
-                     << arrayToStr(oneParameter) << " to an integer" << endl;
-                myState = NGXS_ERROR;
-            }//if !intToStr()
-        }//if myState
-
-        //apply the change
-        if (myState != NGXS_ERROR)
-        {
-            if (debugMessages)
-                cout << " Xterm Cursor Position " << column << "," << row << endl;
+        if (numParameters >= 1)
+            row = parameters[0];
+        if (numParameters == 2)
+            column = parameters[1];
 
-            theWindow->setCursorX(column);
-            theWindow->setCursorY(row);
-            myState = NGXS_START;
-        }//if myState
-    }//else if size()
+        if (debugMessages)
+            cout << " Xterm Cursor Position " << column << "," << row << endl;
 
-    //### Invalid number of parameters ###
-    else
-    {
-        cout << " XtermEscape::cursorPosition(): expected either 0 or 2 parameters" << endl;
-        myState = NGXS_ERROR;
-    }//else size()
+        theWindow->setCursorX(column);
+        theWindow->setCursorY(row);
+    }//else numParameters
 }//cursorPosition
 
 void XtermEscape::eraseInLine(void)
 {
-    QByteArray *oneParameter = NULL;//a single parameter to examine
-
     //### No parameters means Erase to Right ###
-    if (parameters.size() == 0)
+    if (numParameters == 0)
     {
         if (debugMessages)
             cout << " Xterm Erase In Line: Erase To Right" << endl;
         theWindow->eraseToRight();
-        myState = NGXS_START;
-    }//if size()
+    }//if numParameters
 
-    else if (parameters.size() == 1)
+    else if (numParameters == 1)
     {
-        oneParameter = parameters.at(0);
-
         //### Erase to Right ###
-        if (arrayToStr(oneParameter) == "0")
+        if (parameters[0] == 0)
         {
             if (debugMessages)
                 cout << " Xterm Erase In Line: Erase To Right" << endl;
             theWindow->eraseToRight();
-            myState = NGXS_START;
-        }//if getAsString
+        }//if parameters
 
         else
         {
-            cout << "XtermEscape::eraseInLine(): unknown parameter" << arrayToStr(oneParameter) << endl;
-            myState = NGXS_ERROR;
-        }//else getAsString();
-    }//else if size()
+            cout << "XtermEscape::eraseInLine(): unknown parameter" << parameters[0] << endl;
+            parseError = true;
+        }//else parameters
+    }//else if numParameters
 
     //### Only one parameter allowed ###
     else
     {
         cout << " XtermEscape::eraseInLine(): expecting at most one parameter." << endl;
-        myState = NGXS_ERROR;
-    }//else size()
+        parseError = true;
+    }//else numParameters
 }//eraseInLine
 
 void XtermEscape::linePosition(void)
 {
-    QByteArray *oneParameter = NULL;//a single parameter to examine
     int row = 0;//the line position to move to
 
     //### Verify that we have at least one parameter ###
-    if (parameters.size() == 0)
+    if (numParameters == 0)
     {
         cout << " XtermEscape::linePosition(): no parameters given!" << endl;
-        myState = NGXS_ERROR;
-    }//if size()
+        parseError = true;
+    }//if numParameters
 
     //### One parameter means row is given ###
-    else if (parameters.size() == 1)
+    else if (numParameters == 1)
     {
-        //### Extract the row position ###
-        oneParameter = parameters.at(0);
-        if (!extractInt(oneParameter, row))
-        {
-            cout << " XtermEscape::linePosition(): couldn't convert "
-                 << arrayToStr(oneParameter) << " to an integer" << endl;
-            myState = NGXS_ERROR;
-        }//if !strToInt()
+        row = parameters[0];
 
-        //### Move to that location ###
-        if (myState != NGXS_ERROR)
-        {
-            if (debugMessages)
-                cout << " Xterm Line Position Absolute " << row << endl;
-            theWindow->setCursorY(row);
-            myState = NGXS_START;
-        }//if myState
-    }//else if size()
+        if (debugMessages)
+            cout << " Xterm Line Position Absolute " << row << endl;
+        theWindow->setCursorY(row);
+    }//else if numParameters
 
     //### Can have multiple parameters!? ###
     else
     {
         cout << " XtermEscape::linePosition(): expecting at most two parameters." << endl;
-        myState = NGXS_ERROR;
-    }//else size()
+        parseError = true;
+    }//else numParameters
 }//linePosition
 
 void XtermEscape::eraseInDisplay(void)
 {
-    QByteArray *oneParameter = NULL;//a single parameter from the list
-
     //### No parameters means erase below ###
-    if (parameters.size() == 0)
+    if (numParameters == 0)
     {
         if (debugMessages)
             cout << " Xterm Erase In Display: Erase Below" << endl;
         theWindow->eraseBelow();
-        myState = NGXS_START;
-    }//if size()
+    }//if numParameters
 
     //### One parameter indicates an erasure type ###
-    else if (parameters.size() == 1)
+    else if (numParameters == 1)
     {
-        oneParameter = parameters.at(0);
-
         //### Erase Below ###
-        if (arrayToStr(oneParameter) == "0")
+        if (parameters[0] == 0)
         {
             if (debugMessages)
                 cout << " Xterm Erase In Display: Erase Below" << endl;
             theWindow->eraseBelow();
-            myState = NGXS_START;
-        }//if getAsString()
+        }//if parameters
 
         //### Erase All ###
-        else if (arrayToStr(oneParameter) == "2")
+        else if (parameters[0] == 2)
         {
             if (debugMessages)
                 cout << " Xterm Erase In Display: Erase All" << endl;
 
-
             theWindow->eraseAll();
-            myState = NGXS_START;
-        }//if getAsString()
+        }//if parameters
 
         //### Unknown! ###
         else
         {
             cout << " XtermEscape::eraseInDisplay(): unknown parameter "
-                << arrayToStr(oneParameter) << endl;
-            myState = NGXS_ERROR;
-        }//else getAsString()
-    }//else size()
+                << parameters[0] << endl;
+            parseError = true;
+        }//else parameters
+    }//else numParameters
 
     //### Can have at most one parameter ###
     else
     {
         cout << " XtermEscape::eraseInDisplay(): expected at most 1 parameter" << endl;
-        myState = NGXS_ERROR;
-    }//else size()
+        parseError = true;
+    }//else numParameters
 }//eraseInDisplay
 
-void XtermEscape::setCursorPosition(void)
-{
-    //### No parameters means move to 1,1 ###
-    if (parameters.size() == 0)
-    {
-        if (debugMessages)
-            cout << " Xterm cursor position 1,1" << endl;
-
-        theWindow->setCursorX(1);
-        theWindow->setCursorY(1);
-        myState = NGXS_START;
-    }//if size()
-
-    else
-    {
-        cout << " XtermEscape::setCursorPosition(): no handler for parameters!" << endl;
-        myState = NGXS_ERROR;
-    }//else size()
-}//setCursorPosition
-
 void XtermEscape::runCSIResetMode(void)
 {
-    QByteArray *param1 = NULL;//the first parameter
-
     //### Verify that we got either 1 or 2 parameters ###
-    if ((parameters.size() < 1) || (parameters.size() > 2))
+    if ((numParameters < 1) || (numParameters > 2))
     {
         cout << " XtermEscape::runCSIResetMode(): expected either 1 or 2 parameters" << endl;
-        myState = NGXS_ERROR;
-    }//if size() || size()
+        parseError = true;
+    }//if numParameters || numParameters
 
     //### We only handle the one-parameter version so far ###
-    if (myState != NGXS_ERROR)
+    if (!parseError)
     {
-        if (parameters.size() != 1)
+        if (numParameters != 1)
         {
             cout << " XtermEscape::runCSIResetMode(): no handler for 2 parameters!" << endl;
-            myState = NGXS_ERROR;
-        }//if size()
-    }//if myState
-
-    //### Verify that the parameter is 1 byte long ###
-    if (myState != NGXS_ERROR)
-    {
-        param1 = parameters.at(0);
-
-        if (param1->size() != 1)
-        {
-            cout << " XtermEscape::runCSIResetMode(): expected a 1-byte parameter" << endl;
-            myState = NGXS_ERROR;
-        }//if size()
-    }//if myState
+            parseError = true;
+        }//if numParameters
+    }//if parseError
 
-    if (myState != NGXS_ERROR)
+    if (!parseError)
     {
         //Keyboard Action Mode (AM)
-        if (param1->at(0) == '2')
+        if (parameters[0] == 2)
         {
             cout << " XtermEscape::runCSIResetMode(): Reset Mode Keyboard Action Mode (AM) unhandled." << endl;
-            myState = NGXS_START;
-        }//if param1
+        }//if parameters
 
         //Replace Mode (IRM)
-        else if (param1->at(0) == '4')
+        else if (parameters[0] == 4)
         {
             cout << " XtermEscape::runCSIResetMode(): Reset Mode Keyboard Replace Mode (IRM) unhandled." << endl;
-            myState = NGXS_START;
-        }//else if param1
+        }//else if parameters
 
         //Unknown
         else
         {
-            cout << " XtermEscape::runCSIResetMode(): Mode " << param1->at(0) << " unhandled." << endl;
-            myState = NGXS_ERROR;
-        }//else param1
-    }//if myState
+            cout << " XtermEscape::runCSIResetMode(): Mode " << parameters[0] << " unhandled." << endl;
+            parseError = true;
+        }//else parameters
+    }//if parseError
 }//runCSIResetMode
 
 void XtermEscape::runSGRCharAttributes(void)
 {
-    QByteArray *oneParameter = NULL;//the current parameter to examine
-    unsigned int currentParam = 0;//index of the current parameter
-    int intVersion = 0;//the integer version of the current parameter
+    int currentParam = 0;//index of the current parameter
 
     //### No parameter means use default mode ###
-    if (parameters.size() == 0)
+    if (numParameters == 0)
     {
         if (debugMessages)
             cout << " Xterm SGR Character Attributes Default" << endl;
         theWindow->setDefaultAttribute();
-        myState = NGXS_START;
-    }//if size()
+    }//if numParameters
 
     //### Apply the specified modes ###
     else
     {
-        while ((currentParam < parameters.size()) && (myState != NGXS_ERROR))
+        while ((currentParam < numParameters) && (!parseError))
         {
-            //### Extract the current parameter ###
-            oneParameter = parameters.at(currentParam);
-            if (!extractInt(oneParameter, intVersion))
-            {
-                cout << " XtermEscape::runSGRCharAttributes(): couldn't convert "
-                     << arrayToStr(oneParameter) << " to an int" << endl;
-                myState = NGXS_ERROR;
-            }//if !strToInt()
-
             //### Run the sub-FSM for char attributes ###
-            if (myState != NGXS_ERROR)
+            if (!SGRAttribute::acceptAttribute(parameters[currentParam], theWindow, debugMessages))
             {
-                if (!SGRAttribute::acceptAttribute(intVersion, theWindow, debugMessages))
-                {
-                    cout << " XtermEscape::runSGRCharAttributes(): unknown attribute!" << endl;
-                    myState = NGXS_ERROR;
-                }//if !acceptAttribute()
-            }//if myState
+                cout << " XtermEscape::runSGRCharAttributes(): unknown attribute!" << endl;
+                parseError = true;
+            }//if !acceptAttribute()
 
             currentParam++;
-        }//while currentParam && myState
-
-        if (myState != NGXS_ERROR)
-            myState = NGXS_START;
-    }//else size()
+        }//while currentParam && parseError
+    }//else numParameters
 }//runSGRCharAttributes
 
 void XtermEscape::runCSISetScrolling(void)
 {
-    QByteArray *oneParameter = NULL;//the current parameter to examine
+    //### No parameters means the whole window ###
+    if (numParameters == 0)
+    {
+        startParameter();
+        startParameter();
+    }//if numParameters
 
     //### Verify that we obtained two parameters ###
-    if (parameters.size() != 2)
+    if (numParameters != 2)
     {
         cout << " Xterm Set Scrolling Region: expected two parameters" << endl;
-        myState = NGXS_ERROR;
-    }//if size()
+        parseError = true;
+    }//if numParameters
 
-    //### Extract the first parameter ###
-    if (myState != NGXS_ERROR)
-    {
-        oneParameter = parameters.at(0);
-        if (!extractInt(oneParameter, topScrolling))
-        {
-            cout << " Xterm Set Scrolling Region: couldn't convert "
-                 << arrayToStr(oneParameter) << " to an int" << endl;
-            myState = NGXS_ERROR;
-        }//if !strToInt()
-    }//if myState
-
-    //### Extract the second parameter ###
-    if (myState != NGXS_ERROR)
+    //### Apply the region, rows past the bottom of the window mean the bottom ###
+    if (!parseError)
     {
-        oneParameter = parameters.at(1);
-        if (!extractInt(oneParameter, bottomScrolling))
+        if (debugMessages)
+            cout << " Xterm Set Scrolling Region top: " << parameters[0]
+                 << " bottom: " << parameters[1] << endl;
+
+        for (int i = 0; i < 2; i++)
         {
-            cout << " Xterm Set Scrolling Region: couldn't convert "
-                 << arrayToStr(oneParameter) << " to an int" << endl;
-            myState = NGXS_ERROR;
-        }//if !strToInt()
-    }//if myState
-
-    //### Output the received message ###
-    if (myState != NGXS_ERROR)
-    {
-        cout << " XtermEscape::runCSISetScrolling(): Set scrolling region top: " << topScrolling
-             << " bottom: " << bottomScrolling << " unhandled." << endl;
-        myState = NGXS_START;
-    }//if myState
+            if (parameters[i] > 255)
+                parameters[i] = 0;
+        }//for i
+
+        theWindow->setScrollRegion(parameters[0], parameters[1]);
+    }//if parseError
 }//runCSISetScrolling
 
-//<ESC> <[> <?>    (Called CSI DEC)
-void XtermEscape::runCSIDEC(uint8_t currentByte)
+//<ESC> <[> <?> <parameters> <finalByte>    (Called CSI DEC)
+void XtermEscape::runCSIDEC(uint8_t finalByte)
 {
-    QByteArray *oneParameter = NULL;//a single parameter from the parameters deque
-    unsigned int paramIndex = 0;//index of the parameter to consider
-    int decSet = 0;//indicates the feature to set
+    int paramIndex = 0;//index of the parameter to consider
 
-    //### Add received digits to the current parameter ###
-    if (isASCIIDigit(currentByte))
+    switch (finalByte)
     {
-        if (parameters.size() == 0)
-            parameters.push_back(new QByteArray);
-
-        parameters.at(parameters.size() - 1)->push_back(currentByte);
-    }//if isASCIIDigit
-
-    //### Parameters are seperated by ; ###
-    else if (currentByte == ';')
-        parameters.push_back(new QByteArray);
+        //DEC Private Mode Reset
+        case 'l':
+            if (numParameters == 0)
+                cout << " XtermEscape::runCSIDEC(): DEC Private Mode Reset unhandled." << endl;
 
-    //### Other characters are control codes ###
-    else
-    {
-        switch (currentByte)
-        {
-            //Reset Mode
-            case 'l':
-                while ((paramIndex < parameters.size()) && (myState != NGXS_ERROR))
-                {
-                    oneParameter = parameters.at(paramIndex);
-                    if (extractInt(oneParameter, decSet))
-                        runDECPMReset(decSet);
-                    else
-                    {
-                        cout << " XtermEscape::runCSIDEC(): Couldn't convert "
-                             << arrayToStr(oneParameter) << " to int" << endl;
-                        myState = NGXS_ERROR;
-                    }//else strToInt()
-
-                    paramIndex++;
-                }//while paramIndex && myState
-
-                if ((myState != NGXS_START) && (myState != NGXS_ERROR))
-                {
+            while ((paramIndex < numParameters) && (!parseError))
+            {
+                runDECPMReset(parameters[paramIndex]);
+                paramIndex++;
+            }//while paramIndex && parseError
+            break;
 
-                    cout << " XtermEscape::runCSIDEC(): DEC Private Mode Reset unhandled." << endl;
-                    myState = NGXS_START;
-                }//if myState && myState
-                break;
+        //DEC Private Mode Set
+        case 'h':
+            if (numParameters == 0)
+            {
+                cout << " XtermEscape::runCSIDEC(): didn't get a parameter!" << endl;
+                parseError = true;
+            }//if numParameters
 
-            //DEC Private Mode Set
-            case 'h':
-                while ((paramIndex < parameters.size()) && (myState != NGXS_ERROR))
-                {
-                    oneParameter = parameters.at(paramIndex);
-                    if (extractInt(oneParameter, decSet))
-                        runDECPMSet(decSet);
-                    else
-                    {
-                        cout << " XtermEscape::runCSIDEC(): Couldn't convert "
-                             << arrayToStr(oneParameter) << " to int" << endl;
-                        myState = NGXS_ERROR;
-                    }//else strToInt()
-
-                    paramIndex++;
-                }//while paramIndex && myState
-
-                if (myState != NGXS_START)
-                {
-                    cout << " XtermEscape::runCSIDEC(): didn't get a parameter!" << endl;
-                    myState = NGXS_ERROR;
-                }//if myState
-                break;
+            while ((paramIndex < numParameters) && (!parseError))
+            {
+                runDECPMSet(parameters[paramIndex]);
+                paramIndex++;
+            }//while paramIndex && parseError
+            break;
 
-            default:
-                cout << " XtermEscape::runCSIDEC(): unknown byte: "
-                     << static_cast<int>(currentByte) << endl;
-                myState = NGXS_ERROR;
-                break;
-        }//switch currentByte
-    }//else currentByte
+        default:
+            cout << " XtermEscape::runCSIDEC(): unknown byte: "
+                 << static_cast<int>(finalByte) << endl;
+            parseError = true;
+            break;
+    }//switch finalByte
 }//runCSIDEC
 
 void XtermEscape::runDECPMSet(int decSet)
@@ -1174,50 +1179,41 @@ void XtermEscape::runDECPMSet(int decSet)
     {
         case 1:
             cout << " XtermEscape::runCECPMSet(): DEC Private Mode Set: Application Cursor Keys DECCKM unhandled." << endl;
-            myState = NGXS_START;
             break;
 
         case 7:
             cout << " XtermEscape::runCECPMSet(): Xterm DEC Private Mode Set: Wraparound Mode (DECAWM) unhandled." << endl;
-            myState = NGXS_START;
             break;
 
         case 47:
             if (debugMessages)
                 cout << " Xterm DEC Private Mode Set: Use Alternate Screen Buffer, unless disabled by the titleInhibit resource." << endl;
-            alternateBuffer = true;
-            myState = NGXS_START;
+            theWindow->useAlternateBuffer(true, false);
             break;
 
         case 1047:
             if (debugMessages)
                 cout << " Xterm DEC Private Mode Set: Use Alternate Screen Buffer" << endl;
-            alternateBuffer = true;
-            myState = NGXS_START;
+            theWindow->useAlternateBuffer(true, false);
             break;
 
         case 1048:
-            cout << " XtermEscape::runCECPMSet(): Xterm DEC Private Mode Set: Save cursor as in DECSC untested." << endl;
-            savedCursorX = theWindow->getCursorX();
-            savedCursorY = theWindow->getCursorY();
-            myState = NGXS_START;
+            if (debugMessages)
+                cout << " Xterm DEC Private Mode Set: Save cursor as in DECSC" << endl;
+            saveCursor();
             break;
 
         case 1049:
             if (debugMessages)
                 cout << " Xterm DEC Private Mode Set: Save cursor as in DECSC and use Alternate Screen Buffer, clearing it first" << endl;
 
-            savedCursorX = theWindow->getCursorX();
-            savedCursorY = theWindow->getCursorY();
-
-            theWindow->eraseAll();
-            alternateBuffer = true;
-            myState = NGXS_START;
+            saveCursor();
+            theWindow->useAlternateBuffer(true, true);
             break;
 
         default:
             cout << " XtermEscape::runDECPMSet(): unknown DEC SET: " << decSet << endl;
-            myState = NGXS_ERROR;
+            parseError = true;
             break;
     }//switch decSet
 }//runDECPMSet
@@ -1228,132 +1224,125 @@ void XtermEscape::runDECPMReset(int decSet)
     {
         case 1:
             cout << " XtermEscape::runDECPMReset(): DEC Private Mode Reset: Normal Cursor Keys unhandled." << endl;
-            myState = NGXS_START;
             break;
 
         case 47:
             if (debugMessages)
                 cout << " Xterm DEC Private Mode Reset: Use Normal Screen Buffer" << endl;
-            alternateBuffer = false;
-            myState = NGXS_START;
+            theWindow->useAlternateBuffer(false, false);
             break;
 
         case 1047:
             if (debugMessages)
-                cout << " Xterm DEC Private Mode Reset: Use Normal Screen Buffer" << endl;
-            if (alternateBuffer)
-                theWindow->eraseAll();
-            alternateBuffer = false;
-            myState = NGXS_START;
+                cout << " Xterm DEC Private Mode Reset: Use Normal Screen Buffer, clearing the Alternate Screen Buffer" << endl;
+            theWindow->useAlternateBuffer(false, theWindow->getUsingAlternateBuffer());
             break;
 
         case 1048:
-            cout << " XtermEscape::runDECPMReset(): DEC Private Mode Reset: Restore cursor as in DECRC untested." << endl;
-
-            theWindow->setCursorX(savedCursorX);
-            theWindow->setCursorY(savedCursorY);
-            myState = NGXS_START;
+            if (debugMessages)
+                cout << " Xterm DEC Private Mode Reset: Restore cursor as in DECRC" << endl;
+            restoreCursor();
             break;
 
         case 1049:
             if (debugMessages)
                 cout << " Xterm DEC Private Mode Reset: Use Normal Screen Buffer and restore cursor as in DECRC" << endl;
 
-            if (alternateBuffer)
-                theWindow->eraseAll();
-            alternateBuffer = false;
-
-            theWindow->setCursorX(savedCursorX);
-            theWindow->setCursorY(savedCursorY);
-            myState = NGXS_START;
+            theWindow->useAlternateBuffer(false, false);
+            restoreCursor();
             break;
 
         default:
             cout << " XtermEscape::runDECPMReset(): unknown DEC SET: " << decSet << endl;
-            myState = NGXS_ERROR;
+            parseError = true;
             break;
     }//switch decSet
 }//runDECPMReset
 
-void XtermEscape::runG0CharSet(uint8_t currentByte)
+void XtermEscape::runG0CharSet(uint8_t finalByte)
 {
-    switch (currentByte)
+    switch (finalByte)
     {
         case 'B':
             cout << " XtermEscape::runG0CharSet(): Designate G0 Character Set United States (USASCII) unhandled." << endl;
-            myState = NGXS_START;
             break;
 
         case '0':
             cout << " XtermEscape::runG0CharSet(): Designate G0 Character Set DEC Special Character and Line Drawing Set unhandled." << endl;
-            myState = NGXS_START;
             break;
 
         default:
             cout << " XtermEscape::runG0CharSet(): unknown byte: "
-                 << static_cast<int>(currentByte) << endl;
-            myState = NGXS_ERROR;
+                 << static_cast<int>(finalByte) << endl;
+            parseError = true;
             break;
-    }//switch currentByte
+    }//switch finalByte
 }//runG0CharSet
 
-void XtermEscape::runG1CharSet(uint8_t currentByte)
+void XtermEscape::runG1CharSet(uint8_t finalByte)
 {
-    switch (currentByte)
+    switch (finalByte)
     {
         case '0':
             cout << " XtermEscape::runG1CharSet(): Designate G1 DEC Special Character and Line Drawing Set unhandled." << endl;
-            myState = NGXS_START;
             break;
 
         default:
             cout << " XtermEscape::runG1CharSet(): unknown byte: "
-                 << static_cast<int>(currentByte) << endl;
-            myState = NGXS_ERROR;
+                 << static_cast<int>(finalByte) << endl;
+            parseError = true;
             break;
-    }//switch currentByte
+    }//switch finalByte
 }//runG1CharSet
 
-bool XtermEscape::isASCIIDigit(uint8_t currentByte)
+void XtermEscape::startParameter(void)
 {
-    bool result = false;//true if this is a digit from '0' to '9'
+    if (numParameters < MAX_PARAMETERS)
+    {
+        parameters[numParameters] = 0;
+        numParameters++;
+    }//if numParameters
+}//startParameter
 
-    if ((currentByte >= 48) && (currentByte <= 57))
-        result = true;
+void XtermEscape::separateParameter(void)
+{
+    //### A leading ; means the first parameter was left out ###
+    if (numParameters == 0)
+        startParameter();
 
-    return result;
-}//isASCIIDigit
+    //### Extra parameters are ignored rather than stored ###
+    if (numParameters < MAX_PARAMETERS)
+        startParameter();
+    else
+        parameterOverflow = true;
+}//separateParameter
 
-string XtermEscape::arrayToStr(QByteArray *parameter)
+void XtermEscape::addParameterDigit(uint8_t currentByte)
 {
-    string result;//the string version to return
+    int *lastParameter = NULL;//the parameter we're receiving
 
-    for (int i = 0; i < parameter->size(); i++)
+    //### Don't add the digits of an ignored parameter to the last one we kept ###
+    if (!parameterOverflow)
     {
-        if (parameter->at(i) == 0)
-            cout << " XtermEscape::arrayToStr(): got a NULL character." << endl;
-
-        result.push_back(parameter->at(i));
-    }//for i
-
-    return result;
-}//arrayToStr
-
-bool XtermEscape::extractInt(QByteArray *oneParameter,
-                             int &intVersion)
-{
-    bool result = true;//false if we couldn't convert to int
+        if (numParameters == 0)
+            startParameter();
 
-    intVersion = oneParameter->toInt(&result, 10);
+        lastParameter = &parameters[numParameters - 1];
+        *lastParameter = *lastParameter * 10 + (currentByte - '0');
 
-    return result;
-}//extractInt
+        if (*lastParameter > MAX_PARAMETER_VALUE)
+            *lastParameter = MAX_PARAMETER_VALUE;
+    }//if !parameterOverflow
+}//addParameterDigit
 
 void XtermEscape::resetParameters(void)
 {
-    for (unsigned int i = 0; i < parameters.size(); i++)
-        delete parameters.at(i);
-    parameters.clear();
+    numParameters = 0;
+    parameterOverflow = false;
+    numIntermediates = 0;
+    ignoreSequence = false;
+    oscGotType = false;
+    oscString.clear();
 }//resetParameters
 
 bool XtermEscape::getUseTileNumber(void)